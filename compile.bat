@@ -1,5 +1,10 @@
 C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\simple_shader.vert -o out\build\x64-Debug\shaders\simple_shader.vert.spv
 C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\simple_shader.frag -o out\build\x64-Debug\shaders\simple_shader.frag.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\compressed_shader.vert -o out\build\x64-Debug\shaders\compressed_shader.vert.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe -DVERTEX_COLOR shaders\compressed_shader.vert -o out\build\x64-Debug\shaders\compressed_color_shader.vert.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\depth_shader.vert -o out\build\x64-Debug\shaders\depth_shader.vert.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\gpu_cull.comp -o out\build\x64-Debug\shaders\gpu_cull.comp.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\gpu_cluster_cull.comp -o out\build\x64-Debug\shaders\gpu_cluster_cull.comp.spv
 ROBOCOPY "D:\DEV\MY_GITHUB\OVRenderer\out\build\x64-Debug\shaders" "D:\DEV\MY_GITHUB\OVRenderer\out\build\x64-Release\resources\shaders" /mir
 ROBOCOPY "D:\DEV\MY_GITHUB\OVRenderer\out\build\x64-Debug\shaders" "D:\DEV\MY_GITHUB\OVRenderer\out\build\x64-Ship\resources\shaders" /mir
 pause
\ No newline at end of file
@@ -0,0 +1,57 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer) 
+// Version: 0.1 
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+
+#version 450
+
+// OvrModel::CompressedVertex, compiled with -DVERTEX_COLOR for the color stream at binding 2
+layout(location = 0) in vec3 position; // unorm within the model's bounds
+#ifdef VERTEX_COLOR
+layout(location = 1) in vec3 color;
+#endif
+layout(location = 2) in vec2 normal;   // octahedral snorm
+layout(location = 3) in vec2 uv;       // half floats
+
+// per instance, binding 1
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+
+// bit identical to depth_shader.vert, the depth prepass only passes fragments drawn here at equal depth
+invariant gl_Position;
+
+layout(push_constant) uniform Push {
+  mat4 projectionView; // projection * view, model comes from the instance
+  vec4 positionScale;  // OvrModel::Dequantization of the model drawn
+  vec4 positionOffset;
+} push;
+
+const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
+const float AMBIENT = 0.02;
+
+vec3 decodeOctahedral(vec2 encoded) {
+  vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  float fold = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -fold : fold;
+  n.y += n.y >= 0.0 ? -fold : fold;
+  return normalize(n);
+}
+
+void main() {
+  vec3 modelPosition = push.positionOffset.xyz + position * push.positionScale.xyz;
+  gl_Position = push.projectionView * modelMatrix * vec4(modelPosition, 1.0);
+
+  vec3 normalWorldSpace = normalize(mat3(normalMatrix) * decodeOctahedral(normal));
+
+  float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+
+#ifdef VERTEX_COLOR
+  fragColor = lightIntensity * color;
+#else
+  fragColor = vec3(lightIntensity);
+#endif
+}
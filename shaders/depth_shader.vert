@@ -0,0 +1,27 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer) 
+// Version: 0.1 
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+
+#version 450
+
+// the position stream alone (OvrPositionVertexLayout), float or unorm within the model's bounds
+layout(location = 0) in vec3 position;
+
+// per instance, binding 1
+layout(location = 4) in mat4 modelMatrix;
+
+invariant gl_Position;
+
+layout(push_constant) uniform Push {
+  mat4 projectionView;
+  vec4 positionScale;
+  vec4 positionOffset;
+} push;
+
+void main() {
+  vec3 modelPosition = push.positionOffset.xyz + position * push.positionScale.xyz;
+  gl_Position = push.projectionView * modelMatrix * vec4(modelPosition, 1.0);
+}
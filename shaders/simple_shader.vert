@@ -12,20 +12,29 @@ layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
 
+// per instance, binding 1
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
 layout(location = 0) out vec3 fragColor;
 
+// bit identical to depth_shader.vert, the depth prepass only passes fragments drawn here at equal depth
+invariant gl_Position;
+
 layout(push_constant) uniform Push {
-  mat4 transform; // projection * view * model
-  mat4 normalMatrix;
+  mat4 projectionView; // projection * view, model comes from the instance
+  vec4 positionScale;  // identity for float vertices, computed anyway to match depth_shader.vert
+  vec4 positionOffset;
 } push;
 
 const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
 const float AMBIENT = 0.02;
 
 void main() {
-  gl_Position = push.transform * vec4(position, 1.0);
+  vec3 modelPosition = push.positionOffset.xyz + position * push.positionScale.xyz;
+  gl_Position = push.projectionView * modelMatrix * vec4(modelPosition, 1.0);
 
-  vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+  vec3 normalWorldSpace = normalize(mat3(normalMatrix) * normal);
 
   float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
 
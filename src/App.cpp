@@ -6,7 +6,9 @@
 //========================================================================
 #include "App.h"
 #include "simple_render_system.h"
+#include "gpu_driven_render_system.h"
 #include "keyboard_movement_controller.h"
+#include "ovr_mesh_cache.h"
 #include <iostream>
 
 #define GLM_FORCE_RADIANS
@@ -22,51 +24,182 @@
 namespace ovr {
  
 	MainApp::MainApp() {
+		jobSystem = std::make_unique<OvrJobSystem>();
+		appWindow = std::make_unique<AppWindow>(WIDTH, HEIGHT, "OVRenderer");
+		ovrDevice = std::make_unique<OVRDevice>(*appWindow);
+		ovrRender = std::make_unique<OvrRenderer>(*appWindow, *ovrDevice);
+		pipelineBuilder = std::make_unique<OvrPipelineBuilder>(*ovrDevice);
+		loadGameObjects();
+	}
+
+	MainApp::MainApp(VkExtent2D extent, uint32_t frameCount) : headlessFrameCount{ frameCount } {
+		jobSystem = std::make_unique<OvrJobSystem>();
+		ovrDevice = std::make_unique<OVRDevice>();
+		ovrRender = std::make_unique<OvrRenderer>(*ovrDevice, extent);
+		pipelineBuilder = std::make_unique<OvrPipelineBuilder>(*ovrDevice);
 		loadGameObjects();
 	}
 
 	MainApp::~MainApp() {
 	}
 
+	void MainApp::setRenderPath(RenderPath path) {
+		if (path == RenderPath::GpuDriven && !ovrDevice->supportsDrawIndirectFirstInstance()) {
+			std::cout << "gpu driven render path needs drawIndirectFirstInstance, staying on the cpu path\n";
+			path = RenderPath::Cpu;
+		}
+		renderPath = path;
+	}
+
 	void MainApp::run() {
 
-		SimpleRenderSystem simpleRenderSystem{ ovrDevice, ovrRender.getSwapChainRenderPass() };
+		SimpleRenderSystem simpleRenderSystem{ *ovrDevice, ovrRender->getSwapChainRenderPass(), *pipelineBuilder };
+		GpuDrivenRenderSystem gpuDrivenRenderSystem{ *ovrDevice, ovrRender->getSwapChainRenderPass(), *pipelineBuilder };
+		simpleRenderSystem.setSceneBvh(&sceneBvh);
+		simpleRenderSystem.setJobSystem(jobSystem.get());
+		simpleRenderSystem.setLodSelector(&lodSelector);
+		gpuDrivenRenderSystem.setLodSelector(&lodSelector);
+		bool renderPathKeyDown = false;
+		bool depthPrepassKeyDown = false;
+		bool clusterCullingKeyDown = false;
+		bool lodKeyDown = false;
         OvrCamera camera{};
         //camera.setViewDirection(glm::vec3(0.f), glm::vec3(0.0f, 0.0f, 1.f));
         camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
         
 
-        auto viewerObject = OvrGameObject::createGameObject();
+        const OvrScene::id_t viewerId = scene.createEntity(); // no model, only moves the camera
         KeyboardMovementController cameraController{};
 
 
         auto currentTime = std::chrono::high_resolution_clock::now();
+        const auto startTime = currentTime;
+        uint32_t frameCount = 0;
+        uint64_t visibleTotal = 0;
+        uint64_t culledTotal = 0;
+        uint64_t transformsUpdatedTotal = 0;
+        uint64_t trianglesTotal = 0;
+        uint64_t fullTrianglesTotal = 0;
+        float statsTimer = 0.f;
         
-        while (!appWindow.shouldClose()) {
-			glfwPollEvents(); //get Window events
+        while (isHeadless() ? frameCount < headlessFrameCount : !appWindow->shouldClose()) {
+            if (!isHeadless()) {
+                glfwPollEvents(); //get Window events
+            }
 		
             auto newTime = std::chrono::high_resolution_clock::now();
             
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
-            cameraController.moveInPlaneXZ(appWindow.getGLFWindow(), frameTime, viewerObject);
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
-
-            float aspect = ovrRender.getAspectRatio();
+            const uint32_t viewer = scene.indexOf(viewerId);
+            if (!isHeadless()) { // headless runs keep the camera still so frames are comparable
+                glm::vec3 translation = scene.getTranslations()[viewer];
+                glm::vec3 rotation = scene.getRotations()[viewer];
+                cameraController.moveInPlaneXZ(appWindow->getGLFWindow(), frameTime, translation, rotation);
+                scene.setTranslation(viewer, translation); // stays clean while the camera is still
+                scene.setRotation(viewer, rotation);
+
+                bool keyDown = glfwGetKey(appWindow->getGLFWindow(), GLFW_KEY_G) == GLFW_PRESS;
+                if (keyDown && !renderPathKeyDown) {
+                    setRenderPath(renderPath == RenderPath::Cpu ? RenderPath::GpuDriven : RenderPath::Cpu);
+                    std::cout << "render path: " << (renderPath == RenderPath::Cpu ? "cpu" : "gpu driven") << "\n";
+                }
+                renderPathKeyDown = keyDown;
+
+                keyDown = glfwGetKey(appWindow->getGLFWindow(), GLFW_KEY_P) == GLFW_PRESS;
+                if (keyDown && !depthPrepassKeyDown) {
+                    simpleRenderSystem.setDepthPrepass(!simpleRenderSystem.isDepthPrepassEnabled());
+                    std::cout << "depth prepass: " << (simpleRenderSystem.isDepthPrepassEnabled() ? "on" : "off") << "\n";
+                }
+                depthPrepassKeyDown = keyDown;
+
+                keyDown = glfwGetKey(appWindow->getGLFWindow(), GLFW_KEY_C) == GLFW_PRESS;
+                if (keyDown && !clusterCullingKeyDown) {
+                    gpuDrivenRenderSystem.setClusterCulling(!gpuDrivenRenderSystem.isClusterCullingEnabled());
+                    std::cout << "cluster culling: " << (gpuDrivenRenderSystem.isClusterCullingEnabled() ? "on" : "off") << "\n";
+                }
+                clusterCullingKeyDown = keyDown;
+
+                keyDown = glfwGetKey(appWindow->getGLFWindow(), GLFW_KEY_L) == GLFW_PRESS;
+                if (keyDown && !lodKeyDown) {
+                    lodSelector.setEnabled(!lodSelector.isEnabled());
+                    std::cout << "LOD: " << (lodSelector.isEnabled() ? "on" : "off") << "\n";
+                }
+                lodKeyDown = keyDown;
+            }
+            camera.setViewYXZ(scene.getTranslations()[viewer], scene.getRotations()[viewer]);
+
+            float aspect = ovrRender->getAspectRatio();
             //camera.setOrthographicProjection(-1, 1, -1, 1, -1, 1);
             camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 1000.f);
-
-			if (auto commandBuffer = ovrRender.beginFrame()) {
-
-				//
-
-				ovrRender.beginSwapChainRenderPass(commandBuffer);
-                simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects, camera);
-				ovrRender.endSwapChainRenderPass(commandBuffer);
-				ovrRender.endFrame();
+            lodSelector.beginFrame(camera, static_cast<float>(ovrRender->getRenderExtent().height));
+
+			if (auto commandBuffer = ovrRender->beginFrame()) {
+
+				scene.updateWorldMatrices(jobSystem.get()); // only entities whose transform changed
+				transformsUpdatedTotal += scene.getLastUpdatedCount();
+				FrameInfo frameInfo{ ovrRender->GetFrameIndex(), frameTime, commandBuffer, camera, ovrRender->getCommandRecorder() };
+				if (renderPath == RenderPath::GpuDriven) {
+					gpuDrivenRenderSystem.cullGameObjects(frameInfo, scene); // compute, outside the render pass
+				}
+				else {
+					sceneBvh.update(scene);
+				}
+
+				ovrRender->beginSwapChainRenderPass(commandBuffer);
+				if (renderPath == RenderPath::GpuDriven) {
+					gpuDrivenRenderSystem.renderGameObjects(frameInfo);
+				}
+				else {
+					simpleRenderSystem.renderGameObjects(frameInfo, scene);
+				}
+				ovrRender->endSwapChainRenderPass(commandBuffer);
+				ovrRender->endFrame();
+				frameCount++;
+
+				// GPU driven counts come back a few frames late, objects it didn't report are culled
+				OvrCullingStats culling = simpleRenderSystem.getCullingStats();
+				if (renderPath == RenderPath::GpuDriven) {
+					culling.visible = gpuDrivenRenderSystem.getVisibleCount();
+					culling.culled = gpuDrivenRenderSystem.getLastObjectCount() - culling.visible;
+				}
+				visibleTotal += culling.visible;
+				culledTotal += culling.culled;
+				// the GPU path counts the objects it submits, before its cull
+				const bool gpuDriven = renderPath == RenderPath::GpuDriven;
+				const uint64_t triangles = gpuDriven ? gpuDrivenRenderSystem.getLastTriangleCount()
+					: simpleRenderSystem.getLastTriangleCount();
+				const uint64_t fullTriangles = gpuDriven ? gpuDrivenRenderSystem.getLastFullTriangleCount()
+					: simpleRenderSystem.getLastFullTriangleCount();
+				trianglesTotal += triangles;
+				fullTrianglesTotal += fullTriangles;
+				statsTimer += frameTime;
+				if (!isHeadless() && statsTimer >= 1.f) {
+					std::cout << "visible: " << culling.visible << ", culled: " << culling.culled
+						<< ", triangles: " << triangles << " (" << fullTriangles << " without LOD)";
+					if (renderPath == RenderPath::GpuDriven && gpuDrivenRenderSystem.getLastClusterCount() > 0) {
+						std::cout << ", clusters: " << gpuDrivenRenderSystem.getVisibleClusterCount()
+							<< "/" << gpuDrivenRenderSystem.getLastClusterCount();
+					}
+					std::cout << "\n";
+					statsTimer = 0.f;
+				}
 			}
 		}
+
+		vkDeviceWaitIdle(ovrDevice->device());
+		if (isHeadless() && frameCount > 0) {
+			float totalTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime).count();
+			std::cout << "Headless frames: " << frameCount
+				<< ", avg frame time: " << totalTime / frameCount << " ms"
+				<< ", avg visible: " << visibleTotal / frameCount
+				<< ", avg culled: " << culledTotal / frameCount
+				<< ", avg transforms updated: " << transformsUpdatedTotal / frameCount
+				<< ", avg triangles: " << trianglesTotal / frameCount
+				<< " (" << fullTrianglesTotal / frameCount << " without LOD)\n";
+		}
 	}
     
 	void MainApp::loadGameObjects()
@@ -78,30 +211,42 @@ namespace ovr {
         //    "D:\\DEV\\MY_GITHUB\\OVRenderer\\out\\build\\x64 - Release\\resources\\images\\textures\\text_texture.jpg");
         
 
+        const std::string modelPaths[1] = {
+            "D:\\DEV\\MY_GITHUB\\OVRenderer\\out\\build\\x64-Release\\resources\\models\\lada_niva.obj" };
+        // mapping the .ovrmesh caches (or parsing and writing them) is CPU only, one job per file and the
+        // parser splits big files further. The uploads are recorded on this thread below
+        OvrMeshAsset assets[1];
+        jobSystem->parallelFor(1, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                assets[i] = OvrMeshAsset::load(modelPaths[i], jobSystem.get());
+            }
+        });
+
+        OvrUploadBatch uploadBatch{ *ovrDevice }; // every model goes up in one submission
         for (int i = 0; i < 1; i++) {
-            ovrModel[i] = OvrModel::createModelFromFile(
-                ovrDevice,
-                "D:\\DEV\\MY_GITHUB\\OVRenderer\\out\\build\\x64-Release\\resources\\models\\lada_niva.obj");
+            std::cout << "Vertex count:" << assets[i].getMeshData().vertexCount << (assets[i].isFromCache() ? " (cached)\n" : "\n");
+            ovrModel[i] = std::make_shared<OvrModel>(
+                *ovrDevice, assets[i].getMeshData(), &uploadBatch, OvrModel::VertexFormat::Compressed, true);
+            std::cout << "Vertex memory: " << ovrModel[i]->getVertexMemorySize() << " bytes ("
+                << sizeof(OvrModel::Vertex) * ovrModel[i]->getVertexCount() << " uncompressed)\n";
             std::cout << i;
         }
+        uploadBatch.submit(); // not waited on, the first frame is ordered after it on the queue
         float trans = 0;
-        ovr::OvrGameObject car[1];
+        OvrScene::ModelHandle carModel = scene.addModel(ovrModel[0]);
         for (int i = 0; i < 1; i++) {
-            car[i] = OvrGameObject::createGameObject();
-            car[i].model = ovrModel[0];
-            car[i].transform.translation = { trans, .0f, 2.5f };
-            car[i].transform.scale = { .5f, .5f, .5f };
+            uint32_t car = scene.indexOf(scene.createEntity(carModel));
+            scene.setTranslation(car, { trans, .0f, 2.5f });
+            scene.setScale(car, { .5f, .5f, .5f });
             trans = trans + 1;
         }
 
         //ovr::OvrGameObject image[1];
         //car[0] = OvrGameObject::createGameObject();
         //car[]
-        
 
-        for (int i = 0; i < 1; i++) {
-            gameObjects.push_back(std::move(car[i]));
-        }
+        ovrDevice->memoryAllocator().printStats();
+        ovrDevice->geometryPool().printStats();
 
 	}
 
@@ -11,8 +11,12 @@
 #include "ovr_device.h"
 #include "ovr_model.h"
 #include "ovr_image.h"
-#include "ovr_game_object.h"
+#include "ovr_job_system.h"
+#include "ovr_lod_selector.h"
 #include "ovr_renderer.h"
+#include "ovr_pipeline_builder.h"
+#include "ovr_scene.h"
+#include "ovr_scene_bvh.h"
 
 #include <memory>
 #include <vector>
@@ -26,6 +30,8 @@ namespace ovr {
 		static constexpr int HEIGHT = 600;
 
 		MainApp();
+		// render offscreen without a window or swapchain, run() returns after frameCount frames
+		MainApp(VkExtent2D extent, uint32_t frameCount);
 		~MainApp();
 
 		// c++11 Disallow copying (compiler will not generate those constructors)
@@ -33,13 +39,30 @@ namespace ovr {
 		MainApp& operator=(const MainApp&) = delete;
 		void run();
 
+		enum class RenderPath {
+			Cpu,       // SimpleRenderSystem, draw list built on the CPU
+			GpuDriven  // GpuDrivenRenderSystem, compute culling + indirect draws
+		};
+		// can also be toggled with G while running. GpuDriven falls back to Cpu on devices without
+		// drawIndirectFirstInstance
+		void setRenderPath(RenderPath path);
+		// record the render pass on the job system's threads, see OvrRenderer::setRecordingJobSystem
+		void setParallelRecording(bool enabled) { ovrRender->setRecordingJobSystem(enabled ? jobSystem.get() : nullptr); }
+
 	private:
 		void loadGameObjects();
+		bool isHeadless() const { return appWindow == nullptr; }
 
-		AppWindow appWindow{WIDTH, HEIGHT, "OVRenderer"};
-		OVRDevice ovrDevice{appWindow};
-		OvrRenderer ovrRender{ appWindow, ovrDevice };
+		std::unique_ptr<OvrJobSystem> jobSystem; // first in, last out: the renderer may record on it
+		std::unique_ptr<AppWindow> appWindow;
+		std::unique_ptr<OVRDevice> ovrDevice;
+		std::unique_ptr<OvrRenderer> ovrRender;
+		std::unique_ptr<OvrPipelineBuilder> pipelineBuilder;
+		uint32_t headlessFrameCount = 0;
+		RenderPath renderPath = RenderPath::Cpu;
 
-		std::vector<OvrGameObject> gameObjects;
+		OvrScene scene;
+		OvrSceneBvh sceneBvh; // refit each frame for the entities whose transform changed
+		OvrLodSelector lodSelector; // both render paths, toggled with L
 	};
 }
\ No newline at end of file
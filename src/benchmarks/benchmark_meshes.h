@@ -0,0 +1,115 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ovr {
+
+	// Generated meshes shared by the benchmarks
+	struct OvrBenchmarkMesh {
+		std::string name{};
+		std::vector<OvrModel::Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+	};
+
+	// unit sphere of stacks and slices, closed surface with front and back faces from any direction.
+	// White, or colored with a gradient over the uvs
+	inline OvrBenchmarkMesh makeSphere(uint32_t stacks, uint32_t slices, bool colored = false) {
+		OvrBenchmarkMesh mesh{};
+		mesh.name = "sphere " + std::to_string(stacks) + "x" + std::to_string(slices) + (colored ? " colored" : "");
+		mesh.vertices.reserve(static_cast<size_t>(stacks + 1) * (slices + 1));
+		for (uint32_t stack = 0; stack <= stacks; stack++) {
+			float phi = glm::pi<float>() * stack / stacks;
+			for (uint32_t slice = 0; slice <= slices; slice++) {
+				float theta = glm::two_pi<float>() * slice / slices;
+				OvrModel::Vertex vertex{};
+				vertex.normal = { std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta) };
+				vertex.position = vertex.normal;
+				vertex.uv = { static_cast<float>(slice) / slices, static_cast<float>(stack) / stacks };
+				vertex.color = colored ? glm::vec3{ vertex.uv, .5f } : glm::vec3{ 1.f };
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		mesh.indices.reserve(static_cast<size_t>(stacks) * slices * 6);
+		for (uint32_t stack = 0; stack < stacks; stack++) {
+			for (uint32_t slice = 0; slice < slices; slice++) {
+				uint32_t v0 = stack * (slices + 1) + slice;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + slices + 1;
+				uint32_t v3 = v2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { v0, v1, v2, v1, v3, v2 });
+			}
+		}
+		return mesh;
+	}
+
+	// closed and smooth ring around the y axis, from any viewpoint about half of it faces away
+	inline OvrBenchmarkMesh makeTorus(uint32_t rings, uint32_t sides, float radius = 1.f, float tubeRadius = .3f) {
+		OvrBenchmarkMesh mesh{};
+		mesh.name = "torus " + std::to_string(rings) + "x" + std::to_string(sides);
+		mesh.vertices.reserve(static_cast<size_t>(rings) * sides);
+		for (uint32_t ring = 0; ring < rings; ring++) {
+			const float u = glm::two_pi<float>() * ring / rings;
+			for (uint32_t side = 0; side < sides; side++) {
+				const float v = glm::two_pi<float>() * side / sides;
+				OvrModel::Vertex vertex{};
+				vertex.normal = { std::cos(u) * std::cos(v), std::sin(v), std::sin(u) * std::cos(v) };
+				vertex.position = glm::vec3{ std::cos(u), 0.f, std::sin(u) } * radius + vertex.normal * tubeRadius;
+				vertex.uv = { static_cast<float>(ring) / rings, static_cast<float>(side) / sides };
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		mesh.indices.reserve(static_cast<size_t>(rings) * sides * 6);
+		for (uint32_t ring = 0; ring < rings; ring++) {
+			for (uint32_t side = 0; side < sides; side++) {
+				const uint32_t v0 = ring * sides + side;
+				const uint32_t v1 = ring * sides + (side + 1) % sides;
+				const uint32_t v2 = (ring + 1) % rings * sides + side;
+				const uint32_t v3 = (ring + 1) % rings * sides + (side + 1) % sides;
+				mesh.indices.insert(mesh.indices.end(), { v0, v1, v2, v1, v3, v2 });
+			}
+		}
+		return mesh;
+	}
+
+	// open and flat, size x size quads over [-.5, .5] on the xz plane facing up
+	inline OvrBenchmarkMesh makeSheet(uint32_t size) {
+		OvrBenchmarkMesh mesh{};
+		mesh.name = "sheet " + std::to_string(size);
+		mesh.vertices.reserve(static_cast<size_t>(size + 1) * (size + 1));
+		for (uint32_t y = 0; y <= size; y++) {
+			for (uint32_t x = 0; x <= size; x++) {
+				OvrModel::Vertex vertex{};
+				vertex.position = { static_cast<float>(x) / size - .5f, 0.f, static_cast<float>(y) / size - .5f };
+				vertex.normal = { 0.f, 1.f, 0.f };
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		mesh.indices.reserve(static_cast<size_t>(size) * size * 6);
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				const uint32_t v0 = y * (size + 1) + x;
+				const uint32_t v1 = v0 + 1;
+				const uint32_t v2 = v0 + size + 1;
+				const uint32_t v3 = v2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		}
+		return mesh;
+	}
+}
@@ -0,0 +1,50 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace ovr {
+	int runBenchmark(const std::string& name) {
+		if (name == "draw") {
+			return runDrawBenchmark();
+		}
+		if (name == "bvh") {
+			return runBvhBenchmark();
+		}
+		if (name == "transform") {
+			return runTransformBenchmark();
+		}
+		if (name == "record") {
+			return runRecordBenchmark();
+		}
+		if (name == "jobs") {
+			return runJobBenchmark();
+		}
+		if (name == "obj") {
+			return runObjBenchmark();
+		}
+		if (name == "dedup") {
+			return runDedupBenchmark();
+		}
+		if (name == "meshopt") {
+			return runMeshOptBenchmark();
+		}
+		if (name == "vertexformat") {
+			return runVertexFormatBenchmark();
+		}
+		if (name == "meshlets") {
+			return runMeshletBenchmark();
+		}
+		if (name == "lod") {
+			return runLodBenchmark();
+		}
+		std::cerr << "unknown benchmark: " << name << "\n";
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,51 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace ovr {
+
+	// Headless benchmarks selected with --bench <name>, results go to stdout
+	// draw: CPU draw list (SIMD or BVH culling) vs GPU driven culling at 1k, 10k and 100k objects
+	// bvh: BVH build/refit/queries vs brute force at 10k, 100k and 1M boxes
+	// record: CPU draw list recorded inline vs into secondary command buffers on 1 to N threads
+	// dedup: vertex deduplication, std::unordered_map vs flat table vs parallel sort, 1M to 16M corners
+	// jobs: job system scaling from 1 to hardware_concurrency (at most 64) threads, checked against one thread
+	// lod: level of detail chains (triangles, error) and triangles drawn per frame with and without LOD selection
+	// meshlets: meshlet sizes, bounds, cones and how many clusters face away from a few viewpoints
+	// meshopt: vertex cache (ACMR/ATVR), overdraw and vertex fetch optimization on ordered and shuffled meshes
+	// obj: native chunked OBJ parser on 1 to N threads vs tinyobj, 64 MB to 2 GB generated files
+	// transform: batch world/normal/MVP kernels vs per object glm math, 1k to 1M objects
+	// vertexformat: compressed vertex memory and encode error (positions, octahedral normals, half uvs)
+	int runBenchmark(const std::string& name);
+
+	int runDrawBenchmark();
+	int runBvhBenchmark();
+	int runTransformBenchmark();
+	int runRecordBenchmark();
+	int runJobBenchmark();
+	int runObjBenchmark();
+	int runDedupBenchmark();
+	int runMeshOptBenchmark();
+	int runVertexFormatBenchmark();
+	int runMeshletBenchmark();
+	int runLodBenchmark();
+
+	// average milliseconds of one call to function over iterations calls
+	template <typename Function>
+	double measureMs(uint32_t iterations, Function&& function) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; i++) {
+			function();
+		}
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count() / iterations;
+	}
+}
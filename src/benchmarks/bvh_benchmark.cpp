@@ -0,0 +1,148 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "ovr_bvh.h"
+#include "ovr_camera.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace ovr {
+	static bool sameItems(std::vector<uint32_t> a, std::vector<uint32_t> b) {
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		return a == b;
+	}
+
+	int runBvhBenchmark() {
+		constexpr uint32_t QUERY_ITERATIONS = 20;
+		constexpr uint32_t NEAREST_QUERIES = 1000;
+		constexpr float WORLD_SIZE = 1000.f;
+		const uint32_t objectCounts[] = { 10000, 100000, 1000000 };
+
+		// looks along +z from the middle of one face, so roughly a tenth of the world is visible
+		OvrCamera camera{};
+		camera.setViewDirection(glm::vec3{ 0.f, 0.f, -WORLD_SIZE * .5f }, glm::vec3{ 0.f, 0.f, 1.f });
+		camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, WORLD_SIZE * .5f);
+		const OvrFrustumPlanes planes = camera.getFrustumPlanes();
+
+		std::printf("%10s %10s %12s %12s %12s %12s %12s %12s %12s\n",
+			"objects", "visible", "build ms", "refit ms", "frustum ms", "brute ms",
+			"range ms", "brute ms", "nearest us");
+
+		bool allMatch = true;
+		for (uint32_t objectCount : objectCounts) {
+			std::mt19937 random{ objectCount };
+			std::uniform_real_distribution<float> position{ -WORLD_SIZE * .5f, WORLD_SIZE * .5f };
+			std::uniform_real_distribution<float> size{ .25f, 2.f };
+
+			std::vector<OvrAabb> boxes(objectCount);
+			for (auto& box : boxes) {
+				glm::vec3 center{ position(random), position(random), position(random) };
+				glm::vec3 halfExtent{ size(random), size(random), size(random) };
+				box.min = center - halfExtent;
+				box.max = center + halfExtent;
+			}
+
+			OvrBvh bvh{};
+			double buildMs = measureMs(1, [&]() { bvh.build(boxes); });
+
+			// a tenth of the objects move a little every frame, like a mostly static scene
+			std::uniform_int_distribution<uint32_t> pick{ 0, objectCount - 1 };
+			std::uniform_real_distribution<float> step{ -.5f, .5f };
+			double refitMs = measureMs(QUERY_ITERATIONS, [&]() {
+				for (uint32_t i = 0; i < objectCount / 10; i++) {
+					uint32_t item = pick(random);
+					glm::vec3 offset{ step(random), step(random), step(random) };
+					boxes[item].min += offset;
+					boxes[item].max += offset;
+					bvh.update(item, boxes[item]);
+				}
+				bvh.refit();
+			});
+
+			std::vector<uint32_t> bvhVisible, bruteVisible;
+			double frustumMs = measureMs(QUERY_ITERATIONS, [&]() {
+				bvhVisible.clear();
+				bvh.queryFrustum(planes, bvhVisible);
+			});
+			double bruteFrustumMs = measureMs(QUERY_ITERATIONS, [&]() {
+				bruteVisible.clear();
+				for (uint32_t i = 0; i < objectCount; i++) {
+					if (testFrustum(boxes[i], planes) != OvrFrustumTest::Outside) {
+						bruteVisible.push_back(i);
+					}
+				}
+			});
+			allMatch &= sameItems(bvhVisible, bruteVisible);
+			const size_t visibleCount = bvhVisible.size();
+
+			OvrAabb range{ glm::vec3{ -50.f }, glm::vec3{ 50.f } };
+			std::vector<uint32_t> bvhRange, bruteRange;
+			double rangeMs = measureMs(QUERY_ITERATIONS, [&]() {
+				bvhRange.clear();
+				bvh.queryRange(range, bvhRange);
+			});
+			double bruteRangeMs = measureMs(QUERY_ITERATIONS, [&]() {
+				bruteRange.clear();
+				for (uint32_t i = 0; i < objectCount; i++) {
+					if (boxes[i].overlaps(range)) {
+						bruteRange.push_back(i);
+					}
+				}
+			});
+			allMatch &= sameItems(bvhRange, bruteRange);
+
+			std::vector<glm::vec3> points(NEAREST_QUERIES);
+			for (auto& point : points) {
+				point = { position(random), position(random), position(random) };
+			}
+			std::vector<float> nearestDistances(NEAREST_QUERIES);
+			double nearestMs = measureMs(1, [&]() {
+				for (uint32_t i = 0; i < NEAREST_QUERIES; i++) {
+					bvh.queryNearest(points[i], &nearestDistances[i]);
+				}
+			});
+			// brute force nearest only for a few points, it is O(n) per query
+			for (uint32_t i = 0; i < 10; i++) {
+				float best = std::numeric_limits<float>::max();
+				for (const auto& box : boxes) {
+					best = std::min(best, box.distanceSquared(points[i]));
+				}
+				allMatch &= std::abs(std::sqrt(best) - nearestDistances[i]) <= 1e-3f;
+			}
+
+			std::printf("%10u %10zu %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n",
+				objectCount,
+				visibleCount,
+				buildMs,
+				refitMs,
+				frustumMs,
+				bruteFrustumMs,
+				rangeMs,
+				bruteRangeMs,
+				nearestMs * 1000.0 / NEAREST_QUERIES);
+			std::printf("%10s sah cost %.2f after refits, %.2f at build, %zu nodes\n",
+				"", bvh.getSahCost(), bvh.getBuildSahCost(), bvh.nodeCount());
+		}
+
+		if (!allMatch) {
+			std::printf("bvh queries disagree with brute force!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,130 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "ovr_job_system.h"
+#include "ovr_utils.h"
+#include "ovr_vertex_table.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ovr {
+	// the hash Builder::loadModel used with std::unordered_map before OvrVertexTable
+	struct OvrReferenceVertexHash {
+		size_t operator()(const OvrModel::Vertex& vertex) const {
+			size_t seed = 0;
+			hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+
+	// the corners of a smooth grid mesh, two triangles per cell, so most vertices are shared by 6 corners
+	static std::vector<OvrModel::Vertex> makeGridCorners(uint32_t cornerCount) {
+		const uint32_t cells = static_cast<uint32_t>(std::sqrt(cornerCount / 6.0)) + 1;
+		auto gridVertex = [cells](uint32_t x, uint32_t y) {
+			OvrModel::Vertex vertex{};
+			vertex.position = { static_cast<float>(x), std::sin(x * .1f) * std::cos(y * .1f), static_cast<float>(y) };
+			vertex.color = { 1.f, 1.f, 1.f };
+			vertex.normal = glm::normalize(glm::vec3{ -std::cos(x * .1f) * .1f, 1.f, std::sin(y * .1f) * .1f });
+			vertex.uv = { x / static_cast<float>(cells), y / static_cast<float>(cells) };
+			return vertex;
+		};
+		std::vector<OvrModel::Vertex> corners;
+		corners.reserve(cornerCount);
+		for (uint32_t y = 0; y < cells && corners.size() < cornerCount; y++) {
+			for (uint32_t x = 0; x < cells && corners.size() < cornerCount; x++) {
+				const OvrModel::Vertex quad[6] = {
+					gridVertex(x, y), gridVertex(x + 1, y), gridVertex(x + 1, y + 1),
+					gridVertex(x, y), gridVertex(x + 1, y + 1), gridVertex(x, y + 1) };
+				for (const auto& corner : quad) {
+					if (corners.size() < cornerCount) {
+						corners.push_back(corner);
+					}
+				}
+			}
+		}
+		return corners;
+	}
+
+	int runDedupBenchmark() {
+		const uint32_t cornerCounts[] = { 1000000, 4000000, 16000000 };
+
+		std::vector<uint32_t> threadCounts;
+		const uint32_t maxThreads = std::min(64u, std::max(1u, std::thread::hardware_concurrency()));
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		std::printf("%10s %10s %16s %12s %12s %8s\n", "corners", "unique", "method", "ms", "Mvertex/s", "speedup");
+
+		bool allMatch = true;
+		for (uint32_t cornerCount : cornerCounts) {
+			const std::vector<OvrModel::Vertex> corners = makeGridCorners(cornerCount);
+
+			// what loadModel did: count, then operator[], nothing reserved
+			std::vector<OvrModel::Vertex> referenceVertices;
+			std::vector<uint32_t> referenceIndices;
+			double referenceMs = measureMs(1, [&]() {
+				std::unordered_map<OvrModel::Vertex, uint32_t, OvrReferenceVertexHash> uniqueVertices{};
+				for (const auto& vertex : corners) {
+					if (uniqueVertices.count(vertex) == 0) {
+						uniqueVertices[vertex] = static_cast<uint32_t>(referenceVertices.size());
+						referenceVertices.push_back(vertex);
+					}
+					referenceIndices.push_back(uniqueVertices[vertex]);
+				}
+			});
+
+			auto report = [&](const std::string& method, double ms, const std::vector<OvrModel::Vertex>& vertices,
+				const std::vector<uint32_t>& indices) {
+				allMatch &= vertices.size() == referenceVertices.size() && indices == referenceIndices &&
+					std::memcmp(vertices.data(), referenceVertices.data(), vertices.size() * sizeof(OvrModel::Vertex)) == 0;
+				std::printf("%10u %10zu %16s %12.1f %12.1f %8.2f\n",
+					cornerCount, vertices.size(), method.c_str(), ms, corners.size() / (ms * 1000.0), referenceMs / ms);
+			};
+			report("unordered_map", referenceMs, referenceVertices, referenceIndices);
+
+			std::vector<OvrModel::Vertex> vertices;
+			std::vector<uint32_t> indices;
+			double tableMs = measureMs(1, [&]() {
+				OvrVertexTable table{ corners.size() };
+				indices.reserve(corners.size());
+				for (const auto& vertex : corners) {
+					indices.push_back(table.insert(vertex, vertices));
+				}
+			});
+			report("flat table", tableMs, vertices, indices);
+
+			for (uint32_t threadCount : threadCounts) {
+				OvrJobSystem jobSystem{ threadCount };
+				vertices.clear();
+				indices.clear();
+				double sortMs = measureMs(1, [&]() {
+					OvrVertexTable::deduplicate(corners.data(), corners.size(), jobSystem, vertices, indices);
+				});
+				report("sort " + std::to_string(threadCount) + " threads", sortMs, vertices, indices);
+			}
+		}
+
+		if (!allMatch) {
+			std::printf("deduplicated vertices disagree with std::unordered_map!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,240 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "gpu_driven_render_system.h"
+#include "ovr_job_system.h"
+#include "ovr_pipeline_builder.h"
+#include "ovr_renderer.h"
+#include "ovr_scene.h"
+#include "ovr_scene_bvh.h"
+#include "simple_render_system.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ovr {
+	static OvrModel::Builder createCubeBuilder() {
+		OvrModel::Builder builder{};
+		const glm::vec3 color{ .8f, .8f, .8f };
+		for (int face = 0; face < 6; face++) {
+			int axis = face / 2;
+			float side = face % 2 ? .5f : -.5f;
+			glm::vec3 normal{ 0.f };
+			normal[axis] = side * 2.f;
+			uint32_t base = static_cast<uint32_t>(builder.vertices.size());
+			for (int corner = 0; corner < 4; corner++) {
+				glm::vec3 position{ 0.f };
+				position[axis] = side;
+				position[(axis + 1) % 3] = corner & 1 ? .5f : -.5f;
+				position[(axis + 2) % 3] = corner & 2 ? .5f : -.5f;
+				builder.vertices.push_back({ position, color, normal, { 0.f, 0.f } });
+			}
+			builder.indices.insert(builder.indices.end(), { base, base + 1, base + 3, base, base + 3, base + 2 });
+		}
+		return builder;
+	}
+
+	int runDrawBenchmark() {
+		constexpr uint32_t WARMUP_FRAMES = 10;
+		constexpr uint32_t MEASURED_FRAMES = 100;
+		const uint32_t objectCounts[] = { 1000, 10000, 100000 };
+
+		OVRDevice device{};
+		OvrRenderer renderer{ device, VkExtent2D{ 800, 600 } };
+		OvrPipelineBuilder pipelineBuilder{ device };
+		SimpleRenderSystem simpleRenderSystem{ device, renderer.getSwapChainRenderPass(), pipelineBuilder };
+		GpuDrivenRenderSystem gpuDrivenRenderSystem{ device, renderer.getSwapChainRenderPass(), pipelineBuilder };
+
+		std::shared_ptr<OvrModel> cube = std::make_shared<OvrModel>(device, createCubeBuilder());
+
+		OvrCamera camera{};
+		camera.setViewDirection(glm::vec3{ 0.f, -2.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f });
+		camera.setPerspectiveProjection(glm::radians(50.f), renderer.getAspectRatio(), 0.1f, 1000.f);
+
+		// every path frustum culls: the CPU one with the SIMD kernel or the scene BVH, the other in compute
+		std::printf("%10s %12s %14s %14s %10s %10s\n",
+			"objects", "path", "record ms", "frame ms", "draws", "visible");
+
+		for (uint32_t objectCount : objectCounts) {
+			// square grid in front of the camera, wide enough that part of it is outside the frustum
+			OvrScene scene{};
+			scene.reserve(objectCount);
+			OvrScene::ModelHandle cubeModel = scene.addModel(cube);
+			uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+			for (uint32_t i = 0; i < objectCount; i++) {
+				uint32_t index = scene.indexOf(scene.createEntity(cubeModel));
+				scene.setTranslation(index, {
+					(static_cast<float>(i % side) - side * .5f) * 1.5f, 0.f, 2.f + static_cast<float>(i / side) * 1.5f });
+				scene.setScale(index, glm::vec3{ .5f });
+			}
+
+			OvrSceneBvh sceneBvh{};
+			for (int path = 0; path < 3; path++) {
+				bool bvh = path == 1;
+				bool gpuDriven = path == 2;
+				simpleRenderSystem.setSceneBvh(bvh ? &sceneBvh : nullptr);
+				double recordMs = 0.0;
+				uint32_t draws = 0;
+				auto measureStart = std::chrono::high_resolution_clock::now();
+
+				for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++) {
+					if (frame == WARMUP_FRAMES) {
+						recordMs = 0.0;
+						measureStart = std::chrono::high_resolution_clock::now();
+					}
+					auto commandBuffer = renderer.beginFrame();
+					auto recordStart = std::chrono::high_resolution_clock::now();
+
+					scene.updateWorldMatrices(); // static grid, only the first frame computes matrices
+					FrameInfo frameInfo{ renderer.GetFrameIndex(), 0.f, commandBuffer, camera };
+					if (gpuDriven) {
+						gpuDrivenRenderSystem.cullGameObjects(frameInfo, scene);
+					}
+					else if (bvh) {
+						sceneBvh.update(scene); // the grid is static, only the first frame builds
+					}
+					renderer.beginSwapChainRenderPass(commandBuffer);
+					if (gpuDriven) {
+						gpuDrivenRenderSystem.renderGameObjects(frameInfo);
+						draws = gpuDrivenRenderSystem.getLastDrawCount();
+					}
+					else {
+						simpleRenderSystem.renderGameObjects(frameInfo, scene);
+						draws = simpleRenderSystem.getLastDrawCount();
+					}
+					renderer.endSwapChainRenderPass(commandBuffer);
+
+					recordMs += std::chrono::duration<double, std::milli>(
+						std::chrono::high_resolution_clock::now() - recordStart).count();
+					renderer.endFrame();
+				}
+				vkDeviceWaitIdle(device.device());
+				double frameMs = std::chrono::duration<double, std::milli>(
+					std::chrono::high_resolution_clock::now() - measureStart).count();
+
+				std::printf("%10u %12s %14.3f %14.3f %10u %10u\n",
+					objectCount,
+					gpuDriven ? "gpu driven" : bvh ? "cpu bvh" : "cpu",
+					recordMs / MEASURED_FRAMES,
+					frameMs / MEASURED_FRAMES,
+					draws,
+					gpuDriven ? gpuDrivenRenderSystem.getVisibleCount() : simpleRenderSystem.getCullingStats().visible);
+			}
+		}
+		return EXIT_SUCCESS;
+	}
+
+	int runRecordBenchmark() {
+		constexpr uint32_t WARMUP_FRAMES = 10;
+		constexpr uint32_t MEASURED_FRAMES = 100;
+		constexpr uint32_t OBJECT_COUNT = 100000;
+		// one model is a handful of large instanced draws, many models are many small ones
+		const uint32_t modelCounts[] = { 1, 1024 };
+
+		OVRDevice device{};
+		OvrRenderer renderer{ device, VkExtent2D{ 800, 600 } };
+		OvrPipelineBuilder pipelineBuilder{ device };
+		SimpleRenderSystem simpleRenderSystem{ device, renderer.getSwapChainRenderPass(), pipelineBuilder };
+		simpleRenderSystem.setFrustumCulling(false); // every object is drawn, so recording is the bulk of the work
+
+		std::vector<uint32_t> threadCounts{ 0 }; // 0 is inline in the primary command buffer
+		const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(hardwareThreads);
+
+		OvrCamera camera{};
+		camera.setViewDirection(glm::vec3{ 0.f, -2.f, 0.f }, glm::vec3{ 0.f, 0.f, 1.f });
+		camera.setPerspectiveProjection(glm::radians(50.f), renderer.getAspectRatio(), 0.1f, 1000.f);
+
+		std::printf("%10s %10s %10s %14s %10s %14s %10s\n",
+			"objects", "models", "threads", "record ms", "speedup", "frame ms", "draws");
+
+		OvrModel::Builder cubeBuilder = createCubeBuilder();
+		for (uint32_t modelCount : modelCounts) {
+			OvrScene scene{};
+			scene.reserve(OBJECT_COUNT);
+			std::vector<OvrScene::ModelHandle> models;
+			for (uint32_t i = 0; i < modelCount; i++) {
+				models.push_back(scene.addModel(std::make_shared<OvrModel>(device, cubeBuilder)));
+			}
+			uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(OBJECT_COUNT))));
+			for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+				uint32_t index = scene.indexOf(scene.createEntity(models[i % modelCount]));
+				scene.setTranslation(index, {
+					(static_cast<float>(i % side) - side * .5f) * 1.5f, 0.f, 2.f + static_cast<float>(i / side) * 1.5f });
+				scene.setScale(index, glm::vec3{ .5f });
+			}
+			scene.updateWorldMatrices();
+
+			double inlineRecordMs = 0.0;
+			for (uint32_t threadCount : threadCounts) {
+				std::unique_ptr<OvrJobSystem> jobSystem;
+				if (threadCount > 0) {
+					jobSystem = std::make_unique<OvrJobSystem>(threadCount);
+				}
+				renderer.setRecordingJobSystem(jobSystem.get());
+				double recordMs = 0.0;
+				auto measureStart = std::chrono::high_resolution_clock::now();
+
+				for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++) {
+					if (frame == WARMUP_FRAMES) {
+						recordMs = 0.0;
+						measureStart = std::chrono::high_resolution_clock::now();
+					}
+					auto commandBuffer = renderer.beginFrame();
+					FrameInfo frameInfo{ renderer.GetFrameIndex(), 0.f, commandBuffer, camera, renderer.getCommandRecorder() };
+
+					auto recordStart = std::chrono::high_resolution_clock::now();
+					renderer.beginSwapChainRenderPass(commandBuffer);
+					simpleRenderSystem.renderGameObjects(frameInfo, scene);
+					renderer.endSwapChainRenderPass(commandBuffer);
+					recordMs += std::chrono::duration<double, std::milli>(
+						std::chrono::high_resolution_clock::now() - recordStart).count();
+
+					renderer.endFrame();
+				}
+				vkDeviceWaitIdle(device.device());
+				double frameMs = std::chrono::duration<double, std::milli>(
+					std::chrono::high_resolution_clock::now() - measureStart).count();
+
+				recordMs /= MEASURED_FRAMES;
+				if (threadCount == 0) {
+					inlineRecordMs = recordMs;
+				}
+				char threads[16];
+				if (threadCount == 0) {
+					std::snprintf(threads, sizeof(threads), "inline");
+				}
+				else {
+					std::snprintf(threads, sizeof(threads), "%u", threadCount);
+				}
+				std::printf("%10u %10u %10s %14.3f %10.2f %14.3f %10u\n",
+					OBJECT_COUNT,
+					modelCount,
+					threads,
+					recordMs,
+					inlineRecordMs / recordMs,
+					frameMs / MEASURED_FRAMES,
+					simpleRenderSystem.getLastDrawCount());
+				renderer.setRecordingJobSystem(nullptr); // before jobSystem goes away
+			}
+		}
+		return EXIT_SUCCESS;
+	}
+}
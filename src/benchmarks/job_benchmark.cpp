@@ -0,0 +1,157 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "ovr_job_system.h"
+#include "ovr_transform_batch.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace ovr {
+	int runJobBenchmark() {
+		constexpr uint32_t ITERATIONS = 10;
+		constexpr uint32_t OBJECT_COUNT = 1000000;
+		constexpr uint32_t TRANSFORM_GRAIN = 4096;
+		constexpr uint32_t EMPTY_JOBS = 100000;
+		constexpr uint32_t GRAPH_CHAINS = 1000; // each chain is 4 jobs, every one waiting for the previous
+		constexpr uint32_t GRAPH_DEPTH = 4;
+
+		std::vector<uint32_t> threadCounts;
+		const uint32_t maxThreads = std::min(64u, std::max(1u, std::thread::hardware_concurrency()));
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		std::mt19937 random{ OBJECT_COUNT };
+		std::uniform_real_distribution<float> position{ -100.f, 100.f };
+		std::uniform_real_distribution<float> angle{ -glm::pi<float>(), glm::pi<float>() };
+		std::uniform_real_distribution<float> size{ .1f, 4.f };
+		std::vector<glm::vec3> translations(OBJECT_COUNT), rotations(OBJECT_COUNT), scales(OBJECT_COUNT);
+		for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+			translations[i] = { position(random), position(random), position(random) };
+			rotations[i] = { angle(random), angle(random), angle(random) };
+			scales[i] = { size(random), size(random), size(random) };
+		}
+		OvrTransformBatch batch{};
+		batch.translations = translations.data();
+		batch.rotations = rotations.data();
+		batch.scales = scales.data();
+		batch.count = OBJECT_COUNT;
+
+		// single threaded reference, the job system must produce the same bits
+		std::vector<glm::mat4> referenceWorld(OBJECT_COUNT), referenceNormal(OBJECT_COUNT);
+		batch.worldMatrices = referenceWorld.data();
+		batch.normalMatrices = referenceNormal.data();
+		computeTransforms(batch);
+
+		std::printf("%8s %14s %8s %14s %8s %14s %8s\n",
+			"threads", "transforms ms", "speedup", "empty jobs us", "per job", "graph ms", "speedup");
+
+		bool allMatch = true;
+		double baseTransformMs = 0.0;
+		double baseGraphMs = 0.0;
+		std::vector<glm::mat4> world(OBJECT_COUNT), normal(OBJECT_COUNT);
+		for (uint32_t threadCount : threadCounts) {
+			OvrJobSystem jobSystem{ threadCount };
+
+			// the transform update of a scene where everything moved. Ranges start at multiples of the grain so
+			// the SIMD kernels see the same groups of 8 as the reference and the results match bit for bit
+			const uint32_t rangeCount = (OBJECT_COUNT + TRANSFORM_GRAIN - 1) / TRANSFORM_GRAIN;
+			double transformMs = measureMs(ITERATIONS, [&]() {
+				jobSystem.parallelFor(rangeCount, 1, [&](uint32_t firstRange, uint32_t lastRange) {
+					uint32_t begin = firstRange * TRANSFORM_GRAIN;
+					uint32_t end = std::min(lastRange * TRANSFORM_GRAIN, OBJECT_COUNT);
+					OvrTransformBatch range = batch;
+					range.translations += begin;
+					range.rotations += begin;
+					range.scales += begin;
+					range.count = end - begin;
+					range.worldMatrices = world.data() + begin;
+					range.normalMatrices = normal.data() + begin;
+					computeTransforms(range);
+				});
+			});
+			allMatch &= std::memcmp(world.data(), referenceWorld.data(), world.size() * sizeof(glm::mat4)) == 0;
+			allMatch &= std::memcmp(normal.data(), referenceNormal.data(), normal.size() * sizeof(glm::mat4)) == 0;
+
+			// scheduling overhead alone: jobs that do nothing, started from outside the workers
+			std::atomic<uint32_t> emptyRuns{ 0 };
+			double emptyMs = measureMs(ITERATIONS, [&]() {
+				OvrJobCounter counter{};
+				for (uint32_t i = 0; i < EMPTY_JOBS; i++) {
+					jobSystem.run([&emptyRuns]() { emptyRuns.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				}
+				jobSystem.wait(counter);
+			});
+			allMatch &= emptyRuns.load() == EMPTY_JOBS * ITERATIONS;
+
+			// dependencies: chains of jobs where each link runs after the previous one, with some work in each
+			std::vector<uint64_t> chainValues(GRAPH_CHAINS);
+			double graphMs = measureMs(ITERATIONS, [&]() {
+				std::vector<OvrJobCounter> links(GRAPH_CHAINS * GRAPH_DEPTH);
+				for (uint32_t chain = 0; chain < GRAPH_CHAINS; chain++) {
+					chainValues[chain] = chain;
+					auto step = [&chainValues, chain]() {
+						uint64_t value = chainValues[chain];
+						for (uint32_t i = 0; i < 10000; i++) {
+							value = value * 6364136223846793005ull + 1442695040888963407ull;
+						}
+						chainValues[chain] = value;
+					};
+					OvrJobCounter* link = &links[chain * GRAPH_DEPTH];
+					jobSystem.run(step, link);
+					for (uint32_t depth = 1; depth < GRAPH_DEPTH; depth++) {
+						jobSystem.runAfter(link[depth - 1], step, &link[depth]);
+					}
+				}
+				for (uint32_t chain = 0; chain < GRAPH_CHAINS; chain++) {
+					for (uint32_t depth = 0; depth < GRAPH_DEPTH; depth++) {
+						jobSystem.wait(links[chain * GRAPH_DEPTH + depth]);
+					}
+				}
+			});
+			for (uint32_t chain = 0; chain < GRAPH_CHAINS; chain++) {
+				uint64_t expected = chain;
+				for (uint32_t i = 0; i < 10000 * GRAPH_DEPTH; i++) {
+					expected = expected * 6364136223846793005ull + 1442695040888963407ull;
+				}
+				allMatch &= chainValues[chain] == expected; // the links ran in order
+			}
+
+			if (threadCount == 1) {
+				baseTransformMs = transformMs;
+				baseGraphMs = graphMs;
+			}
+			std::printf("%8u %14.3f %8.2f %14.1f %8.3f %14.3f %8.2f\n",
+				threadCount,
+				transformMs,
+				baseTransformMs / transformMs,
+				emptyMs * 1000.0,
+				emptyMs * 1000.0 / EMPTY_JOBS,
+				graphMs,
+				baseGraphMs / graphMs);
+		}
+
+		if (!allMatch) {
+			std::printf("job system results disagree with the single threaded ones!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,215 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "benchmarks/benchmark_meshes.h"
+#include "ovr_camera.h"
+#include "ovr_lod_selector.h"
+#include "ovr_mesh_simplifier.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace ovr {
+	static constexpr float TORUS_RADIUS = 1.f;
+	static constexpr float TORUS_TUBE_RADIUS = .3f;
+
+	struct OvrLodBenchmarkCase {
+		OvrBenchmarkMesh mesh{};
+		bool torus = false; // its surface is known, the error of every level can be measured
+	};
+
+	static float distanceToTorus(const glm::vec3& p) {
+		const glm::vec2 ring{ glm::length(glm::vec2{ p.x, p.z }) - TORUS_RADIUS, p.y };
+		return std::abs(glm::length(ring) - TORUS_TUBE_RADIUS);
+	}
+
+	// valid triangles over the mesh's vertices, the border of a sheet kept, and on a torus the largest
+	// distance of a triangle's centroid from the surface
+	static bool checkLevel(const OvrBenchmarkMesh& mesh, bool torus, const OvrModel::Lod& lod, float& maxDeviation) {
+		maxDeviation = 0.f;
+		if (lod.indexCount % 3 != 0 || lod.firstIndex + lod.indexCount > mesh.indices.size()) {
+			return false;
+		}
+		std::vector<uint8_t> used(mesh.vertices.size());
+		for (size_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+			const uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+			if (a >= mesh.vertices.size() || b >= mesh.vertices.size() || c >= mesh.vertices.size() ||
+				a == b || b == c || a == c) {
+				return false;
+			}
+			used[a] = used[b] = used[c] = 1;
+			if (torus) {
+				const glm::vec3 centroid = (mesh.vertices[a].position + mesh.vertices[b].position +
+					mesh.vertices[c].position) / 3.f;
+				maxDeviation = std::max(maxDeviation, distanceToTorus(centroid));
+			}
+		}
+		if (!torus) {
+			for (size_t i = 0; i < mesh.vertices.size(); i++) {
+				const glm::vec3& p = mesh.vertices[i].position;
+				if ((std::abs(p.x) == .5f || std::abs(p.z) == .5f) && !used[i]) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// the level picked along a walk away from the object and back, then at a standstill where the
+	// level changes while the distance jitters. Returns the level changes during the jitter
+	static uint32_t countJitterSwitches(OvrLodSelector& selector, OvrCamera& camera, const std::vector<OvrModel::Lod>& lods,
+		bool& monotonic) {
+		const glm::vec3 center{ 0.f };
+		const float radius = TORUS_RADIUS + TORUS_TUBE_RADIUS;
+		auto selectAt = [&](float distance) {
+			camera.setViewTarget(glm::vec3{ 0.f, 0.f, -distance }, center);
+			selector.beginFrame(camera, 1080.f);
+			return selector.select(0, lods.data(), static_cast<uint32_t>(lods.size()), center, radius, 1.f);
+		};
+
+		monotonic = true;
+		std::vector<float> switchDistances;
+		uint32_t previous = selectAt(1.5f);
+		for (float distance = 1.5f; distance < 500.f; distance *= 1.01f) {
+			const uint32_t level = selectAt(distance);
+			monotonic &= level >= previous;
+			if (level != previous) {
+				switchDistances.push_back(distance);
+			}
+			previous = level;
+		}
+		for (float distance = 500.f; distance > 1.5f; distance /= 1.01f) {
+			const uint32_t level = selectAt(distance);
+			monotonic &= level <= previous;
+			previous = level;
+		}
+
+		uint32_t switches = 0;
+		for (float switchDistance : switchDistances) {
+			previous = selectAt(switchDistance);
+			for (uint32_t frame = 0; frame < 100; frame++) {
+				const uint32_t level = selectAt(switchDistance * (frame % 2 == 0 ? 1.02f : .98f));
+				switches += level != previous;
+				previous = level;
+			}
+		}
+		return switches;
+	}
+
+	int runLodBenchmark() {
+		bool ok = true;
+		std::vector<OvrLodBenchmarkCase> cases;
+		cases.push_back({ makeTorus(256, 128, TORUS_RADIUS, TORUS_TUBE_RADIUS), true });
+		cases.push_back({ makeTorus(1024, 512, TORUS_RADIUS, TORUS_TUBE_RADIUS), true });
+		cases.push_back({ makeSheet(256), false });
+
+		std::printf("%-20s %10s %6s %10s %12s %12s %10s\n",
+			"mesh", "triangles", "level", "level tris", "error", "centroid err", "build ms");
+		std::vector<OvrModel::Lod> torusLods; // of the first torus
+		for (OvrLodBenchmarkCase& benchmarkCase : cases) {
+			OvrBenchmarkMesh& mesh = benchmarkCase.mesh;
+			const bool torus = benchmarkCase.torus;
+			const size_t triangleCount = mesh.indices.size() / 3;
+			const std::vector<uint32_t> original = mesh.indices;
+			std::vector<OvrModel::Lod> lods;
+			const double buildMs = measureMs(1, [&]() {
+				lods = OvrMeshSimplifier::buildLods(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+			});
+
+			bool meshOk = lods.size() > 1 && std::equal(original.begin(), original.end(), mesh.indices.begin());
+			for (size_t level = 0; level < lods.size(); level++) {
+				float deviation = 0.f;
+				meshOk &= checkLevel(mesh, torus, lods[level], deviation);
+				if (level > 0) {
+					meshOk &= lods[level].indexCount < lods[level - 1].indexCount &&
+						lods[level].error >= lods[level - 1].error;
+					// a few times the estimate at most, the quadric error averages over the planes
+					meshOk &= !torus || deviation <= 4.f * lods[level].error + 1e-3f;
+				}
+				std::printf("%-20s %10zu %6zu %10u %12.6f %12.6f %10.1f\n",
+					level == 0 ? mesh.name.c_str() : "", triangleCount, level, lods[level].indexCount / 3,
+					lods[level].error, torus ? deviation : 0.f, level == 0 ? buildMs : 0.0);
+			}
+			if (!meshOk) {
+				std::printf("  MISMATCH: invalid level of detail chain for %s\n", mesh.name.c_str());
+				ok = false;
+			}
+			if (torus && torusLods.empty()) {
+				torusLods = lods;
+			}
+		}
+
+		// hysteresis keeps the level still while the distance jitters around a switch
+		OvrCamera camera{};
+		camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, .1f, 1000.f);
+		std::printf("\n%-12s %10s %14s %10s\n", "hysteresis", "monotonic", "jitter switch", "levels");
+		for (float hysteresis : { 0.f, OvrLodSelector::DEFAULT_HYSTERESIS }) {
+			OvrLodSelector selector{};
+			selector.setHysteresis(hysteresis);
+			bool monotonic = true;
+			const uint32_t switches = countJitterSwitches(selector, camera, torusLods, monotonic);
+			std::printf("%-12.2f %10s %14u %10zu\n", hysteresis, monotonic ? "yes" : "no", switches, torusLods.size());
+			ok &= monotonic && (hysteresis == 0.f || switches == 0);
+		}
+
+		// a field of tori seen from one corner at 1080p, triangles drawn per frame by level
+		const uint32_t gridSize = 64;
+		const float spacing = 4.f;
+		camera.setViewTarget(glm::vec3{ -2.f, 3.f, -2.f }, glm::vec3{ gridSize * spacing * .5f, 0.f, gridSize * spacing * .5f });
+		const auto planes = camera.getFrustumPlanes();
+		const float radius = TORUS_RADIUS + TORUS_TUBE_RADIUS;
+		std::vector<glm::vec3> visibleCenters;
+		for (uint32_t z = 0; z < gridSize; z++) {
+			for (uint32_t x = 0; x < gridSize; x++) {
+				const glm::vec3 center{ x * spacing, 0.f, z * spacing };
+				bool inside = true;
+				for (const glm::vec4& plane : planes) {
+					inside &= glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+				}
+				if (inside) {
+					visibleCenters.push_back(center);
+				}
+			}
+		}
+
+		std::printf("\n%-24s %10s %16s %16s %10s %14s\n",
+			"scene", "visible", "tris no LOD", "tris with LOD", "ratio", "select ns/obj");
+		for (float maxPixelError : { .5f, 1.f, 2.f }) {
+			OvrLodSelector selector{};
+			selector.setMaxPixelError(maxPixelError);
+			uint64_t fullTriangles = 0;
+			uint64_t lodTriangles = 0;
+			const uint32_t frames = 16;
+			const double frameMs = measureMs(frames, [&]() {
+				fullTriangles = 0;
+				lodTriangles = 0;
+				selector.beginFrame(camera, 1080.f);
+				for (size_t i = 0; i < visibleCenters.size(); i++) {
+					const uint32_t level = selector.select(static_cast<OvrScene::id_t>(i), torusLods.data(),
+						static_cast<uint32_t>(torusLods.size()), visibleCenters[i], radius, 1.f);
+					fullTriangles += torusLods[0].indexCount / 3;
+					lodTriangles += torusLods[level].indexCount / 3;
+				}
+			});
+			const std::string name = "64x64 tori, " + std::to_string(maxPixelError).substr(0, 3) + " px";
+			std::printf("%-24s %10zu %16llu %16llu %10.3f %14.1f\n", name.c_str(), visibleCenters.size(),
+				static_cast<unsigned long long>(fullTriangles), static_cast<unsigned long long>(lodTriangles),
+				static_cast<double>(lodTriangles) / fullTriangles, frameMs * 1e6 / visibleCenters.size());
+			ok &= lodTriangles < fullTriangles;
+		}
+
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+}
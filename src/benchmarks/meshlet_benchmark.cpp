@@ -0,0 +1,141 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "benchmarks/benchmark_meshes.h"
+#include "ovr_mesh_optimizer.h"
+#include "ovr_meshlet_builder.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace ovr {
+	// every other triangle wound the other way, like a mesh merged from parts exported differently.
+	// Cones oriented by a winding for the whole mesh would point both ways
+	static OvrBenchmarkMesh mixWinding(OvrBenchmarkMesh mesh) {
+		for (size_t i = 3; i + 2 < mesh.indices.size(); i += 6) {
+			std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+		}
+		mesh.name += " mixed";
+		return mesh;
+	}
+
+	// the triangle's normal flipped to the side its vertex normals are on, as OvrMeshletBuilder orients it
+	static glm::vec3 facingNormal(const OvrBenchmarkMesh& mesh, size_t firstIndex) {
+		const OvrModel::Vertex& v0 = mesh.vertices[mesh.indices[firstIndex]];
+		const OvrModel::Vertex& v1 = mesh.vertices[mesh.indices[firstIndex + 1]];
+		const OvrModel::Vertex& v2 = mesh.vertices[mesh.indices[firstIndex + 2]];
+		const glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+		return glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.f ? -normal : normal;
+	}
+
+	static std::vector<std::array<uint32_t, 3>> sortedTriangles(const std::vector<uint32_t>& indices) {
+		std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); i++) {
+			triangles[i] = { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	int runMeshletBenchmark() {
+		std::vector<OvrBenchmarkMesh> meshes;
+		meshes.push_back(makeTorus(512, 256));
+		meshes.push_back(makeTorus(2048, 1024));
+		meshes.push_back(makeSheet(1024));
+		meshes.push_back(mixWinding(makeSheet(1024)));
+
+		// around the meshes, none inside a bounding sphere
+		const glm::vec3 cameraPositions[] = {
+			{ 0.f, 3.f, 0.f }, { 0.f, -3.f, 0.f }, { 3.f, .5f, 0.f }, { -2.f, 1.f, 2.f }, { 1.f, .2f, -4.f } };
+
+		std::printf("%-20s %10s %9s %9s %10s %10s %10s %11s\n",
+			"mesh", "triangles", "meshlets", "avg vtx", "avg tri", "no cone %", "build ms", "backface %");
+
+		bool allValid = true;
+		for (OvrBenchmarkMesh& mesh : meshes) {
+			OvrMeshOptimizer::optimize(mesh.vertices, mesh.indices);
+			const auto originalTriangles = sortedTriangles(mesh.indices);
+
+			std::vector<OvrModel::Meshlet> meshlets;
+			const double buildMs = measureMs(1, [&]() {
+				meshlets = OvrMeshletBuilder::build(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+			});
+			allValid &= sortedTriangles(mesh.indices) == originalTriangles;
+
+			// in index order, within the limits, bounds holding their vertices and normals
+			uint32_t nextIndex = 0;
+			size_t vertexTotal = 0;
+			size_t noCone = 0;
+			for (const OvrModel::Meshlet& meshlet : meshlets) {
+				allValid &= meshlet.firstIndex == nextIndex && meshlet.triangleCount > 0 &&
+					meshlet.triangleCount <= OvrMeshletBuilder::MAX_TRIANGLES &&
+					meshlet.vertexCount <= OvrMeshletBuilder::MAX_VERTICES;
+				nextIndex += meshlet.triangleCount * 3;
+				vertexTotal += meshlet.vertexCount;
+				noCone += meshlet.cone.w > 1.f;
+
+				std::vector<uint32_t> unique(mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + nextIndex);
+				std::sort(unique.begin(), unique.end());
+				allValid &= static_cast<uint32_t>(std::unique(unique.begin(), unique.end()) - unique.begin()) == meshlet.vertexCount;
+
+				const glm::vec3 center{ meshlet.boundingSphere };
+				const float cosSpread = std::sqrt(std::max(0.f, 1.f - meshlet.cone.w * meshlet.cone.w));
+				for (uint32_t i = meshlet.firstIndex; i < nextIndex; i += 3) {
+					const glm::vec3& p0 = mesh.vertices[mesh.indices[i]].position;
+					const glm::vec3& p1 = mesh.vertices[mesh.indices[i + 1]].position;
+					const glm::vec3& p2 = mesh.vertices[mesh.indices[i + 2]].position;
+					for (const glm::vec3* p : { &p0, &p1, &p2 }) {
+						allValid &= glm::length(*p - center) <= meshlet.boundingSphere.w * 1.0001f + 1e-6f;
+					}
+					const glm::vec3 normal = facingNormal(mesh, i);
+					if (meshlet.cone.w <= 1.f && glm::length(normal) > 0.f) {
+						allValid &= glm::dot(glm::normalize(normal), glm::vec3{ meshlet.cone }) >= cosSpread - 1e-4f;
+					}
+				}
+			}
+			allValid &= nextIndex == mesh.indices.size();
+
+			// a backfacing meshlet must not have a single triangle facing the camera
+			size_t culledTotal = 0;
+			for (const glm::vec3& camera : cameraPositions) {
+				for (const OvrModel::Meshlet& meshlet : meshlets) {
+					if (!OvrMeshletBuilder::isBackfacing(meshlet, camera)) {
+						continue;
+					}
+					culledTotal++;
+					for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.triangleCount * 3; i += 3) {
+						const glm::vec3& p0 = mesh.vertices[mesh.indices[i]].position;
+						const glm::vec3 normal = facingNormal(mesh, i);
+						allValid &= glm::dot(normal, p0 - camera) >= -1e-6f * glm::length(normal);
+					}
+				}
+			}
+
+			std::printf("%-20s %10zu %9zu %9.1f %10.1f %10.1f %10.1f %11.1f\n",
+				mesh.name.c_str(), mesh.indices.size() / 3, meshlets.size(),
+				static_cast<double>(vertexTotal) / meshlets.size(),
+				static_cast<double>(mesh.indices.size() / 3) / meshlets.size(),
+				100.0 * noCone / meshlets.size(), buildMs,
+				100.0 * culledTotal / (meshlets.size() * std::size(cameraPositions)));
+		}
+
+		if (!allValid) {
+			std::printf("meshlets are out of limits, lost triangles or have bounds that don't hold them!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
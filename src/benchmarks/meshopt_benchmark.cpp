@@ -0,0 +1,125 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "benchmarks/benchmark_meshes.h"
+#include "ovr_mesh_optimizer.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ovr {
+	// rows of quads in the order an exporter writes them
+	static OvrBenchmarkMesh makeGrid(uint32_t size) {
+		OvrBenchmarkMesh mesh{};
+		mesh.name = "grid " + std::to_string(size);
+		for (uint32_t y = 0; y <= size; y++) {
+			for (uint32_t x = 0; x <= size; x++) {
+				OvrModel::Vertex vertex{};
+				vertex.position = { static_cast<float>(x), 0.f, static_cast<float>(y) };
+				vertex.normal = { 0.f, 1.f, 0.f };
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				uint32_t v0 = y * (size + 1) + x;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + size + 1;
+				uint32_t v3 = v2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		}
+		return mesh;
+	}
+
+	// the same mesh with its triangles in random order, the worst case for the cache
+	static OvrBenchmarkMesh shuffleTriangles(OvrBenchmarkMesh mesh) {
+		std::vector<std::array<uint32_t, 3>> triangles(mesh.indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); i++) {
+			triangles[i] = { mesh.indices[i * 3], mesh.indices[i * 3 + 1], mesh.indices[i * 3 + 2] };
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937{ 7 });
+		for (size_t i = 0; i < triangles.size(); i++) {
+			std::copy(triangles[i].begin(), triangles[i].end(), mesh.indices.begin() + i * 3);
+		}
+		mesh.name += " shuffled";
+		return mesh;
+	}
+
+	// the triangles as vertex data, sorted, to check that reordering kept every one with its winding
+	static std::vector<std::array<float, 9>> triangleSet(const OvrBenchmarkMesh& mesh) {
+		std::vector<std::array<float, 9>> triangles(mesh.indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); i++) {
+			for (int corner = 0; corner < 3; corner++) {
+				const glm::vec3& position = mesh.vertices[mesh.indices[i * 3 + corner]].position;
+				triangles[i][corner * 3 + 0] = position.x;
+				triangles[i][corner * 3 + 1] = position.y;
+				triangles[i][corner * 3 + 2] = position.z;
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	int runMeshOptBenchmark() {
+		std::vector<OvrBenchmarkMesh> meshes;
+		meshes.push_back(makeGrid(512));
+		meshes.push_back(shuffleTriangles(makeGrid(512)));
+		meshes.push_back(makeSphere(256, 512));
+		meshes.push_back(shuffleTriangles(makeSphere(256, 512)));
+
+		std::printf("%-24s %10s %12s %12s %12s %12s %10s %10s %10s\n",
+			"mesh", "triangles", "ACMR before", "ACMR after", "ATVR before", "ATVR after",
+			"cache ms", "overdraw ms", "fetch ms");
+
+		bool allMatch = true;
+		for (OvrBenchmarkMesh& mesh : meshes) {
+			const auto originalTriangles = triangleSet(mesh);
+			const OvrVertexCacheStats before = OvrMeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+			std::vector<uint32_t> clusters;
+			double cacheMs = measureMs(1, [&]() {
+				clusters = OvrMeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+			});
+			double overdrawMs = measureMs(1, [&]() {
+				OvrMeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+			});
+			double fetchMs = measureMs(1, [&]() {
+				OvrMeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices);
+			});
+			const OvrVertexCacheStats after = OvrMeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+			allMatch &= triangleSet(mesh) == originalTriangles;
+
+			// after the fetch reorder every vertex is first used in order
+			uint32_t nextNew = 0;
+			for (uint32_t index : mesh.indices) {
+				allMatch &= index <= nextNew;
+				nextNew = std::max(nextNew, index + 1);
+			}
+
+			std::printf("%-24s %10zu %12.3f %12.3f %12.3f %12.3f %10.1f %10.1f %10.1f\n",
+				mesh.name.c_str(), mesh.indices.size() / 3,
+				before.acmr, after.acmr, before.atvr, after.atvr,
+				cacheMs, overdrawMs, fetchMs);
+		}
+
+		if (!allMatch) {
+			std::printf("optimized meshes lost or changed triangles!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,206 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+// tinyobj is only the reference here, the models load through OvrObjParser
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "benchmarks/benchmarks.h"
+#include "ovr_job_system.h"
+#include "ovr_obj_parser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ovr {
+	// Writes a grid mesh of roughly targetBytes as OBJ, with the variety real exporters produce:
+	// vertex colors, fixed and exponent notation, quads and triangles, relative indices, groups,
+	// materials, comments and CRLF line endings
+	static void writeObjFile(const std::string& path, uint64_t targetBytes) {
+		constexpr int GRID = 64;
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (file == nullptr) {
+			throw std::runtime_error("failed to create benchmark file: " + path);
+		}
+		std::mt19937 random{ 42 };
+		std::uniform_real_distribution<float> offset{ -.5f, .5f };
+		std::string text;
+		char line[256];
+		uint64_t written = 0;
+		uint64_t vertexCount = 0;
+		auto append = [&](int length) { text.append(line, static_cast<size_t>(length)); };
+
+		text += "# OVRenderer OBJ parser benchmark\n";
+		for (uint32_t block = 0; written + text.size() < targetBytes; block++) {
+			const char* newline = block % 5 == 4 ? "\r\n" : "\n";
+			append(std::snprintf(line, sizeof(line), "g block_%u%s", block, newline));
+			append(std::snprintf(line, sizeof(line), "usemtl material_%u%s", block % 3, newline));
+			for (int y = 0; y < GRID; y++) {
+				for (int x = 0; x < GRID; x++) {
+					float px = block * GRID + x + offset(random);
+					float py = y + offset(random);
+					float pz = offset(random) * 1e-3f;
+					if ((x + y) % 7 == 0) {
+						append(std::snprintf(line, sizeof(line), "v %.6f %.6f %.4e %.3f %.3f %.3f%s",
+							px, py, pz, x / float(GRID), y / float(GRID), .5f, newline));
+					}
+					else if ((x + y) % 11 == 0) {
+						append(std::snprintf(line, sizeof(line), "v %d %.2f %.7E%s", static_cast<int>(px), py, pz, newline));
+					}
+					else {
+						append(std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f%s", px, py, pz, newline));
+					}
+					append(std::snprintf(line, sizeof(line), "vt %.5f %.5f%s", x / float(GRID - 1), y / float(GRID - 1), newline));
+					append(std::snprintf(line, sizeof(line), "vn %.4f %.4f %.4f%s", offset(random) * .1f, offset(random) * .1f, 1.f, newline));
+				}
+			}
+			// every third block indexes relative to the end of its vertices
+			const bool relative = block % 3 == 2;
+			const int64_t blockVertices = GRID * GRID;
+			for (int y = 0; y + 1 < GRID; y++) {
+				for (int x = 0; x + 1 < GRID; x++) {
+					int64_t corners[4] = { y * GRID + x, y * GRID + x + 1, (y + 1) * GRID + x + 1, (y + 1) * GRID + x };
+					for (int64_t& corner : corners) {
+						corner = relative ? corner - blockVertices : static_cast<int64_t>(vertexCount) + corner + 1;
+					}
+					long long a = corners[0], b = corners[1], c = corners[2], d = corners[3];
+					if ((x + y) % 4 == 0) {
+						append(std::snprintf(line, sizeof(line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld%s",
+							a, a, a, b, b, b, c, c, c, d, d, d, newline));
+					}
+					else {
+						append(std::snprintf(line, sizeof(line), "f %lld//%lld %lld//%lld %lld//%lld%s", a, a, b, b, c, c, newline));
+						append(std::snprintf(line, sizeof(line), "f  %lld/%lld %lld/%lld %lld/%lld  %s", a, a, c, c, d, d, newline));
+					}
+				}
+			}
+			vertexCount += blockVertices;
+
+			if (text.size() > (8u << 20)) {
+				written += std::fwrite(text.data(), 1, text.size(), file);
+				text.clear();
+			}
+		}
+		written += std::fwrite(text.data(), 1, text.size(), file);
+		std::fclose(file);
+	}
+
+	static bool loadReference(const std::string& path, OvrObjData& data) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str())) {
+			return false;
+		}
+		data.positions = std::move(attrib.vertices);
+		data.colors = std::move(attrib.colors);
+		data.normals = std::move(attrib.normals);
+		data.texcoords = std::move(attrib.texcoords);
+		data.corners.clear();
+		for (const auto& shape : shapes) {
+			for (const auto& index : shape.mesh.indices) {
+				data.corners.push_back({ index.vertex_index, index.texcoord_index, index.normal_index });
+			}
+		}
+		return true;
+	}
+
+	template <typename T>
+	static bool sameBits(const std::vector<T>& a, const std::vector<T>& b) {
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	static bool sameObjData(const OvrObjData& a, const OvrObjData& b) {
+		return sameBits(a.positions, b.positions) && sameBits(a.colors, b.colors) && sameBits(a.normals, b.normals) &&
+			sameBits(a.texcoords, b.texcoords) && sameBits(a.corners, b.corners);
+	}
+
+	int runObjBenchmark() {
+		constexpr uint64_t MB = 1 << 20;
+		const uint64_t sizesMb[] = { 64, 512, 2048 };
+		constexpr uint64_t REFERENCE_LIMIT_MB = 512; // tinyobj needs several times the file size in memory
+
+		std::vector<uint32_t> threadCounts;
+		const uint32_t maxThreads = std::min(64u, std::max(1u, std::thread::hardware_concurrency()));
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		const std::string path = (directory / "ovr_obj_benchmark.obj").string();
+
+		std::printf("%8s %12s %8s %12s %10s %8s %10s\n",
+			"size MB", "tinyobj ms", "threads", "parse ms", "MB/s", "speedup", "triangles");
+
+		bool allMatch = true;
+		for (uint64_t sizeMb : sizesMb) {
+			std::error_code error;
+			auto space = std::filesystem::space(directory, error);
+			if (error || space.available < sizeMb * MB * 2) {
+				std::printf("%8llu skipped, not enough space in %s\n", static_cast<unsigned long long>(sizeMb), directory.string().c_str());
+				continue;
+			}
+			writeObjFile(path, sizeMb * MB);
+			const double fileMb = static_cast<double>(std::filesystem::file_size(path)) / MB;
+
+			// above the limit the threaded runs are checked against the single threaded one instead
+			OvrObjData reference{};
+			bool haveReference = false;
+			double referenceMs = 0.0;
+			if (sizeMb <= REFERENCE_LIMIT_MB) {
+				referenceMs = measureMs(1, [&]() { haveReference = loadReference(path, reference); });
+				allMatch &= haveReference;
+			}
+
+			double baseMs = 0.0;
+			for (uint32_t threadCount : threadCounts) {
+				OvrJobSystem jobSystem{ threadCount };
+				OvrObjData parsed{};
+				double parseMs = measureMs(1, [&]() { parsed = OvrObjParser::parseFile(path, &jobSystem); });
+				if (haveReference) {
+					allMatch &= sameObjData(parsed, reference);
+				}
+				else {
+					reference = std::move(parsed);
+					haveReference = true;
+				}
+
+				if (threadCount == 1) {
+					baseMs = parseMs;
+				}
+				if (referenceMs > 0.0 && threadCount == threadCounts.front()) {
+					std::printf("%8.0f %12.1f", fileMb, referenceMs);
+				}
+				else {
+					std::printf("%8.0f %12s", fileMb, "-");
+				}
+				std::printf(" %8u %12.1f %10.1f %8.2f %10zu\n",
+					threadCount,
+					parseMs,
+					fileMb / (parseMs / 1000.0),
+					baseMs / parseMs,
+					reference.corners.size() / 3);
+			}
+			std::filesystem::remove(path, error);
+		}
+
+		if (!allMatch) {
+			std::printf("OBJ parser results disagree with tinyobj!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
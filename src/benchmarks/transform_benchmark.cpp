@@ -0,0 +1,152 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "ovr_cpu_features.h"
+#include "ovr_game_object.h"
+#include "ovr_transform_batch.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace ovr {
+	// largest element difference relative to the largest element of the reference matrix
+	static float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& reference) {
+		float difference = 0.f;
+		for (size_t i = 0; i < a.size(); i++) {
+			float magnitude = 0.f;
+			float elementDifference = 0.f;
+			for (int column = 0; column < 4; column++) {
+				for (int row = 0; row < 4; row++) {
+					magnitude = std::max(magnitude, std::abs(reference[i][column][row]));
+					elementDifference = std::max(elementDifference, std::abs(a[i][column][row] - reference[i][column][row]));
+				}
+			}
+			difference = std::max(difference, elementDifference / magnitude);
+		}
+		return difference;
+	}
+
+	int runTransformBenchmark() {
+		const uint32_t objectCounts[] = { 1000, 10000, 100000, 1000000 };
+		const OvrTransformKernel kernels[] = { OvrTransformKernel::Scalar, OvrTransformKernel::SSE41, OvrTransformKernel::AVX2 };
+		const char* kernelNames[] = { "scalar", "sse4.1", "avx2" };
+		const auto& features = OvrCpuFeatures::get();
+		const bool kernelSupported[] = { true, features.sse41, features.avx2 && features.fma };
+
+		std::printf("%10s %22s %12s %14s %12s\n", "objects", "path", "ms", "M objects/s", "max error");
+
+		bool withinTolerance = true;
+		for (uint32_t objectCount : objectCounts) {
+			// about the same total work for every size
+			const uint32_t iterations = std::max(1u, 10000000u / objectCount);
+
+			std::mt19937 random{ objectCount };
+			std::uniform_real_distribution<float> position{ -100.f, 100.f };
+			std::uniform_real_distribution<float> angle{ -glm::pi<float>(), glm::pi<float>() };
+			std::uniform_real_distribution<float> size{ .1f, 4.f };
+			std::vector<glm::vec3> translations(objectCount), rotations(objectCount), scales(objectCount);
+			for (uint32_t i = 0; i < objectCount; i++) {
+				translations[i] = { position(random), position(random), position(random) };
+				rotations[i] = { angle(random), angle(random), angle(random) };
+				scales[i] = { size(random), size(random), size(random) };
+			}
+			const glm::mat4 projectionView = glm::perspective(glm::radians(50.f), 16.f / 9.f, .1f, 1000.f) *
+				glm::lookAt(glm::vec3{ 0.f, -50.f, -200.f }, glm::vec3{ 0.f }, glm::vec3{ 0.f, -1.f, 0.f });
+
+			auto report = [&](const char* path, double totalMs, float error) {
+				double ms = totalMs / iterations;
+				std::printf("%10u %22s %12.3f %14.1f %12.2e\n",
+					objectCount, path, ms, objectCount / ms / 1000.0, error);
+			};
+
+			// what renderGameObjects used to do per object every frame
+			std::vector<glm::mat4> referenceMvp(objectCount), referenceNormal(objectCount), referenceWorld(objectCount);
+			auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+				for (uint32_t i = 0; i < objectCount; i++) {
+					referenceWorld[i] = TransformComponent::makeMat4(translations[i], rotations[i], scales[i]);
+					referenceMvp[i] = projectionView * referenceWorld[i];
+					referenceNormal[i] = glm::mat4(TransformComponent::makeNormalMatrix(rotations[i], scales[i]));
+				}
+			}
+			report("per object", std::chrono::duration<double, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count(), 0.f);
+
+			std::vector<glm::mat4> world(objectCount), normal(objectCount), mvp(objectCount);
+			for (int k = 0; k < 3; k++) {
+				if (!kernelSupported[k]) {
+					continue;
+				}
+				OvrTransformBatch batch{};
+				batch.translations = translations.data();
+				batch.rotations = rotations.data();
+				batch.scales = scales.data();
+				batch.count = objectCount;
+				batch.worldMatrices = world.data();
+				batch.normalMatrices = normal.data();
+				batch.mvpMatrices = mvp.data();
+				batch.projectionView = projectionView;
+
+				start = std::chrono::high_resolution_clock::now();
+				for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+					computeTransforms(batch, kernels[k]);
+				}
+				double totalMs = std::chrono::duration<double, std::milli>(
+					std::chrono::high_resolution_clock::now() - start).count();
+				float error = std::max(maxDifference(mvp, referenceMvp), maxDifference(normal, referenceNormal));
+				withinTolerance &= error < 1e-5f;
+				char path[32];
+				std::snprintf(path, sizeof(path), "batch %s", kernelNames[k]);
+				report(path, totalMs, error);
+			}
+
+			// world matrices already cached, only the projection-view product per frame
+			start = std::chrono::high_resolution_clock::now();
+			for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+				for (uint32_t i = 0; i < objectCount; i++) {
+					referenceMvp[i] = projectionView * referenceWorld[i];
+				}
+			}
+			report("cached, per object", std::chrono::duration<double, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count(), 0.f);
+
+			for (int k = 0; k < 3; k++) {
+				if (!kernelSupported[k]) {
+					continue;
+				}
+				start = std::chrono::high_resolution_clock::now();
+				for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+					multiplyMatrices(projectionView, referenceWorld.data(), objectCount, mvp.data(), kernels[k]);
+				}
+				double totalMs = std::chrono::duration<double, std::milli>(
+					std::chrono::high_resolution_clock::now() - start).count();
+				float error = maxDifference(mvp, referenceMvp);
+				withinTolerance &= error < 1e-5f;
+				char path[32];
+				std::snprintf(path, sizeof(path), "cached, %s", kernelNames[k]);
+				report(path, totalMs, error);
+			}
+		}
+
+		if (!withinTolerance) {
+			std::printf("batch transforms disagree with the per object path!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,129 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "benchmarks/benchmarks.h"
+#include "benchmarks/benchmark_meshes.h"
+#include "ovr_vertex_compression.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ovr {
+	// the shared sphere displaced and moved far from the origin, so positions use the whole quantization range
+	static OvrBenchmarkMesh makeDisplacedSphere(uint32_t stacks, uint32_t slices, bool colored) {
+		OvrBenchmarkMesh mesh = makeSphere(stacks, slices, colored);
+		for (auto& vertex : mesh.vertices) {
+			float theta = vertex.uv.x * glm::two_pi<float>();
+			float phi = vertex.uv.y * glm::pi<float>();
+			vertex.position = glm::vec3{ 1000.f, -20.f, 350.f } +
+				vertex.normal * (25.f + std::sin(theta * 7.f) * std::cos(phi * 5.f));
+		}
+		return mesh;
+	}
+
+	// random unit normals, the octahedral encoding's worst cases are not on a sphere's grid
+	static OvrBenchmarkMesh makeRandomNormals(uint32_t count) {
+		OvrBenchmarkMesh mesh{};
+		mesh.name = "random normals " + std::to_string(count);
+		std::mt19937 random{ 11 };
+		std::normal_distribution<float> gaussian{ 0.f, 1.f };
+		std::uniform_real_distribution<float> uniform{ -4.f, 4.f };
+		mesh.vertices.resize(count);
+		for (auto& vertex : mesh.vertices) {
+			glm::vec3 normal{ gaussian(random), gaussian(random), gaussian(random) };
+			vertex.normal = glm::length(normal) > 0.f ? glm::normalize(normal) : glm::vec3{ 0.f, 1.f, 0.f };
+			vertex.position = { uniform(random), uniform(random), uniform(random) };
+			vertex.color = glm::vec3{ 1.f };
+			vertex.uv = { uniform(random), uniform(random) }; // a few repeats of the texture
+		}
+		return mesh;
+	}
+
+	int runVertexFormatBenchmark() {
+		std::vector<OvrBenchmarkMesh> meshes;
+		meshes.push_back(makeDisplacedSphere(1024, 2048, false));
+		meshes.push_back(makeDisplacedSphere(1024, 2048, true));
+		meshes.push_back(makeRandomNormals(1 << 21));
+
+		std::printf("%-28s %10s %14s %14s %8s %10s %14s %14s %12s\n",
+			"mesh", "vertices", "float bytes", "compressed", "saved", "encode ms",
+			"position err", "normal err deg", "uv err");
+
+		bool allWithinBounds = true;
+		for (const OvrBenchmarkMesh& mesh : meshes) {
+			const OvrModel::Bounds bounds = OvrModel::Bounds::fromVertices(mesh.vertices);
+			const OvrModel::Dequantization dequantization = OvrVertexCompression::getDequantization(bounds);
+			const bool withColor = OvrVertexCompression::hasVertexColors(mesh.vertices.data(), mesh.vertices.size());
+
+			std::vector<OvrModel::CompressedVertex> compressed;
+			std::vector<uint32_t> colors;
+			double encodeMs = measureMs(1, [&]() {
+				OvrVertexCompression::compress(mesh.vertices.data(), mesh.vertices.size(), dequantization,
+					compressed, withColor ? &colors : nullptr);
+			});
+
+			// position error relative to the largest bounds extent, angle between normals, uv difference
+			const glm::vec3 extent = bounds.max - bounds.min;
+			const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+			float positionError = 0.f;
+			float normalError = 0.f;
+			float uvError = 0.f;
+			float uvMagnitude = 0.f;
+			for (size_t i = 0; i < mesh.vertices.size(); i++) {
+				const OvrModel::Vertex& vertex = mesh.vertices[i];
+				const glm::vec3 position = OvrVertexCompression::decodePosition(compressed[i], dequantization);
+				const glm::vec3 difference = glm::abs(position - vertex.position);
+				positionError = std::max(positionError, std::max(difference.x, std::max(difference.y, difference.z)) / maxExtent);
+				const glm::vec3 normal = OvrVertexCompression::decodeOctahedral(compressed[i].normal);
+				// atan2 in double, acos of a float dot product can't resolve a hundredth of a degree
+				const glm::dvec3 decoded = glm::normalize(glm::dvec3{ normal });
+				const glm::dvec3 original = glm::normalize(glm::dvec3{ vertex.normal });
+				const double angle = std::atan2(glm::length(glm::cross(decoded, original)), glm::dot(decoded, original));
+				normalError = std::max(normalError, static_cast<float>(glm::degrees(angle)));
+				const glm::vec2 uvDifference = glm::abs(OvrVertexCompression::decodeUv(compressed[i]) - vertex.uv);
+				uvError = std::max(uvError, std::max(uvDifference.x, uvDifference.y));
+				uvMagnitude = std::max(uvMagnitude, std::max(std::abs(vertex.uv.x), std::abs(vertex.uv.y)));
+			}
+
+			const size_t floatBytes = sizeof(OvrModel::Vertex) * mesh.vertices.size();
+			const size_t compressedBytes = (sizeof(OvrModel::CompressedVertex) + (withColor ? sizeof(uint32_t) : 0)) *
+				mesh.vertices.size();
+			const double saved = 1.0 - static_cast<double>(compressedBytes) / floatBytes;
+
+			// float rounding of offset + unorm * scale, a few ulps of the largest coordinate
+			const float maxCoordinate = std::max(glm::length(bounds.min), glm::length(bounds.max));
+			const float positionRounding = 4.f * maxCoordinate * std::numeric_limits<float>::epsilon() / maxExtent;
+
+			// half a quantization step for positions (plus that rounding), half float's 11 bit mantissa
+			// for uvs, and the rounding error of 2x16 bit octahedral normals (just under 0.005 degrees)
+			allWithinBounds &= saved > .5;
+			allWithinBounds &= positionError <= .5f / OvrVertexCompression::POSITION_STEPS + positionRounding;
+			allWithinBounds &= uvError <= std::exp2(std::floor(std::log2(std::max(uvMagnitude, 1e-3f)))) * std::exp2(-11.f);
+			allWithinBounds &= normalError <= .005f;
+
+			std::printf("%-28s %10zu %14zu %14zu %7.1f%% %10.1f %14.3g %14.5f %12.3g\n",
+				mesh.name.c_str(), mesh.vertices.size(), floatBytes, compressedBytes, saved * 100.0, encodeMs,
+				positionError, normalError, uvError);
+		}
+
+		if (!allWithinBounds) {
+			std::printf("compressed vertices lost too much precision or saved too little memory!\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
@@ -0,0 +1,596 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "gpu_driven_render_system.h"
+#include "ovr_command_recorder.h"
+#include "ovr_lod_selector.h"
+#include "ovr_swap_chain.h"
+#include "ovr_vertex_layout.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace ovr {
+	// must match the structs in shaders/gpu_cull.comp (std430)
+	struct GpuObjectData {
+		glm::mat4 modelMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
+		glm::vec4 boundingSphere{ 0.f }; // model space
+		uint32_t drawIndex = 0;
+		uint32_t padding[3]{};
+	};
+	static_assert(sizeof(GpuObjectData) == 160, "GpuObjectData must match the std430 layout");
+
+	// must match shaders/gpu_cluster_cull.comp
+	struct GpuClusterJob {
+		uint32_t objectIndex;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t drawOffset;
+		uint32_t countIndex;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+
+	// both cull passes
+	struct CullPushConstantData {
+		glm::vec4 frustumPlanes[6];
+		glm::vec4 cameraPosition;
+		uint32_t objectCount;
+		uint32_t clusterJobCount;
+		uint32_t coneCulling;
+	};
+	static_assert(sizeof(CullPushConstantData) <= 128, "CullPushConstantData must fit the guaranteed push constant size");
+
+	struct GpuDrivenPushConstantData {
+		glm::mat4 projectionView{ 1.f };
+		OvrModel::Dequantization dequantization{}; // pushed again for every model
+	};
+
+	// vertex shader per OvrModel::VertexFormat, the same as SimpleRenderSystem's
+	static const char* const VERTEX_SHADERS[OvrModel::VERTEX_FORMAT_COUNT] = {
+		"resources/shaders/simple_shader.vert.spv",
+		"resources/shaders/compressed_shader.vert.spv",
+		"resources/shaders/compressed_color_shader.vert.spv" };
+
+	static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+	static constexpr uint32_t CLUSTER_JOB_SIZE = 64;           // meshlets per workgroup of the cluster pass
+	static constexpr uint32_t MAX_WORKGROUPS_X = 65535;        // the least maxComputeWorkGroupCount[0] allowed
+	static constexpr uint32_t CULL_BINDING_COUNT = 9;
+
+	GpuDrivenRenderSystem::GpuDrivenRenderSystem(OVRDevice &device, VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder)
+		: ovrDevice(device) {
+		createDescriptorResources();
+		createCullPipelines();
+		createPipelineLayout();
+		createPipeline(renderPass, pipelineBuilder);
+	}
+
+	GpuDrivenRenderSystem::~GpuDrivenRenderSystem() {
+		for (auto& ovrPipeline : ovrPipelines) {
+			if (ovrPipeline.valid()) {
+				ovrPipeline.get(); // the layout must outlive a compile still in flight
+			}
+		}
+		for (auto& frame : frames) {
+			destroyBuffer(frame.objects);
+			destroyBuffer(frame.draws);
+			destroyBuffer(frame.instances);
+			destroyBuffer(frame.stats);
+			destroyBuffer(frame.objectInstances);
+			destroyBuffer(frame.meshlets);
+			destroyBuffer(frame.clusterJobs);
+			destroyBuffer(frame.clusterDraws);
+			destroyBuffer(frame.clusterCounts);
+		}
+		vkDestroyPipeline(ovrDevice.device(), cullPipeline, nullptr);
+		vkDestroyPipeline(ovrDevice.device(), clusterCullPipeline, nullptr);
+		vkDestroyPipelineLayout(ovrDevice.device(), cullPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(ovrDevice.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(ovrDevice.device(), descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(ovrDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::createDescriptorResources()
+	{
+		// objects, draws, instances, stats, then the object instances and cluster pass buffers
+		std::array<VkDescriptorSetLayoutBinding, CULL_BINDING_COUNT> bindings{};
+		for (uint32_t i = 0; i < CULL_BINDING_COUNT; i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(ovrDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = CULL_BINDING_COUNT * OVRSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = OVRSwapChain::MAX_FRAMES_IN_FLIGHT;
+		if (vkCreateDescriptorPool(ovrDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		frames.resize(OVRSwapChain::MAX_FRAMES_IN_FLIGHT);
+		std::vector<VkDescriptorSetLayout> layouts(frames.size(), descriptorSetLayout);
+		std::vector<VkDescriptorSet> sets(frames.size());
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		allocInfo.pSetLayouts = layouts.data();
+		if (vkAllocateDescriptorSets(ovrDevice.device(), &allocInfo, sets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate descriptor sets!");
+		}
+		for (size_t i = 0; i < frames.size(); i++) {
+			frames[i].descriptorSet = sets[i];
+		}
+	}
+
+	void GpuDrivenRenderSystem::createCullPipelines()
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(ovrDevice.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) !=
+			VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+
+		cullShaderModule = ovrDevice.shaderCache().acquire("resources/shaders/gpu_cull.comp.spv");
+		clusterCullShaderModule = ovrDevice.shaderCache().acquire("resources/shaders/gpu_cluster_cull.comp.spv");
+		cullPipeline = createComputePipeline(*cullShaderModule);
+		clusterCullPipeline = createComputePipeline(*clusterCullShaderModule);
+	}
+
+	VkPipeline GpuDrivenRenderSystem::createComputePipeline(const OvrShaderModule& shaderModule)
+	{
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule.module();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = cullPipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VkPipeline pipeline;
+		if (vkCreateComputePipelines(ovrDevice.device(), ovrDevice.pipelineCache(), 1, &pipelineInfo, nullptr,
+			&pipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+		return pipeline;
+	}
+
+	void GpuDrivenRenderSystem::createPipelineLayout()
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(GpuDrivenPushConstantData);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 0;
+		pipelineLayoutInfo.pSetLayouts = nullptr;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(ovrDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+			VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void GpuDrivenRenderSystem::createPipeline(VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder)
+	{
+		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		// same shaders as SimpleRenderSystem, the instance stream is written by the cull pass
+		auto instanceBindings = OvrModel::InstanceData::getBindingDescriptions();
+		auto instanceAttributes = OvrModel::InstanceData::getAttributeDescriptions();
+		for (uint32_t vertexLayout = 0; vertexLayout < OvrModel::VERTEX_LAYOUT_COUNT; vertexLayout++) {
+			auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+			OvrPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+
+			pipelineConfig->renderPass = renderPass;
+			pipelineConfig->pipelineLayout = pipelineLayout;
+
+			OvrFullVertexLayout::apply(*pipelineConfig, vertexLayout);
+			pipelineConfig->bindingDescriptions.insert(
+				pipelineConfig->bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+			pipelineConfig->attributeDescriptions.insert(
+				pipelineConfig->attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+
+			ovrPipelines[vertexLayout] = pipelineBuilder.requestPipeline(
+				VERTEX_SHADERS[static_cast<uint32_t>(OvrModel::getVertexFormat(vertexLayout))],
+				"resources/shaders/simple_shader.frag.spv",
+				std::move(pipelineConfig));
+		}
+	}
+
+	bool GpuDrivenRenderSystem::reserveBuffer(
+		GpuBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+	{
+		if (size <= buffer.size) {
+			return false;
+		}
+		// the frame that last used this buffer has finished, beginFrame waited on its fence
+		destroyBuffer(buffer);
+		buffer.size = std::max(size, buffer.size * 2);
+		ovrDevice.createBuffer(buffer.size, usage, properties, buffer.buffer, buffer.allocation);
+		return true;
+	}
+
+	void GpuDrivenRenderSystem::destroyBuffer(GpuBuffer& buffer)
+	{
+		if (buffer.buffer != VK_NULL_HANDLE) {
+			ovrDevice.destroyBuffer(buffer.buffer, buffer.allocation);
+		}
+		buffer = GpuBuffer{};
+	}
+
+	void GpuDrivenRenderSystem::writeDescriptorSet(FrameResources& frame)
+	{
+		std::array<VkDescriptorBufferInfo, CULL_BINDING_COUNT> bufferInfos{ {
+			{ frame.objects.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.draws.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.instances.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.stats.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.objectInstances.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.meshlets.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.clusterJobs.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.clusterDraws.buffer, 0, VK_WHOLE_SIZE },
+			{ frame.clusterCounts.buffer, 0, VK_WHOLE_SIZE } } };
+
+		std::array<VkWriteDescriptorSet, CULL_BINDING_COUNT> writes{};
+		for (uint32_t i = 0; i < CULL_BINDING_COUNT; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(ovrDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::cullGameObjects(FrameInfo& frameInfo, const OvrScene& scene)
+	{
+		auto& frame = frames[frameInfo.frameIndex];
+		if (frame.statsValid) { // the fence of this frame index signaled in beginFrame
+			lastVisibleCount = *static_cast<const uint32_t*>(frame.stats.allocation.mapped);
+			const auto* counts = static_cast<const uint32_t*>(frame.clusterCounts.allocation.mapped);
+			lastVisibleClusterCount = 0;
+			for (uint32_t i = 0; i < frame.clusterCountCount; i++) {
+				lastVisibleClusterCount += counts[i];
+			}
+		}
+
+		// one draw command per model and level of detail, its instances get a contiguous range of the
+		// instance buffer
+		models.clear();
+		drawLods.clear();
+		lodDrawOffsets.resize(scene.modelCount() + 1);
+		lodDrawOffsets[0] = 0;
+		for (OvrScene::ModelHandle handle = 0; handle < scene.modelCount(); handle++) {
+			lodDrawOffsets[handle + 1] = lodDrawOffsets[handle] + scene.getModel(handle)->getLodCount();
+		}
+		modelDrawIndices.assign(lodDrawOffsets.back(), OvrScene::INVALID_INDEX);
+		objectDrawIndices.clear();
+		std::vector<uint32_t> instanceCounts;
+		uint32_t objectCount = 0;
+		lastTriangleCount = 0;
+		lastFullTriangleCount = 0;
+		for (uint32_t i = 0; i < scene.size(); i++) {
+			OvrScene::ModelHandle handle = scene.getModelHandles()[i];
+			if (handle == OvrScene::NO_MODEL) {
+				continue;
+			}
+			OvrModel* model = scene.getModel(handle);
+			assert(model->hasIndices() && "GPU driven rendering needs indexed models");
+			const uint32_t lod = lodSelector != nullptr ? lodSelector->select(scene, i) : 0;
+			uint32_t& drawIndex = modelDrawIndices[lodDrawOffsets[handle] + lod];
+			if (drawIndex == OvrScene::INVALID_INDEX) {
+				drawIndex = static_cast<uint32_t>(models.size());
+				models.push_back(model);
+				drawLods.push_back(lod);
+				instanceCounts.push_back(0);
+			}
+			instanceCounts[drawIndex]++;
+			objectDrawIndices.push_back(drawIndex);
+			objectCount++;
+			lastFullTriangleCount += model->getIndexCount() / 3;
+			lastTriangleCount += model->getLods()[lod].indexCount / 3;
+		}
+		lastObjectCount = objectCount;
+		if (objectCount == 0) {
+			frame.statsValid = false;
+			return;
+		}
+
+		// clustered models at level 0: a range of commands big enough for every meshlet of every instance
+		const bool clusters = clusterCulling && ovrDevice.supportsMultiDrawIndirect();
+		clusterRanges.assign(models.size(), ClusterRange{});
+		std::vector<const OvrModel*> meshletModels;
+		std::vector<uint32_t> firstMeshlets(models.size(), 0);
+		uint32_t meshletCount = 0;
+		uint32_t clusterDrawCount = 0;
+		uint32_t clusterJobCount = 0;
+		lastClusterCount = 0;
+		for (size_t i = 0; clusters && i < models.size(); i++) {
+			const uint32_t modelMeshlets = static_cast<uint32_t>(models[i]->getMeshlets().size());
+			if (modelMeshlets == 0 || drawLods[i] != 0) {
+				continue;
+			}
+			ClusterRange& range = clusterRanges[i];
+			range.drawOffset = clusterDrawCount;
+			range.capacity = instanceCounts[i] * modelMeshlets;
+			range.countIndex = static_cast<uint32_t>(meshletModels.size());
+			firstMeshlets[i] = meshletCount;
+			meshletModels.push_back(models[i]);
+			meshletCount += modelMeshlets;
+			clusterDrawCount += range.capacity;
+			clusterJobCount += instanceCounts[i] * ((modelMeshlets + CLUSTER_JOB_SIZE - 1) / CLUSTER_JOB_SIZE);
+			lastClusterCount += range.capacity;
+		}
+
+		// the cluster buffers are bound even when empty
+		bool reallocated = false;
+		reallocated |= reserveBuffer(frame.objects, sizeof(GpuObjectData) * objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		reallocated |= reserveBuffer(frame.draws, sizeof(VkDrawIndexedIndirectCommand) * models.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		reallocated |= reserveBuffer(frame.instances, sizeof(OvrModel::InstanceData) * objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		reallocated |= reserveBuffer(frame.stats, sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		reallocated |= reserveBuffer(frame.objectInstances, sizeof(uint32_t) * objectCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		const bool meshletsReallocated = reserveBuffer(frame.meshlets,
+			sizeof(OvrModel::Meshlet) * std::max(meshletCount, 1u),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		reallocated |= meshletsReallocated;
+		reallocated |= reserveBuffer(frame.clusterJobs, sizeof(GpuClusterJob) * std::max(clusterJobCount, 1u),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		reallocated |= reserveBuffer(frame.clusterDraws,
+			sizeof(VkDrawIndexedIndirectCommand) * std::max(clusterDrawCount, 1u),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		reallocated |= reserveBuffer(frame.clusterCounts, sizeof(uint32_t) * std::max<size_t>(meshletModels.size(), 1),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (reallocated) {
+			writeDescriptorSet(frame);
+		}
+
+		auto* draws = static_cast<VkDrawIndexedIndirectCommand*>(frame.draws.allocation.mapped);
+		uint32_t firstInstance = 0;
+		for (size_t i = 0; i < models.size(); i++) {
+			const OvrModel::Lod& lod = models[i]->getLods()[drawLods[i]];
+			draws[i].indexCount = lod.indexCount;
+			draws[i].instanceCount = 0; // incremented by the cull pass
+			draws[i].firstIndex = models[i]->getFirstIndex() + lod.firstIndex;
+			draws[i].vertexOffset = models[i]->getVertexOffset();
+			draws[i].firstInstance = firstInstance;
+			firstInstance += instanceCounts[i];
+		}
+
+		// meshlets only change with the set of clustered models
+		if (meshletsReallocated || frame.meshletModels != meshletModels) {
+			auto* meshlets = static_cast<OvrModel::Meshlet*>(frame.meshlets.allocation.mapped);
+			for (const OvrModel* model : meshletModels) {
+				meshlets = std::copy(model->getMeshlets().begin(), model->getMeshlets().end(), meshlets);
+			}
+			frame.meshletModels = meshletModels;
+		}
+
+		auto* objects = static_cast<GpuObjectData*>(frame.objects.allocation.mapped);
+		auto* jobs = static_cast<GpuClusterJob*>(frame.clusterJobs.allocation.mapped);
+		uint32_t objectIndex = 0;
+		uint32_t jobIndex = 0;
+		for (uint32_t i = 0; i < scene.size(); i++) {
+			OvrScene::ModelHandle handle = scene.getModelHandles()[i];
+			if (handle == OvrScene::NO_MODEL) {
+				continue;
+			}
+			const uint32_t drawIndex = objectDrawIndices[objectIndex];
+			GpuObjectData& data = objects[objectIndex];
+			data.modelMatrix = scene.getWorldMatrices()[i];
+			data.normalMatrix = scene.getNormalMatrices()[i];
+			data.boundingSphere = models[drawIndex]->getBoundingSphere();
+			data.drawIndex = drawIndex;
+
+			const ClusterRange& range = clusterRanges[drawIndex];
+			const uint32_t modelMeshlets = range.capacity > 0 ?
+				static_cast<uint32_t>(models[drawIndex]->getMeshlets().size()) : 0;
+			for (uint32_t first = 0; first < modelMeshlets; first += CLUSTER_JOB_SIZE) {
+				GpuClusterJob& job = jobs[jobIndex++];
+				job.objectIndex = objectIndex;
+				job.firstMeshlet = firstMeshlets[drawIndex] + first;
+				job.meshletCount = std::min(CLUSTER_JOB_SIZE, modelMeshlets - first);
+				job.drawOffset = range.drawOffset;
+				job.countIndex = range.countIndex;
+				job.firstIndex = models[drawIndex]->getFirstIndex();
+				job.vertexOffset = models[drawIndex]->getVertexOffset();
+				job.padding = 0;
+			}
+			objectIndex++;
+		}
+		*static_cast<uint32_t*>(frame.stats.allocation.mapped) = 0;
+		std::fill_n(static_cast<uint32_t*>(frame.clusterCounts.allocation.mapped), meshletModels.size(), 0u);
+		frame.clusterCountCount = static_cast<uint32_t>(meshletModels.size());
+		frame.statsValid = true;
+
+		CullPushConstantData push{};
+		auto planes = frameInfo.camera.getFrustumPlanes();
+		std::copy(planes.begin(), planes.end(), push.frustumPlanes);
+		push.cameraPosition = glm::vec4{ frameInfo.camera.getPosition(), 1.f };
+		push.objectCount = objectCount;
+		push.clusterJobCount = clusterJobCount;
+		push.coneCulling = clusterConeCulling ? 1u : 0u;
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		const bool drawIndirectCount = ovrDevice.cmdDrawIndexedIndirectCount() != nullptr;
+		if (clusterJobCount > 0 && !drawIndirectCount) {
+			// every command up to a range's capacity is drawn, the ones the pass doesn't write must be empty
+			vkCmdFillBuffer(commandBuffer, frame.clusterDraws.buffer, 0,
+				sizeof(VkDrawIndexedIndirectCommand) * clusterDrawCount, 0);
+			VkMemoryBarrier fillBarrier{};
+			fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			fillBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1,
+			&frame.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+			sizeof(CullPushConstantData), &push);
+		vkCmdDispatch(commandBuffer, (objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+		if (clusterJobCount > 0) {
+			// the cluster pass reads which objects survived and where their instances went
+			VkMemoryBarrier objectBarrier{};
+			objectBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			objectBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			objectBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &objectBarrier, 0, nullptr, 0, nullptr);
+
+			// same layout, the descriptor set and push constants stay bound. Rows of workgroups past the
+			// x limit, the shader skips the tail of the last one
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCullPipeline);
+			const uint32_t groupsX = std::min(clusterJobCount, MAX_WORKGROUPS_X);
+			vkCmdDispatch(commandBuffer, groupsX, (clusterJobCount + groupsX - 1) / groupsX, 1);
+		}
+
+		// cull results feed the indirect draws and the instance stream, the counter is read on the host
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+			VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			1,
+			&barrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
+	}
+
+	void GpuDrivenRenderSystem::renderGameObjects(FrameInfo& frameInfo)
+	{
+		auto& frame = frames[frameInfo.frameIndex];
+		lastDrawCount = 0;
+		if (!frame.statsValid || models.empty()) {
+			return;
+		}
+
+		GpuDrivenPushConstantData push{};
+		push.projectionView = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+		const PFN_vkCmdDrawIndexedIndirectCountKHR drawIndirectCount = ovrDevice.cmdDrawIndexedIndirectCount();
+		auto recordDraws = [&](VkCommandBuffer commandBuffer, uint32_t) {
+			vkCmdPushConstants(
+				commandBuffer,
+				pipelineLayout,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(GpuDrivenPushConstantData),
+				&push);
+
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, OvrModel::InstanceData::BINDING, 1, &frame.instances.buffer, &offset);
+
+			OvrPipeline* boundPipeline = nullptr;
+			OvrGeometryPool::BindState bindState{};
+			for (size_t i = 0; i < models.size(); i++) {
+				OvrPipeline* pipeline = &ovrPipelines[models[i]->getVertexLayout()].get();
+				if (pipeline != boundPipeline) {
+					pipeline->bind(commandBuffer);
+					boundPipeline = pipeline;
+				}
+				vkCmdPushConstants(
+					commandBuffer,
+					pipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					offsetof(GpuDrivenPushConstantData, dequantization),
+					sizeof(OvrModel::Dequantization),
+					&models[i]->getDequantization());
+				OvrFullVertexLayout::bind(commandBuffer, *models[i], &bindState);
+				const ClusterRange& range = clusterRanges[i];
+				if (range.capacity == 0) {
+					vkCmdDrawIndexedIndirect(commandBuffer, frame.draws.buffer,
+						i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+				}
+				else if (drawIndirectCount != nullptr) {
+					drawIndirectCount(commandBuffer, frame.clusterDraws.buffer,
+						range.drawOffset * sizeof(VkDrawIndexedIndirectCommand), frame.clusterCounts.buffer,
+						range.countIndex * sizeof(uint32_t), range.capacity, sizeof(VkDrawIndexedIndirectCommand));
+				}
+				else {
+					vkCmdDrawIndexedIndirect(commandBuffer, frame.clusterDraws.buffer,
+						range.drawOffset * sizeof(VkDrawIndexedIndirectCommand), range.capacity,
+						sizeof(VkDrawIndexedIndirectCommand));
+				}
+			}
+		};
+
+		// one draw per model, too few to be worth splitting across threads
+		if (frameInfo.commandRecorder != nullptr) {
+			frameInfo.commandRecorder->recordAndExecute(frameInfo.commandBuffer, 1, recordDraws);
+		}
+		else {
+			recordDraws(frameInfo.commandBuffer, 0);
+		}
+		lastDrawCount = static_cast<uint32_t>(models.size());
+	}
+}
@@ -0,0 +1,140 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+
+
+#pragma once
+#include "ovr_camera.h"
+#include "ovr_frame_info.h"
+#include "ovr_pipeline.h"
+#include "ovr_pipeline_builder.h"
+#include "ovr_device.h"
+#include "ovr_scene.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace ovr {
+	class OvrLodSelector;
+
+	// Alternative to SimpleRenderSystem: object transforms and bounds are written to GPU buffers,
+	// a compute pass frustum culls them and fills one VkDrawIndexedIndirectCommand per model.
+	// The number of recorded commands depends on the number of models and levels of detail in use, not objects.
+	// Each command's instances start at its firstInstance, so the device needs drawIndirectFirstInstance.
+	// Models with meshlets (see OvrMeshletBuilder) go further when the device has multiDrawIndirect: a second
+	// pass culls the meshlets of their visible objects by frustum (and normal cone, see setClusterConeCulling)
+	// and appends one command per surviving cluster to the model's range, drawn in one call (counted on the GPU with
+	// VK_KHR_draw_indirect_count when available).
+	class GpuDrivenRenderSystem {
+
+	public:
+
+		GpuDrivenRenderSystem(OVRDevice &device, VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder);
+		~GpuDrivenRenderSystem();
+
+		GpuDrivenRenderSystem(const GpuDrivenRenderSystem&) = delete;
+		GpuDrivenRenderSystem& operator=(const GpuDrivenRenderSystem&) = delete;
+
+		// records the culling dispatch, must be called before the render pass begins
+		void cullGameObjects(FrameInfo &frameInfo, const OvrScene& scene);
+		// records the indirect draws, inside the render pass
+		void renderGameObjects(FrameInfo &frameInfo);
+
+		// visible object count of the last completed use of this frame index, read back from the GPU
+		uint32_t getVisibleCount() const { return lastVisibleCount; }
+		uint32_t getLastDrawCount() const { return lastDrawCount; }
+		// entities with a model submitted to the last cull
+		uint32_t getLastObjectCount() const { return lastObjectCount; }
+		// meshlets that survived the cluster pass, read back like getVisibleCount
+		uint32_t getVisibleClusterCount() const { return lastVisibleClusterCount; }
+		// meshlets of all objects with a clustered model submitted to the last cull
+		uint32_t getLastClusterCount() const { return lastClusterCount; }
+
+		// picks every object's level of detail on the CPU before the cull, like SimpleRenderSystem::setLodSelector.
+		// Only level 0 is drawn by clusters
+		void setLodSelector(OvrLodSelector* selector) { lodSelector = selector; }
+		// triangles of the objects submitted to the last cull at their level, and at level 0, before the GPU culls
+		uint64_t getLastTriangleCount() const { return lastTriangleCount; }
+		uint64_t getLastFullTriangleCount() const { return lastFullTriangleCount; }
+
+		// on by default, off draws clustered models whole like the others
+		void setClusterCulling(bool enabled) { clusterCulling = enabled; }
+		bool isClusterCullingEnabled() const { return clusterCulling; }
+		// also drops clusters facing away from the camera. Off by default: the pipelines don't cull back faces
+		// (VK_CULL_MODE_NONE), so it is only correct for meshes that are never seen from behind
+		void setClusterConeCulling(bool enabled) { clusterConeCulling = enabled; }
+		bool isClusterConeCullingEnabled() const { return clusterConeCulling; }
+
+	private:
+		struct GpuBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			OvrAllocation allocation{};
+			VkDeviceSize size = 0;
+		};
+		struct FrameResources {
+			GpuBuffer objects;   // ObjectData per object, written by the CPU
+			GpuBuffer draws;     // one indexed indirect command per model, instanceCount filled by the cull pass
+			GpuBuffer instances; // compacted InstanceData of the visible objects, per-instance vertex input
+			GpuBuffer stats;     // visible counter read back once the frame's fence signaled
+			GpuBuffer objectInstances; // per object its instance, or culled, written by the cull pass
+			GpuBuffer meshlets;        // of every clustered model, rewritten when they change
+			GpuBuffer clusterJobs;     // up to 64 meshlets of one object each, written by the CPU
+			GpuBuffer clusterDraws;    // per clustered model a range of commands, appended by the cluster pass
+			GpuBuffer clusterCounts;   // commands in each range, read back like stats
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			std::vector<const OvrModel*> meshletModels; // whose meshlets are in meshlets, in order
+			uint32_t clusterCountCount = 0;             // ranges counted by the last use
+			bool statsValid = false;
+		};
+		// a model's commands in clusterDraws, capacity 0 when it is drawn whole
+		struct ClusterRange {
+			uint32_t drawOffset = 0;
+			uint32_t capacity = 0; // instances * meshlets
+			uint32_t countIndex = 0;
+		};
+
+		void createDescriptorResources();
+		void createCullPipelines();
+		VkPipeline createComputePipeline(const OvrShaderModule& shaderModule);
+		void createPipelineLayout();
+		void createPipeline(VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder);
+		bool reserveBuffer(GpuBuffer &buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		void writeDescriptorSet(FrameResources &frame);
+		void destroyBuffer(GpuBuffer &buffer);
+
+		OVRDevice &ovrDevice;
+
+		std::array<OvrPipelineHandle, OvrModel::VERTEX_LAYOUT_COUNT> ovrPipelines; // per OvrModel vertex layout
+		VkPipelineLayout pipelineLayout;
+
+		std::shared_ptr<const OvrShaderModule> cullShaderModule;
+		std::shared_ptr<const OvrShaderModule> clusterCullShaderModule;
+		VkPipelineLayout cullPipelineLayout; // both passes, same descriptor set and push constants
+		VkPipeline cullPipeline;
+		VkPipeline clusterCullPipeline;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+
+		std::vector<FrameResources> frames;
+		std::vector<OvrModel*> models;        // draw command index -> model, rebuilt each frame
+		std::vector<uint32_t> drawLods;       // draw command index -> level of detail
+		std::vector<uint32_t> lodDrawOffsets; // scene model handle -> its level 0 in modelDrawIndices
+		std::vector<uint32_t> modelDrawIndices; // model handle and level -> draw command index
+		std::vector<uint32_t> objectDrawIndices; // per object with a model, in scene order
+		std::vector<ClusterRange> clusterRanges; // per draw command index
+		bool clusterCulling = true;
+		bool clusterConeCulling = false;
+		OvrLodSelector* lodSelector = nullptr;
+		uint32_t lastVisibleCount = 0;
+		uint32_t lastDrawCount = 0;
+		uint32_t lastObjectCount = 0;
+		uint32_t lastVisibleClusterCount = 0;
+		uint32_t lastClusterCount = 0;
+		uint64_t lastTriangleCount = 0;
+		uint64_t lastFullTriangleCount = 0;
+	};
+}
@@ -8,6 +8,11 @@
 
 namespace ovr {
 	void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, OvrGameObject& gameObject)
+	{
+		moveInPlaneXZ(window, dt, gameObject.transform.translation, gameObject.transform.rotation);
+	}
+
+	void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, glm::vec3& translation, glm::vec3& rotation)
 	{
 
 		glm::vec3 rotate{ 0 };
@@ -22,12 +27,12 @@ namespace ovr {
 		if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.f;
 
 		if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
-			gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+			rotation += lookSpeed * dt * glm::normalize(rotate);
 
-		gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-		gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+		rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+		rotation.y = glm::mod(rotation.y, glm::two_pi<float>());
 
-		float yaw = gameObject.transform.rotation.y;
+		float yaw = rotation.y;
 		const glm::vec3 forwardDir{ sin(yaw), 0.f, cos(yaw) };
 		const glm::vec3 rightDir{ forwardDir.z, 0.f, -forwardDir.x };
 
@@ -42,7 +47,7 @@ namespace ovr {
 		if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
 
 		if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
-			gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+			translation += moveSpeed * dt * glm::normalize(moveDir);
 
 
 	}
@@ -26,6 +26,8 @@ namespace ovr {
              int lookDown = GLFW_KEY_DOWN;
         };
         void moveInPlaneXZ(GLFWwindow* window, float dt, OvrGameObject& gameObject);
+        // only touches the two components it moves, e.g. one entry of OvrScene::translations / rotations
+        void moveInPlaneXZ(GLFWwindow* window, float dt, glm::vec3& translation, glm::vec3& rotation);
 
 
         KeyMappings keys{};
@@ -5,18 +5,67 @@
 // Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
 //========================================================================
 #include "App.h"
+#include "benchmarks/benchmarks.h"
 
 //std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
-	ovr::MainApp app{};
-
+	// --headless [frames]: render offscreen without a window (CI, software ICDs like lavapipe)
+	// --gpu-driven: start with compute culling + indirect draws instead of the CPU draw list
+	// --parallel-record: record the render pass into secondary command buffers on the job system
+	// --bench <name>: run a headless benchmark (see benchmarks/benchmarks.h) and exit
 	try {
-		app.run();
+		bool headless = false;
+		bool gpuDriven = false;
+		uint32_t frames = 100;
+		bool parallelRecord = false;
+		std::string benchmark;
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--headless") == 0) {
+				headless = true;
+				if (i + 1 < argc && argv[i + 1][0] != '-') {
+					char* end = nullptr;
+					frames = static_cast<uint32_t>(std::strtoul(argv[++i], &end, 10));
+					if (*end != '\0') {
+						throw std::runtime_error("invalid frame count for --headless!");
+					}
+				}
+			}
+			else if (std::strcmp(argv[i], "--gpu-driven") == 0) {
+				gpuDriven = true;
+			}
+			else if (std::strcmp(argv[i], "--parallel-record") == 0) {
+				parallelRecord = true;
+			}
+			else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+				benchmark = argv[++i];
+			}
+		}
+
+		if (!benchmark.empty()) {
+			return ovr::runBenchmark(benchmark);
+		}
+
+		std::unique_ptr<ovr::MainApp> app;
+		if (headless) {
+			app = std::make_unique<ovr::MainApp>(
+				VkExtent2D{ ovr::MainApp::WIDTH, ovr::MainApp::HEIGHT }, frames);
+		}
+		else {
+			app = std::make_unique<ovr::MainApp>();
+		}
+		if (gpuDriven) {
+			app->setRenderPath(ovr::MainApp::RenderPath::GpuDriven);
+		}
+		app->setParallelRecording(parallelRecord);
+		app->run();
 	}
 	catch (const std::exception& e)
 	{
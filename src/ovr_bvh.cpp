@@ -0,0 +1,415 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace ovr {
+	static constexpr uint32_t SAH_BIN_COUNT = 12;
+	static constexpr float SAH_TRAVERSAL_COST = 1.f; // relative to testing one item
+
+	OvrAabb OvrAabb::transform(const OvrAabb& box, const glm::mat4& matrix) {
+		OvrAabb result{};
+		result.min = result.max = glm::vec3(matrix[3]);
+		for (int column = 0; column < 3; column++) {
+			glm::vec3 axis = glm::vec3(matrix[column]);
+			glm::vec3 a = axis * box.min[column];
+			glm::vec3 b = axis * box.max[column];
+			result.min += glm::min(a, b);
+			result.max += glm::max(a, b);
+		}
+		return result;
+	}
+
+	OvrFrustumTest testFrustum(const OvrAabb& box, const OvrFrustumPlanes& planes) {
+		glm::vec3 center = box.center();
+		glm::vec3 halfExtent = box.max - center;
+		OvrFrustumTest result = OvrFrustumTest::Inside;
+		for (const auto& plane : planes) {
+			glm::vec3 normal{ plane };
+			float distance = glm::dot(normal, center) + plane.w;
+			float radius = glm::dot(halfExtent, glm::abs(normal)); // projected extent onto the normal
+			if (distance < -radius) {
+				return OvrFrustumTest::Outside;
+			}
+			if (distance < radius) {
+				result = OvrFrustumTest::Intersects;
+			}
+		}
+		return result;
+	}
+
+	void OvrBvh::clear() {
+		boxes.clear();
+		itemOrder.clear();
+		itemLeaf.clear();
+		nodes.clear();
+		dirtyLeaves.clear();
+		leafDirtyFlags.clear();
+		buildSahCost = 0.f;
+	}
+
+	void OvrBvh::build(const std::vector<OvrAabb>& itemBoxes) {
+		clear();
+		boxes = itemBoxes;
+		if (boxes.empty()) {
+			return;
+		}
+
+		const uint32_t count = static_cast<uint32_t>(boxes.size());
+		centroids.resize(count);
+		itemOrder.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			centroids[i] = boxes[i].center();
+			itemOrder[i] = i;
+		}
+
+		nodes.reserve(2 * count / MAX_LEAF_SIZE + 1);
+		nodes.push_back({ OvrAabb{}, 0, count, INVALID_ITEM });
+		refitNode(0);
+
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+			split(nodeIndex, stack);
+		}
+
+		itemLeaf.resize(count);
+		for (uint32_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++) {
+			const Node& node = nodes[nodeIndex];
+			for (uint32_t i = 0; i < node.itemCount; i++) {
+				itemLeaf[itemOrder[node.firstChildOrItem + i]] = nodeIndex;
+			}
+		}
+		leafDirtyFlags.assign(nodes.size(), 0);
+		centroids.clear();
+		centroids.shrink_to_fit();
+		buildSahCost = getSahCost();
+	}
+
+	void OvrBvh::split(uint32_t nodeIndex, std::vector<uint32_t>& stack) {
+		const uint32_t first = nodes[nodeIndex].firstChildOrItem;
+		const uint32_t count = nodes[nodeIndex].itemCount;
+		if (count <= 2) {
+			return;
+		}
+
+		OvrAabb centroidBounds{};
+		for (uint32_t i = first; i < first + count; i++) {
+			centroidBounds.expand(centroids[itemOrder[i]]);
+		}
+
+		struct Bin {
+			OvrAabb box{};
+			uint32_t count = 0;
+		};
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+
+		for (int axis = 0; axis < 3; axis++) {
+			float axisMin = centroidBounds.min[axis];
+			float axisExtent = centroidBounds.max[axis] - axisMin;
+			if (axisExtent <= 0.f) {
+				continue;
+			}
+			float binScale = SAH_BIN_COUNT / axisExtent;
+
+			std::array<Bin, SAH_BIN_COUNT> bins{};
+			for (uint32_t i = first; i < first + count; i++) {
+				uint32_t item = itemOrder[i];
+				uint32_t bin = std::min(SAH_BIN_COUNT - 1,
+					static_cast<uint32_t>((centroids[item][axis] - axisMin) * binScale));
+				bins[bin].box.expand(boxes[item]);
+				bins[bin].count++;
+			}
+
+			// sweep from the right to get the area/count of every right side, then evaluate from the left
+			std::array<float, SAH_BIN_COUNT> rightArea{};
+			std::array<uint32_t, SAH_BIN_COUNT> rightCount{};
+			OvrAabb rightBox{};
+			uint32_t rightItems = 0;
+			for (uint32_t bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+				rightBox.expand(bins[bin].box);
+				rightItems += bins[bin].count;
+				rightArea[bin] = rightItems ? rightBox.surfaceArea() : 0.f;
+				rightCount[bin] = rightItems;
+			}
+			OvrAabb leftBox{};
+			uint32_t leftItems = 0;
+			for (uint32_t bin = 0; bin < SAH_BIN_COUNT - 1; bin++) {
+				leftBox.expand(bins[bin].box);
+				leftItems += bins[bin].count;
+				if (leftItems == 0 || rightCount[bin + 1] == 0) {
+					continue;
+				}
+				float cost = leftBox.surfaceArea() * leftItems + rightArea[bin + 1] * rightCount[bin + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+
+		// keep it a leaf when splitting doesn't pay for the extra traversal step
+		float parentArea = nodes[nodeIndex].box.surfaceArea();
+		float leafCost = static_cast<float>(count);
+		float splitCost = parentArea > 0.f ? SAH_TRAVERSAL_COST + bestCost / parentArea : leafCost;
+		if (count <= MAX_LEAF_SIZE && (bestAxis < 0 || splitCost >= leafCost)) {
+			return;
+		}
+
+		uint32_t middle;
+		if (bestAxis >= 0) {
+			float axisMin = centroidBounds.min[bestAxis];
+			float binScale = SAH_BIN_COUNT / (centroidBounds.max[bestAxis] - axisMin);
+			auto* begin = itemOrder.data() + first;
+			auto* pivot = std::partition(begin, begin + count, [&](uint32_t item) {
+				uint32_t bin = std::min(SAH_BIN_COUNT - 1,
+					static_cast<uint32_t>((centroids[item][bestAxis] - axisMin) * binScale));
+				return bin <= bestBin;
+			});
+			middle = first + static_cast<uint32_t>(pivot - begin);
+		}
+		else {
+			// every centroid in the same spot, split the range in half to bound the leaf size
+			middle = first + count / 2;
+		}
+
+		uint32_t leftIndex = static_cast<uint32_t>(nodes.size());
+		nodes.push_back({ OvrAabb{}, first, middle - first, nodeIndex });
+		nodes.push_back({ OvrAabb{}, middle, first + count - middle, nodeIndex });
+		nodes[nodeIndex].firstChildOrItem = leftIndex;
+		nodes[nodeIndex].itemCount = 0;
+		refitNode(leftIndex);
+		refitNode(leftIndex + 1);
+		stack.push_back(leftIndex);
+		stack.push_back(leftIndex + 1);
+	}
+
+	void OvrBvh::refitNode(uint32_t nodeIndex) {
+		Node& node = nodes[nodeIndex];
+		OvrAabb box{};
+		if (node.isLeaf()) {
+			for (uint32_t i = 0; i < node.itemCount; i++) {
+				box.expand(boxes[itemOrder[node.firstChildOrItem + i]]);
+			}
+		}
+		else {
+			box = nodes[node.firstChildOrItem].box;
+			box.expand(nodes[node.firstChildOrItem + 1].box);
+		}
+		node.box = box;
+	}
+
+	void OvrBvh::update(uint32_t item, const OvrAabb& box) {
+		assert(item < boxes.size() && "BVH item out of range");
+		boxes[item] = box;
+		uint32_t leaf = itemLeaf[item];
+		if (!leafDirtyFlags[leaf]) {
+			leafDirtyFlags[leaf] = 1;
+			dirtyLeaves.push_back(leaf);
+		}
+	}
+
+	void OvrBvh::refit() {
+		if (dirtyLeaves.empty()) {
+			return;
+		}
+
+		if (dirtyLeaves.size() * 4 > nodes.size()) {
+			// most of the tree moved, one backwards pass touches every node once
+			for (uint32_t nodeIndex = static_cast<uint32_t>(nodes.size()); nodeIndex-- > 0;) {
+				refitNode(nodeIndex);
+			}
+		}
+		else {
+			for (uint32_t leaf : dirtyLeaves) {
+				uint32_t nodeIndex = leaf;
+				refitNode(nodeIndex);
+				while (nodes[nodeIndex].parent != INVALID_ITEM) {
+					nodeIndex = nodes[nodeIndex].parent;
+					OvrAabb previous = nodes[nodeIndex].box;
+					refitNode(nodeIndex);
+					if (nodes[nodeIndex].box == previous) {
+						break; // nothing above changes either
+					}
+				}
+			}
+		}
+
+		for (uint32_t leaf : dirtyLeaves) {
+			leafDirtyFlags[leaf] = 0;
+		}
+		dirtyLeaves.clear();
+	}
+
+	float OvrBvh::getSahCost() const {
+		if (nodes.empty()) {
+			return 0.f;
+		}
+		float rootArea = nodes[0].box.surfaceArea();
+		if (rootArea <= 0.f) {
+			return static_cast<float>(boxes.size());
+		}
+		float cost = 0.f;
+		for (const Node& node : nodes) {
+			float area = node.box.surfaceArea() / rootArea;
+			cost += node.isLeaf() ? area * node.itemCount : area * SAH_TRAVERSAL_COST;
+		}
+		return cost;
+	}
+
+	void OvrBvh::addSubtree(uint32_t nodeIndex, std::vector<uint32_t>& out) const {
+		// the items of a subtree are contiguous in itemOrder only for leaves, so walk it
+		std::vector<uint32_t> stack{ nodeIndex };
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (node.isLeaf()) {
+				out.insert(out.end(), itemOrder.begin() + node.firstChildOrItem,
+					itemOrder.begin() + node.firstChildOrItem + node.itemCount);
+			}
+			else {
+				stack.push_back(node.firstChildOrItem);
+				stack.push_back(node.firstChildOrItem + 1);
+			}
+		}
+	}
+
+	void OvrBvh::queryFrustum(const OvrFrustumPlanes& planes, std::vector<uint32_t>& out) const {
+		if (nodes.empty()) {
+			return;
+		}
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			const uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[nodeIndex];
+			OvrFrustumTest test = testFrustum(node.box, planes);
+			if (test == OvrFrustumTest::Outside) {
+				continue;
+			}
+			if (test == OvrFrustumTest::Inside) {
+				addSubtree(nodeIndex, out); // no more plane tests below a fully visible node
+			}
+			else if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.itemCount; i++) {
+					uint32_t item = itemOrder[node.firstChildOrItem + i];
+					if (testFrustum(boxes[item], planes) != OvrFrustumTest::Outside) {
+						out.push_back(item);
+					}
+				}
+			}
+			else {
+				stack.push_back(node.firstChildOrItem);
+				stack.push_back(node.firstChildOrItem + 1);
+			}
+		}
+	}
+
+	void OvrBvh::queryRange(const OvrAabb& range, std::vector<uint32_t>& out) const {
+		if (nodes.empty()) {
+			return;
+		}
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (!node.box.overlaps(range)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.itemCount; i++) {
+					uint32_t item = itemOrder[node.firstChildOrItem + i];
+					if (boxes[item].overlaps(range)) {
+						out.push_back(item);
+					}
+				}
+			}
+			else {
+				stack.push_back(node.firstChildOrItem);
+				stack.push_back(node.firstChildOrItem + 1);
+			}
+		}
+	}
+
+	void OvrBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+		if (nodes.empty()) {
+			return;
+		}
+		const float radiusSquared = radius * radius;
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (node.box.distanceSquared(center) > radiusSquared) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.itemCount; i++) {
+					uint32_t item = itemOrder[node.firstChildOrItem + i];
+					if (boxes[item].distanceSquared(center) <= radiusSquared) {
+						out.push_back(item);
+					}
+				}
+			}
+			else {
+				stack.push_back(node.firstChildOrItem);
+				stack.push_back(node.firstChildOrItem + 1);
+			}
+		}
+	}
+
+	uint32_t OvrBvh::queryNearest(const glm::vec3& point, float* distance) const {
+		uint32_t bestItem = INVALID_ITEM;
+		float bestDistanceSquared = std::numeric_limits<float>::max();
+		if (!nodes.empty()) {
+			// depth first, nearer child first, pruned by the best distance so far
+			std::vector<std::pair<float, uint32_t>> stack{ { nodes[0].box.distanceSquared(point), 0 } };
+			while (!stack.empty()) {
+				auto entry = stack.back();
+				stack.pop_back();
+				if (entry.first >= bestDistanceSquared) {
+					continue;
+				}
+				const Node& node = nodes[entry.second];
+				if (node.isLeaf()) {
+					for (uint32_t i = 0; i < node.itemCount; i++) {
+						uint32_t item = itemOrder[node.firstChildOrItem + i];
+						float itemDistance = boxes[item].distanceSquared(point);
+						if (itemDistance < bestDistanceSquared) {
+							bestDistanceSquared = itemDistance;
+							bestItem = item;
+						}
+					}
+				}
+				else {
+					uint32_t left = node.firstChildOrItem;
+					float leftDistance = nodes[left].box.distanceSquared(point);
+					float rightDistance = nodes[left + 1].box.distanceSquared(point);
+					if (leftDistance < rightDistance) { // pushed last, popped first
+						stack.push_back({ rightDistance, left + 1 });
+						stack.push_back({ leftDistance, left });
+					}
+					else {
+						stack.push_back({ leftDistance, left });
+						stack.push_back({ rightDistance, left + 1 });
+					}
+				}
+			}
+		}
+		if (distance) {
+			*distance = bestItem == INVALID_ITEM ? 0.f : glm::sqrt(bestDistanceSquared);
+		}
+		return bestItem;
+	}
+}
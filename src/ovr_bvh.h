@@ -0,0 +1,108 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_frustum_culling.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ovr {
+
+	struct OvrAabb {
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+		bool isValid() const { return min.x <= max.x; }
+		glm::vec3 center() const { return (min + max) * .5f; }
+		float surfaceArea() const {
+			glm::vec3 extent = max - min;
+			return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+		void expand(const glm::vec3& point) {
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+		void expand(const OvrAabb& other) {
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+		bool overlaps(const OvrAabb& other) const {
+			return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+		}
+		float distanceSquared(const glm::vec3& point) const {
+			glm::vec3 offset = glm::max(glm::max(min - point, point - max), glm::vec3{ 0.f });
+			return glm::dot(offset, offset);
+		}
+		bool operator==(const OvrAabb& other) const { return min == other.min && max == other.max; }
+
+		// box around the transformed box (Arvo), tighter than transforming the 8 corners' box twice
+		static OvrAabb transform(const OvrAabb& box, const glm::mat4& matrix);
+	};
+
+	enum class OvrFrustumTest { Outside, Intersects, Inside };
+	OvrFrustumTest testFrustum(const OvrAabb& box, const OvrFrustumPlanes& planes);
+
+	// Bounding volume hierarchy over items identified by their index in the build array.
+	// Built top down with a binned surface area heuristic, kept up to date by refitting:
+	// update() the boxes that moved, then refit() walks up from their leaves only.
+	// Refitting keeps the topology, so the tree degrades as items travel; rebuild once
+	// getSahCost() has grown well past getBuildSahCost().
+	class OvrBvh {
+	public:
+		static constexpr uint32_t INVALID_ITEM = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+		void build(const std::vector<OvrAabb>& itemBoxes);
+		void clear();
+
+		size_t itemCount() const { return boxes.size(); }
+		const OvrAabb& itemBox(uint32_t item) const { return boxes[item]; }
+
+		void update(uint32_t item, const OvrAabb& box);
+		void refit();
+
+		// item indices are appended to out
+		void queryFrustum(const OvrFrustumPlanes& planes, std::vector<uint32_t>& out) const;
+		void queryRange(const OvrAabb& range, std::vector<uint32_t>& out) const;
+		void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+		// item whose box is closest to point (0 when inside it), INVALID_ITEM when empty
+		uint32_t queryNearest(const glm::vec3& point, float* distance = nullptr) const;
+
+		float getSahCost() const;
+		float getBuildSahCost() const { return buildSahCost; }
+		size_t nodeCount() const { return nodes.size(); }
+
+	private:
+		struct Node {
+			OvrAabb box;
+			uint32_t firstChildOrItem; // internal: left child, right child follows it. leaf: first of itemOrder
+			uint32_t itemCount;        // 0 for internal nodes
+			uint32_t parent;
+
+			bool isLeaf() const { return itemCount > 0; }
+		};
+
+		void split(uint32_t nodeIndex, std::vector<uint32_t>& stack);
+		void refitNode(uint32_t nodeIndex);
+		void addSubtree(uint32_t nodeIndex, std::vector<uint32_t>& out) const;
+
+		std::vector<OvrAabb> boxes;          // per item
+		std::vector<glm::vec3> centroids;    // per item, only used while building
+		std::vector<uint32_t> itemOrder;     // items grouped by leaf
+		std::vector<uint32_t> itemLeaf;      // per item, leaf node holding it
+		std::vector<Node> nodes;             // root at 0, children always after their parent
+		std::vector<uint32_t> dirtyLeaves;
+		std::vector<uint8_t> leafDirtyFlags; // per node
+		float buildSahCost = 0.f;
+	};
+}
@@ -79,4 +79,22 @@ void OvrCamera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
 	viewMatrix[3][1] = -glm::dot(v, position);
 	viewMatrix[3][2] = -glm::dot(w, position);
 }
-}
\ No newline at end of file
+
+	std::array<glm::vec4, 6> OvrCamera::getFrustumPlanes() const {
+		// Gribb/Hartmann plane extraction from the rows of projection * view, depth range is [0, 1]
+		const glm::mat4 m = projectionMatrix * viewMatrix;
+		auto row = [&m](int i) { return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] }; };
+
+		std::array<glm::vec4, 6> planes{
+			row(3) + row(0),
+			row(3) - row(0),
+			row(3) + row(1),
+			row(3) - row(1),
+			row(2),
+			row(3) - row(2) };
+		for (auto& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return planes;
+	}
+}
@@ -12,6 +12,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std
+#include <array>
+
 namespace ovr {
 
     class OvrCamera {
@@ -34,6 +37,12 @@ namespace ovr {
 
         const glm::mat4& getProjection() const { return projectionMatrix; }
         const glm::mat4& getView() const { return viewMatrix; }
+        // world space, from the inverse of the view
+        glm::vec3 getPosition() const { return glm::vec3{ glm::inverse(viewMatrix)[3] }; }
+
+        // world space planes (xyz = inward normal, w = distance) in left, right, bottom, top, near, far order,
+        // a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+        std::array<glm::vec4, 6> getFrustumPlanes() const;
 
 
     private:
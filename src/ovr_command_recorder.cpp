@@ -0,0 +1,140 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_command_recorder.h"
+#include "ovr_swap_chain.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ovr {
+	OvrCommandRecorder::OvrCommandRecorder(OVRDevice& device, OvrJobSystem& jobSystem)
+		: ovrDevice{ device }, jobSystem{ jobSystem } {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = ovrDevice.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole, never per buffer
+
+		framePools.resize(OVRSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto& pools : framePools) {
+			pools.resize(jobSystem.getThreadCount());
+			for (auto& threadPool : pools) {
+				if (vkCreateCommandPool(ovrDevice.device(), &poolInfo, nullptr, &threadPool.pool) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create recording command pool!");
+				}
+			}
+		}
+
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.subpass = 0;
+	}
+
+	OvrCommandRecorder::~OvrCommandRecorder() {
+		// destroying a pool frees its buffers
+		for (auto& pools : framePools) {
+			for (auto& threadPool : pools) {
+				vkDestroyCommandPool(ovrDevice.device(), threadPool.pool, nullptr);
+			}
+		}
+	}
+
+	void OvrCommandRecorder::beginFrame(int frameIndex) {
+		currentFrame = frameIndex;
+		for (auto& threadPool : framePools[currentFrame]) {
+			if (threadPool.used > 0) {
+				vkResetCommandPool(ovrDevice.device(), threadPool.pool, 0);
+				threadPool.used = 0;
+			}
+		}
+	}
+
+	void OvrCommandRecorder::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent) {
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.framebuffer = framebuffer; // optional, but lets the driver skip a lookup
+		renderExtent = extent;
+	}
+
+	const std::vector<VkCommandBuffer>& OvrCommandRecorder::record(uint32_t taskCount, const RecordFunction& recordFunction) {
+		assert(inheritanceInfo.renderPass != VK_NULL_HANDLE && "Can't record before beginRenderPass");
+		recorded.assign(taskCount, VK_NULL_HANDLE);
+		error = nullptr;
+		// one task per job, a single task runs right here without touching the queues
+		jobSystem.parallelFor(taskCount, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t task = begin; task < end; task++) {
+				try {
+					recordTask(task, recordFunction);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock{ errorMutex };
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+			}
+		});
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return recorded;
+	}
+
+	void OvrCommandRecorder::recordAndExecute(
+		VkCommandBuffer primaryCommandBuffer,
+		uint32_t taskCount,
+		const RecordFunction& recordFunction) {
+		const auto& commandBuffers = record(taskCount, recordFunction);
+		if (!commandBuffers.empty()) {
+			vkCmdExecuteCommands(
+				primaryCommandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		}
+	}
+
+	void OvrCommandRecorder::recordTask(uint32_t task, const RecordFunction& recordFunction) {
+		VkCommandBuffer commandBuffer = acquireBuffer(jobSystem.getThreadIndex());
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording secondary command buffer!");
+		}
+
+		VkViewport viewport{};
+		viewport.width = static_cast<float>(renderExtent.width);
+		viewport.height = static_cast<float>(renderExtent.height);
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0, 0}, renderExtent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		recordFunction(commandBuffer, task);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record secondary command buffer!");
+		}
+		recorded[task] = commandBuffer;
+	}
+
+	VkCommandBuffer OvrCommandRecorder::acquireBuffer(uint32_t thread) {
+		ThreadPool& threadPool = framePools[currentFrame][thread];
+		if (threadPool.used == threadPool.buffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = threadPool.pool;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(ovrDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+			threadPool.buffers.push_back(commandBuffer);
+		}
+		return threadPool.buffers[threadPool.used++];
+	}
+}
@@ -0,0 +1,70 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_device.h"
+#include "ovr_job_system.h"
+
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace ovr {
+
+	// Records the contents of a render pass into secondary command buffers on the job system's threads.
+	// Every thread has its own command pool per frame in flight, so a pool is only ever touched by
+	// one thread and all of a frame's buffers are recycled with one vkResetCommandPool.
+	// OvrRenderer owns one when parallel recording is enabled, see OvrRenderer::setRecordingJobSystem.
+	// Threads outside the job system share one pool, so only one of them may record at a time.
+	class OvrCommandRecorder {
+	public:
+		using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t task)>;
+
+		OvrCommandRecorder(OVRDevice& device, OvrJobSystem& jobSystem);
+		~OvrCommandRecorder(); // the GPU must be done with every buffer recorded
+
+		OvrCommandRecorder(const OvrCommandRecorder&) = delete;
+		OvrCommandRecorder& operator=(const OvrCommandRecorder&) = delete;
+
+		uint32_t getThreadCount() const { return jobSystem.getThreadCount(); }
+
+		// resets the pools of frameIndex, the frame's fence must have signalled
+		void beginFrame(int frameIndex);
+		// render pass, subpass and framebuffer the following record calls inherit
+		void beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+		// Calls recordTask(commandBuffer, task) for every task in 0..taskCount-1 as jobs.
+		// Each task gets its own secondary command buffer with viewport and scissor already set, since
+		// dynamic state is not inherited from the primary. Returns once every task is recorded, the
+		// buffers are in task order and stay valid until the next record call.
+		const std::vector<VkCommandBuffer>& record(uint32_t taskCount, const RecordFunction& recordTask);
+		// record, then vkCmdExecuteCommands into primaryCommandBuffer
+		void recordAndExecute(VkCommandBuffer primaryCommandBuffer, uint32_t taskCount, const RecordFunction& recordTask);
+
+	private:
+		struct ThreadPool {
+			VkCommandPool pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> buffers; // allocated on demand, kept across frames
+			uint32_t used = 0;
+		};
+
+		void recordTask(uint32_t task, const RecordFunction& recordFunction);
+		VkCommandBuffer acquireBuffer(uint32_t thread);
+
+		OVRDevice& ovrDevice;
+		OvrJobSystem& jobSystem;
+
+		std::vector<std::vector<ThreadPool>> framePools; // [frame in flight][thread]
+		int currentFrame = 0;
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		VkExtent2D renderExtent{};
+		std::vector<VkCommandBuffer> recorded;
+		std::exception_ptr error; // first failure of the current record call, rethrown on the caller
+		std::mutex errorMutex;
+	};
+}
@@ -0,0 +1,77 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_cpu_features.h"
+
+#ifdef OVR_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <cstdint>
+
+namespace ovr {
+#ifdef OVR_X86
+	static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4]) {
+#if defined(_MSC_VER)
+		int values[4];
+		__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+		for (int i = 0; i < 4; i++) {
+			registers[i] = static_cast<uint32_t>(values[i]);
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	static uint64_t readXcr0() {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+	}
+
+	static OvrCpuFeatures detectCpuFeatures() {
+		OvrCpuFeatures features{};
+		uint32_t registers[4]{};
+		cpuid(0, 0, registers);
+		uint32_t maxLeaf = registers[0];
+
+		cpuid(1, 0, registers);
+		const uint32_t ecx = registers[2];
+		features.sse41 = (ecx & (1u << 19)) != 0;
+		bool osxsave = (ecx & (1u << 27)) != 0;
+		bool cpuAvx = (ecx & (1u << 28)) != 0;
+		bool cpuFma = (ecx & (1u << 12)) != 0;
+
+		// the OS has to preserve XMM and YMM state across context switches
+		bool osYmm = osxsave && (readXcr0() & 0x6) == 0x6;
+		features.avx = cpuAvx && osYmm;
+		features.fma = cpuFma && features.avx;
+
+		if (maxLeaf >= 7) {
+			cpuid(7, 0, registers);
+			features.avx2 = features.avx && (registers[1] & (1u << 5)) != 0;
+		}
+		return features;
+	}
+#else
+	static OvrCpuFeatures detectCpuFeatures() {
+		return OvrCpuFeatures{};
+	}
+#endif
+
+	const OvrCpuFeatures& OvrCpuFeatures::get() {
+		static const OvrCpuFeatures features = detectCpuFeatures();
+		return features;
+	}
+}
@@ -0,0 +1,52 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OVR_X86 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// lets a single function use AVX/AVX2/FMA intrinsics without compiling the whole file for them,
+// MSVC accepts the intrinsics anywhere
+#if defined(OVR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define OVR_TARGET_AVX __attribute__((target("avx")))
+#define OVR_TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#define OVR_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define OVR_TARGET_AVX
+#define OVR_TARGET_AVX2_FMA
+#define OVR_TARGET_SSE41
+#endif
+
+namespace ovr {
+
+	// Instruction sets usable on this machine, checked once at startup so SIMD kernels can
+	// pick their widest variant at runtime. All false on non x86 targets.
+	struct OvrCpuFeatures {
+		bool sse41 = false;
+		bool avx = false;  // includes the OS saving the YMM registers
+		bool avx2 = false;
+		bool fma = false;
+
+		static const OvrCpuFeatures& get();
+	};
+
+	// index of the lowest set bit, mask must not be 0
+	inline int lowestBitIndex(unsigned int mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+}
@@ -5,10 +5,17 @@
 // Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
 //========================================================================
 #include "ovr_device.h"
+#include "ovr_geometry_pool.h"
+#include "ovr_upload_batch.h"
+#include "ovr_utils.h"
 
 // std headers
+#include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
@@ -54,16 +61,46 @@ void DestroyDebugUtilsMessengerEXT( // Destroy debug messeger
 }
 
 // class member functions
-OVRDevice::OVRDevice(AppWindow &window) : window{window} {
+OVRDevice::OVRDevice(AppWindow &window) : window{&window} {
   createInstance(); //init vulkan lib
   setupDebugMessenger(); //setup validation layers
   createSurface(); // create surface connection between window and vulkan
   pickPhysicalDevice(); // setup gpu
   createLogicalDevice(); // what features will be used
   createCommandPool(); // command buffer alocation settup
+  createPipelineCache(); // compiled pipelines from previous runs
+  allocator = std::make_unique<OvrMemoryAllocator>(device_, physicalDevice); // buffer/image memory pools
+  stagingRing_ = std::make_unique<OvrStagingRing>(*this); // persistently mapped upload memory
+  shaderCache_ = std::make_unique<OvrShaderCache>(device_); // SPIR-V modules shared between pipelines
+  geometryPool_ = std::make_unique<OvrGeometryPool>(*this); // vertex/index buffers shared by all models
+}
+
+OVRDevice::OVRDevice() {
+  createInstance(); //init vulkan lib without window system extensions
+  setupDebugMessenger(); //setup validation layers
+  pickPhysicalDevice(); // setup gpu, no surface to present to
+  createLogicalDevice(); // what features will be used
+  createCommandPool(); // command buffer alocation settup
+  createPipelineCache(); // compiled pipelines from previous runs
+  allocator = std::make_unique<OvrMemoryAllocator>(device_, physicalDevice); // buffer/image memory pools
+  stagingRing_ = std::make_unique<OvrStagingRing>(*this); // persistently mapped upload memory
+  shaderCache_ = std::make_unique<OvrShaderCache>(device_); // SPIR-V modules shared between pipelines
+  geometryPool_ = std::make_unique<OvrGeometryPool>(*this); // vertex/index buffers shared by all models
 }
 
 OVRDevice::~OVRDevice() {
+  vkDeviceWaitIdle(device_); // uploads may still read from the staging ring
+  collectUploads();
+  geometryPool_.reset(); // every model is gone, its pages go back to the allocator
+  stagingRing_.reset();
+  for (VkFence fence : freeUploadFences) {
+    vkDestroyFence(device_, fence, nullptr);
+  }
+  allocator->printStats();
+  allocator.reset(); // free all memory blocks before the device goes away
+  shaderCache_.reset(); // pipelines are gone by now, so are the modules they borrowed
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr); //destroy vulkan command pool
   vkDestroyDevice(device_, nullptr); // destroy vulkan device
 
@@ -71,7 +108,9 @@ OVRDevice::~OVRDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr); //destroy connection between Vulkan and the native surface
+  if (surface_ != VK_NULL_HANDLE) { // headless device never created a surface
+    vkDestroySurfaceKHR(instance, surface_, nullptr); //destroy connection between Vulkan and the native surface
+  }
   vkDestroyInstance(instance, nullptr); // destroy vulkan instance
 }
 
@@ -184,8 +223,14 @@ void OVRDevice::createLogicalDevice() { // create vulkan logical device
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
   VkPhysicalDeviceFeatures deviceFeatures = {}; // vk device features
   deviceFeatures.samplerAnisotropy = VK_TRUE; //enable anisotropic filtering
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect; // one call per model's visible clusters
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance; // culled instance ranges
+  drawIndirectFirstInstance_ = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+  multiDrawIndirect_ = supportedFeatures.multiDrawIndirect == VK_TRUE && drawIndirectFirstInstance_;
 
   VkDeviceCreateInfo createInfo = {}; //vk virtual device info
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -194,8 +239,14 @@ void OVRDevice::createLogicalDevice() { // create vulkan logical device
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  auto extensions = getRequiredDeviceExtensions();
+  // optional, without it cluster draws are read up to their capacity, the culled ones empty
+  const bool drawIndirectCount = isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  if (drawIndirectCount) {
+    extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -210,6 +261,11 @@ void OVRDevice::createLogicalDevice() { // create vulkan logical device
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (drawIndirectCount) {
+    cmdDrawIndexedIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+        vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_); //Get a queue handle from a device
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_); //Get a queue handle from a device
 }
@@ -231,15 +287,15 @@ void OVRDevice::createCommandPool() {
   }
 }
 
-void OVRDevice::createSurface() { window.createWindowSurface(instance, &surface_); } // create window surface for Vulkan
+void OVRDevice::createSurface() { window->createWindowSurface(instance, &surface_); } // create window surface for Vulkan
 
 bool OVRDevice::isDeviceSuitable(VkPhysicalDevice device) { 
   QueueFamilyIndices indices = findQueueFamilies(device); // check if device supports queue families
 
   bool extensionsSupported = checkDeviceExtensionSupport(device); // check graphics extensions support
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = isHeadless(); // offscreen rendering doesn't need a swapchain
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device); // check swap chain support
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -303,11 +359,14 @@ bool OVRDevice::checkValidationLayerSupport() { // check if video card support v
 }
 
 std::vector<const char *> OVRDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+  std::vector<const char *> extensions;
 
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  if (!isHeadless()) { // surface extensions are only needed to present to a window
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -316,6 +375,13 @@ std::vector<const char *> OVRDevice::getRequiredExtensions() {
   return extensions;
 }
 
+std::vector<const char *> OVRDevice::getRequiredDeviceExtensions() {
+  if (isHeadless()) { // no swapchain -> no device extensions required
+    return {};
+  }
+  return deviceExtensions;
+}
+
 void OVRDevice::hasGflwRequiredInstanceExtensions() { //get requrend GLFW extensions
   uint32_t extensionCount = 0;
   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -350,6 +416,7 @@ bool OVRDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
+  auto deviceExtensions = getRequiredDeviceExtensions();
   std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
   for (const auto &extension : availableExtensions) {
@@ -359,6 +426,21 @@ bool OVRDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool OVRDevice::isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (std::strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // check queue families support
 QueueFamilyIndices OVRDevice::findQueueFamilies(VkPhysicalDevice device) { // check support for different queues like (grapics queue)
   QueueFamilyIndices indices;
@@ -377,7 +459,11 @@ QueueFamilyIndices OVRDevice::findQueueFamilies(VkPhysicalDevice device) { // ch
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) { // nothing is presented, graphics queue doubles as present queue
+      presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ? VK_TRUE : VK_FALSE;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     //check if device supports presentation queue
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
@@ -453,7 +539,8 @@ void OVRDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    OvrAllocation &bufferAllocation,
+    OvrAllocationStrategy strategy) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -467,16 +554,124 @@ void OVRDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferAllocation = allocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      false,
+      strategy);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to bind vertex buffer memory!");
   }
+}
+
+void OVRDevice::destroyBuffer(VkBuffer buffer, OvrAllocation &bufferAllocation) {
+  vkDestroyBuffer(device_, buffer, nullptr);
+  allocator->free(bufferAllocation);
+}
+
+// Pipeline cache file layout: PipelineCacheFileHeader followed by the blob returned by
+// vkGetPipelineCacheData. The hash guards against truncated or corrupted files, which
+// some drivers don't survive, the Vulkan header inside the blob is checked separately.
+struct PipelineCacheFileHeader {
+  uint32_t magic;
+  uint32_t dataSize;
+  uint64_t dataHash;
+};
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x4350564f;  // "OVPC"
+
+std::string OVRDevice::pipelineCachePath() const {
+  // a driver update or another GPU invalidates the cache, so they are part of the name
+  char name[96];
+  snprintf(
+      name,
+      sizeof(name),
+      "pipeline_cache_%04x_%04x_%08x.bin",
+      properties.vendorID,
+      properties.deviceID,
+      properties.driverVersion);
+  return name;
+}
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+bool OVRDevice::isPipelineCacheDataValid(const std::vector<char> &data) const {
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+         memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void OVRDevice::createPipelineCache() {
+  std::vector<char> data;
+  std::ifstream file{pipelineCachePath(), std::ios::binary};
+  PipelineCacheFileHeader fileHeader{};
+  if (file.read(reinterpret_cast<char *>(&fileHeader), sizeof(fileHeader)) &&
+      fileHeader.magic == PIPELINE_CACHE_MAGIC) {
+    data.resize(fileHeader.dataSize);
+    if (!file.read(data.data(), data.size()) ||
+        hashBytes(data.data(), data.size()) != fileHeader.dataHash ||
+        !isPipelineCacheDataValid(data)) {
+      std::cout << "pipeline cache: ignoring stale or corrupted " << pipelineCachePath() << std::endl;
+      data.clear();
+    }
+  }
+  pipelineCacheWarm = !data.empty();
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+}
+
+void OVRDevice::savePipelineCache() {
+  uint32_t count = pipelineCreateCount.load();
+  double totalMs = pipelineCreateNanoseconds.load() / 1e6;
+  std::cout << "pipeline cache: " << (pipelineCacheWarm ? "warm" : "cold") << " start, " << count
+            << " pipelines created in " << totalMs << " ms";
+  if (count > 0) {
+    std::cout << " (" << totalMs / count << " ms each)";
+  }
+  std::cout << std::endl;
+
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS ||
+      dataSize == 0) {
+    return;
+  }
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, data.data()) != VK_SUCCESS) {
+    return;
+  }
+  data.resize(dataSize);
+  if (!isPipelineCacheDataValid(data)) {  // never write back something we'd refuse to load
+    return;
+  }
+
+  PipelineCacheFileHeader fileHeader{};
+  fileHeader.magic = PIPELINE_CACHE_MAGIC;
+  fileHeader.dataSize = static_cast<uint32_t>(data.size());
+  fileHeader.dataHash = hashBytes(data.data(), data.size());
+
+  std::ofstream file{pipelineCachePath(), std::ios::binary | std::ios::trunc};
+  file.write(reinterpret_cast<const char *>(&fileHeader), sizeof(fileHeader));
+  file.write(data.data(), data.size());
+  if (!file) {
+    std::cout << "pipeline cache: failed to write " << pipelineCachePath() << std::endl;
+  }
+}
+
+void OVRDevice::recordPipelineCreation(uint64_t nanoseconds) {
+  pipelineCreateCount++;
+  pipelineCreateNanoseconds += nanoseconds;
 }
 
 VkCommandBuffer OVRDevice::beginSingleTimeCommands() {
@@ -505,24 +700,128 @@ void OVRDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  // wait on this submission only instead of draining the whole queue
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create single time command fence!");
+  }
+
+  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+  vkWaitForFences(device_, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 
+  vkDestroyFence(device_, fence, nullptr);
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
-void OVRDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+void OVRDevice::copyBuffer(
+    VkBuffer srcBuffer,
+    VkBuffer dstBuffer,
+    VkDeviceSize size,
+    VkDeviceSize srcOffset,
+    VkDeviceSize dstOffset) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;  // Optional
-  copyRegion.dstOffset = 0;  // Optional
+  copyRegion.srcOffset = srcOffset;
+  copyRegion.dstOffset = dstOffset;
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
   endSingleTimeCommands(commandBuffer);
 }
 
+OvrUploadTicket OVRDevice::uploadBuffer(
+    VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset) {
+  OvrUploadBatch batch{*this};
+  batch.uploadBuffer(dstBuffer, data, size, dstOffset);
+  return batch.submit();
+}
+
+OvrUploadTicket OVRDevice::reserveUploadTicket() {
+  OvrUploadTicket ticket = nextUploadTicket++;
+  openUploads.insert(ticket);
+  return ticket;
+}
+
+void OVRDevice::cancelUploadTicket(OvrUploadTicket ticket) { openUploads.erase(ticket); }
+
+VkCommandBuffer OVRDevice::allocateUploadCommandBuffer() {
+  collectUploads();  // reuse fences of finished batches before creating new ones
+  return beginSingleTimeCommands();
+}
+
+VkFence OVRDevice::submitUploadCommandBuffer(VkCommandBuffer commandBuffer, OvrUploadTicket ticket) {
+  assert(openUploads.count(ticket) && "Upload ticket was not reserved or already submitted");
+
+  VkFence fence;
+  if (freeUploadFences.empty()) {
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload fence!");
+    }
+  } else {
+    fence = freeUploadFences.back();
+    freeUploadFences.pop_back();
+  }
+
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit upload command buffer!");
+  }
+
+  openUploads.erase(ticket);
+  pendingUploads[ticket] = {fence, commandBuffer};
+  return fence;
+}
+
+bool OVRDevice::isUploadComplete(OvrUploadTicket ticket) {
+  if (openUploads.count(ticket)) {
+    return false;
+  }
+  auto it = pendingUploads.find(ticket);
+  return it == pendingUploads.end() ||
+         vkGetFenceStatus(device_, it->second.fence) == VK_SUCCESS;
+}
+
+void OVRDevice::waitForUpload(OvrUploadTicket ticket) {
+  assert(!openUploads.count(ticket) && "Waiting for an upload batch that was never submitted");
+  auto it = pendingUploads.find(ticket);
+  if (it != pendingUploads.end()) {
+    vkWaitForFences(
+        device_, 1, &it->second.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+  }
+}
+
+void OVRDevice::collectUploads() {
+  std::vector<OvrUploadTicket> finished;
+  for (auto &kv : pendingUploads) {
+    if (vkGetFenceStatus(device_, kv.second.fence) == VK_SUCCESS) {
+      finished.push_back(kv.first);
+    }
+  }
+  if (finished.empty()) {
+    return;
+  }
+
+  // the ring must forget the signaled fences before they can be reset and reused
+  stagingRing_->retire();
+  for (OvrUploadTicket ticket : finished) {
+    PendingUpload &upload = pendingUploads[ticket];
+    vkResetFences(device_, 1, &upload.fence);
+    freeUploadFences.push_back(upload.fence);
+    vkFreeCommandBuffers(device_, commandPool, 1, &upload.commandBuffer);
+    pendingUploads.erase(ticket);
+  }
+}
+
 void OVRDevice::copyBufferToImage(
     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
@@ -554,7 +853,7 @@ void OVRDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    OvrAllocation &imageAllocation) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -562,18 +861,21 @@ void OVRDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  // linear tiling images share the buffer pools' granularity rules
+  imageAllocation = allocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL);
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void OVRDevice::destroyImage(VkImage image, OvrAllocation &imageAllocation) {
+  vkDestroyImage(device_, image, nullptr);
+  allocator->free(imageAllocation);
+}
+
 }  // namespace lve
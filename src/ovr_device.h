@@ -7,13 +7,26 @@
 #pragma once
 
 #include "AppWindow.h"
+#include "ovr_memory_allocator.h"
+#include "ovr_shader_cache.h"
+#include "ovr_staging_ring.h"
 
 // std lib headers
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 namespace ovr {
 
+class OvrGeometryPool;
+
+// Identifies one submitted OvrUploadBatch, poll it with OVRDevice::isUploadComplete
+using OvrUploadTicket = uint64_t;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -37,6 +50,7 @@ class OVRDevice {
 #endif
 
   OVRDevice(AppWindow &window);
+  OVRDevice();  // headless: no window, surface or swapchain extension
   ~OVRDevice();
 
   // Not copyable or movable
@@ -46,10 +60,19 @@ class OVRDevice {
   OVRDevice& operator=(OVRDevice &&) = delete;
 
   VkCommandPool getCommandPool() { return commandPool; }
+  // loaded from disk at startup and written back on destruction, pass to every pipeline creation
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  bool isHeadless() const { return window == nullptr; }
+  // multiDrawIndirect and drawIndirectFirstInstance, both enabled when supported
+  bool supportsMultiDrawIndirect() const { return multiDrawIndirect_; }
+  // indirect draws with a nonzero firstInstance, which GpuDrivenRenderSystem needs for every model's instance range
+  bool supportsDrawIndirectFirstInstance() const { return drawIndirectFirstInstance_; }
+  // VK_KHR_draw_indirect_count, null when the device doesn't have it
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const { return cmdDrawIndexedIndirectCount_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -58,15 +81,27 @@ class OVRDevice {
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+  // memory is sub-allocated from the device's OvrMemoryAllocator, release with destroyBuffer
   void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      OvrAllocation &bufferAllocation,
+      OvrAllocationStrategy strategy = OvrAllocationStrategy::FreeList);
+  void destroyBuffer(VkBuffer buffer, OvrAllocation &bufferAllocation);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(
+      VkBuffer srcBuffer,
+      VkBuffer dstBuffer,
+      VkDeviceSize size,
+      VkDeviceSize srcOffset = 0,
+      VkDeviceSize dstOffset = 0);
+  // stages data through the staging ring and submits the copy without waiting for it,
+  // record into an OvrUploadBatch instead when uploading more than one resource
+  OvrUploadTicket uploadBuffer(
+      VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -74,7 +109,26 @@ class OVRDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      OvrAllocation &imageAllocation);
+  void destroyImage(VkImage image, OvrAllocation &imageAllocation);
+
+  // Upload batch submission (see OvrUploadBatch), not thread safe
+  OvrUploadTicket reserveUploadTicket();
+  void cancelUploadTicket(OvrUploadTicket ticket);
+  VkCommandBuffer allocateUploadCommandBuffer();
+  VkFence submitUploadCommandBuffer(VkCommandBuffer commandBuffer, OvrUploadTicket ticket);
+  bool isUploadComplete(OvrUploadTicket ticket);
+  void waitForUpload(OvrUploadTicket ticket);
+  // recycles the fences and command buffers of finished uploads, called once per frame
+  void collectUploads();
+
+  // pipeline creation time, reported on shutdown to compare cold and warm cache starts
+  void recordPipelineCreation(uint64_t nanoseconds);
+
+  OvrMemoryAllocator &memoryAllocator() { return *allocator; }
+  OvrStagingRing &stagingRing() { return *stagingRing_; }
+  OvrShaderCache &shaderCache() { return *shaderCache_; }
+  OvrGeometryPool &geometryPool() { return *geometryPool_; }
 
   VkPhysicalDeviceProperties properties;
 
@@ -85,27 +139,53 @@ class OVRDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createPipelineCache();
+  void savePipelineCache();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
+  std::vector<const char *> getRequiredDeviceExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  std::string pipelineCachePath() const;
+  bool isPipelineCacheDataValid(const std::vector<char> &data) const;
 
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  AppWindow &window;
+  AppWindow *window = nullptr;
   VkCommandPool commandPool;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  bool pipelineCacheWarm = false;  // valid data was found on disk
+  std::atomic<uint32_t> pipelineCreateCount{0};
+  std::atomic<uint64_t> pipelineCreateNanoseconds{0};
+  std::unique_ptr<OvrMemoryAllocator> allocator;
+  std::unique_ptr<OvrStagingRing> stagingRing_;
+  std::unique_ptr<OvrShaderCache> shaderCache_;
+  std::unique_ptr<OvrGeometryPool> geometryPool_;
+
+  struct PendingUpload {
+    VkFence fence;
+    VkCommandBuffer commandBuffer;
+  };
+  OvrUploadTicket nextUploadTicket = 1;
+  std::set<OvrUploadTicket> openUploads;  // reserved, not submitted yet
+  std::map<OvrUploadTicket, PendingUpload> pendingUploads;
+  std::vector<VkFence> freeUploadFences;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  bool multiDrawIndirect_ = false;
+  bool drawIndirectFirstInstance_ = false;
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
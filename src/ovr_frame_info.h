@@ -0,0 +1,27 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_camera.h"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+namespace ovr {
+	class OvrCommandRecorder;
+
+	// Everything a render system needs to record one frame
+	struct FrameInfo {
+		int frameIndex;  // selects the per-frame resources, < MAX_FRAMES_IN_FLIGHT
+		float frameTime;
+		VkCommandBuffer commandBuffer;
+		OvrCamera& camera;
+		// set when the render pass records into secondary command buffers (OvrRenderer::getCommandRecorder),
+		// commandBuffer then only takes vkCmdExecuteCommands inside the pass
+		OvrCommandRecorder* commandRecorder = nullptr;
+	};
+}
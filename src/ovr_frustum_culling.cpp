@@ -0,0 +1,167 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_frustum_culling.h"
+#include "ovr_cpu_features.h"
+
+#ifdef OVR_X86
+#include <immintrin.h>
+#endif
+
+#include <cassert>
+
+namespace ovr {
+	// padding spheres fail every plane test: dot + w < -radius for any finite dot + w
+	static constexpr float CULLED_RADIUS = -3.0e38f;
+
+	void OvrSphereSoA::resize(size_t newCount) {
+		count = newCount;
+		size_t padded = (newCount + PADDING - 1) / PADDING * PADDING;
+		x.assign(padded, 0.f);
+		y.assign(padded, 0.f);
+		z.assign(padded, 0.f);
+		r.assign(padded, CULLED_RADIUS);
+	}
+
+	OvrCullingKernel bestCullingKernel() {
+		const auto& features = OvrCpuFeatures::get();
+		if (features.avx) {
+			return OvrCullingKernel::AVX;
+		}
+#ifdef OVR_X86
+		return OvrCullingKernel::SSE; // part of every x86-64 CPU
+#else
+		return OvrCullingKernel::Scalar;
+#endif
+	}
+
+	static size_t cullSpheresScalar(
+		const OvrSphereSoA& spheres, const OvrFrustumPlanes& planes, size_t begin, size_t end, uint32_t* visibleIndices) {
+		size_t visibleCount = 0;
+		for (size_t i = begin; i < end; i++) {
+			bool visible = true;
+			for (const auto& plane : planes) {
+				float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w;
+				if (distance < -spheres.r[i]) {
+					visible = false;
+					break;
+				}
+			}
+			if (visible) {
+				visibleIndices[visibleCount++] = static_cast<uint32_t>(i);
+			}
+		}
+		return visibleCount;
+	}
+
+#ifdef OVR_X86
+	static size_t cullSpheresSSE(
+		const OvrSphereSoA& spheres, const OvrFrustumPlanes& planes, size_t begin, size_t end, uint32_t* visibleIndices) {
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 signMask = _mm_set1_ps(-0.f);
+
+		size_t visibleCount = 0;
+		for (size_t i = begin; i < end; i += 4) {
+			__m128 x = _mm_loadu_ps(&spheres.x[i]);
+			__m128 y = _mm_loadu_ps(&spheres.y[i]);
+			__m128 z = _mm_loadu_ps(&spheres.z[i]);
+			__m128 negRadius = _mm_xor_ps(_mm_loadu_ps(&spheres.r[i]), signMask);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			unsigned int mask = static_cast<unsigned int>(_mm_movemask_ps(inside));
+			while (mask) {
+				visibleIndices[visibleCount++] = static_cast<uint32_t>(i + lowestBitIndex(mask));
+				mask &= mask - 1;
+			}
+		}
+		return visibleCount;
+	}
+
+	OVR_TARGET_AVX
+	static size_t cullSpheresAVX(
+		const OvrSphereSoA& spheres, const OvrFrustumPlanes& planes, size_t begin, size_t end, uint32_t* visibleIndices) {
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm256_set1_ps(planes[p].x);
+			planeY[p] = _mm256_set1_ps(planes[p].y);
+			planeZ[p] = _mm256_set1_ps(planes[p].z);
+			planeW[p] = _mm256_set1_ps(planes[p].w);
+		}
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+
+		size_t visibleCount = 0;
+		for (size_t i = begin; i < end; i += 8) {
+			__m256 x = _mm256_loadu_ps(&spheres.x[i]);
+			__m256 y = _mm256_loadu_ps(&spheres.y[i]);
+			__m256 z = _mm256_loadu_ps(&spheres.z[i]);
+			__m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(&spheres.r[i]), signMask);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(inside));
+			while (mask) {
+				visibleIndices[visibleCount++] = static_cast<uint32_t>(i + lowestBitIndex(mask));
+				mask &= mask - 1;
+			}
+		}
+		return visibleCount;
+	}
+#endif
+
+	size_t cullSpheres(
+		const OvrSphereSoA& spheres,
+		const OvrFrustumPlanes& planes,
+		uint32_t* visibleIndices,
+		OvrCullingKernel kernel) {
+		return cullSpheres(spheres, planes, 0, spheres.size(), visibleIndices, kernel);
+	}
+
+	size_t cullSpheres(
+		const OvrSphereSoA& spheres,
+		const OvrFrustumPlanes& planes,
+		size_t begin,
+		size_t end,
+		uint32_t* visibleIndices,
+		OvrCullingKernel kernel) {
+		assert(begin % OvrSphereSoA::PADDING == 0 && "Range must start at a multiple of the padding");
+		assert((end % OvrSphereSoA::PADDING == 0 || end == spheres.size()) && "Range must end at a multiple of the padding");
+		// the vector kernels may run into the padding, it is always culled
+		const size_t vectorEnd = end == spheres.size() ? spheres.paddedSize() : end;
+#ifdef OVR_X86
+		switch (kernel) {
+		case OvrCullingKernel::AVX:
+			if (OvrCpuFeatures::get().avx) {
+				return cullSpheresAVX(spheres, planes, begin, vectorEnd, visibleIndices);
+			}
+			return cullSpheresSSE(spheres, planes, begin, vectorEnd, visibleIndices);
+		case OvrCullingKernel::SSE:
+			return cullSpheresSSE(spheres, planes, begin, vectorEnd, visibleIndices);
+		default:
+			break;
+		}
+#endif
+		return cullSpheresScalar(spheres, planes, begin, end, visibleIndices);
+	}
+}
@@ -0,0 +1,75 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	using OvrFrustumPlanes = std::array<glm::vec4, 6>; // see OvrCamera::getFrustumPlanes
+
+	// World space bounding spheres as separate arrays so the kernels can load 4 or 8 at once.
+	// Storage is padded to a multiple of 8 with spheres that are always culled.
+	class OvrSphereSoA {
+	public:
+		static constexpr size_t PADDING = 8;
+
+		void resize(size_t count);
+		size_t size() const { return count; }
+		size_t paddedSize() const { return x.size(); }
+
+		void set(size_t index, const glm::vec3& center, float radius) {
+			x[index] = center.x;
+			y[index] = center.y;
+			z[index] = center.z;
+			r[index] = radius;
+		}
+
+		std::vector<float> x, y, z, r;
+
+	private:
+		size_t count = 0;
+	};
+
+	struct OvrCullingStats {
+		uint32_t visible = 0;
+		uint32_t culled = 0;
+	};
+
+	enum class OvrCullingKernel {
+		Scalar,
+		SSE,  // 4 spheres per iteration
+		AVX   // 8 spheres per iteration
+	};
+
+	// widest kernel this CPU supports
+	OvrCullingKernel bestCullingKernel();
+
+	// writes the indices of the spheres touching the frustum to visibleIndices (room for spheres.size()),
+	// returns how many were written. Indices come out in increasing order.
+	size_t cullSpheres(
+		const OvrSphereSoA& spheres,
+		const OvrFrustumPlanes& planes,
+		uint32_t* visibleIndices,
+		OvrCullingKernel kernel = bestCullingKernel());
+	// only spheres [begin, end), so ranges can be culled on different threads. begin must be a multiple of
+	// OvrSphereSoA::PADDING and end too unless it is spheres.size(), visibleIndices needs room for end - begin.
+	size_t cullSpheres(
+		const OvrSphereSoA& spheres,
+		const OvrFrustumPlanes& planes,
+		size_t begin,
+		size_t end,
+		uint32_t* visibleIndices,
+		OvrCullingKernel kernel = bestCullingKernel());
+}
@@ -3,6 +3,14 @@
 namespace ovr {
 
     glm::mat4 TransformComponent::mat4() {
+        return makeMat4(translation, rotation, scale);
+    }
+
+    glm::mat3 TransformComponent::normalMatrix() {
+        return makeNormalMatrix(rotation, scale);
+    }
+
+    glm::mat4 TransformComponent::makeMat4(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale) {
         const float c3 = glm::cos(rotation.z);
         const float s3 = glm::sin(rotation.z);
         const float c2 = glm::cos(rotation.x);
@@ -31,7 +39,7 @@ namespace ovr {
             {translation.x, translation.y, translation.z, 1.0f} };
     }
 
-    glm::mat3 TransformComponent::normalMatrix() {
+    glm::mat3 TransformComponent::makeNormalMatrix(const glm::vec3& rotation, const glm::vec3& scale) {
         const float c3 = glm::cos(rotation.z);
         const float s3 = glm::sin(rotation.z);
         const float c2 = glm::cos(rotation.x);
@@ -59,4 +67,29 @@ namespace ovr {
         };
     }
 
+    void TransformComponent::makeMatrices(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale,
+        glm::mat4& world, glm::mat3& normal) {
+        const float c3 = glm::cos(rotation.z);
+        const float s3 = glm::sin(rotation.z);
+        const float c2 = glm::cos(rotation.x);
+        const float s2 = glm::sin(rotation.x);
+        const float c1 = glm::cos(rotation.y);
+        const float s1 = glm::sin(rotation.y);
+        const glm::mat3 rotationMatrix{
+            {c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1},
+            {c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3},
+            {c2 * s1, -s2, c1 * c2} };
+        const glm::vec3 invScale = 1.0f / scale;
+
+        world = glm::mat4{
+            glm::vec4{scale.x * rotationMatrix[0], 0.0f},
+            glm::vec4{scale.y * rotationMatrix[1], 0.0f},
+            glm::vec4{scale.z * rotationMatrix[2], 0.0f},
+            glm::vec4{translation, 1.0f} };
+        normal = glm::mat3{
+            invScale.x * rotationMatrix[0],
+            invScale.y * rotationMatrix[1],
+            invScale.z * rotationMatrix[2] };
+    }
+
 }  // namespace ovr
\ No newline at end of file
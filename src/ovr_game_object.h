@@ -27,6 +27,13 @@ namespace ovr {
 		glm::mat4 mat4();
 
 		glm::mat3 normalMatrix();
+
+		// same as above for components stored outside a TransformComponent, see OvrScene
+		static glm::mat4 makeMat4(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+		static glm::mat3 makeNormalMatrix(const glm::vec3& rotation, const glm::vec3& scale);
+		// both at once from a single set of sin/cos
+		static void makeMatrices(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale,
+			glm::mat4& world, glm::mat3& normal);
 	};
 
 	class OvrGameObject {
@@ -35,8 +42,12 @@ namespace ovr {
 
 		OvrGameObject() {};
 		static OvrGameObject createGameObject() {
+			return OvrGameObject{ nextId() };
+		}
+		// shared with OvrScene entities so ids are unique across both
+		static id_t nextId() {
 			static id_t currentId = 0;
-			return OvrGameObject{ currentId };
+			return currentId++;
 		}
 		OvrGameObject(const OvrGameObject&) = delete;
 		OvrGameObject& operator =(const OvrGameObject&) = delete;
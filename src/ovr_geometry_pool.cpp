@@ -0,0 +1,266 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_geometry_pool.h"
+#include "ovr_model.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace ovr {
+
+	bool OvrGeometryPool::Ranges::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+	{
+		// first fit, the alignment padding in front goes back to the free list
+		auto it = freeRanges.begin();
+		for (; it != freeRanges.end(); ++it) {
+			offset = (it->first + alignment - 1) / alignment * alignment;
+			if (offset + size <= it->first + it->second) {
+				break;
+			}
+		}
+		if (it == freeRanges.end()) {
+			return false;
+		}
+
+		const VkDeviceSize rangeOffset = it->first;
+		const VkDeviceSize rangeEnd = it->first + it->second;
+		freeRanges.erase(it);
+		if (rangeOffset < offset) {
+			freeRanges[rangeOffset] = offset - rangeOffset;
+		}
+		if (offset + size < rangeEnd) {
+			freeRanges[offset + size] = rangeEnd - (offset + size);
+		}
+		used += size;
+		return true;
+	}
+
+	void OvrGeometryPool::Ranges::free(VkDeviceSize offset, VkDeviceSize size)
+	{
+		// insert the range back and merge it with its neighbours
+		used -= size;
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && offset + size == next->first) {
+			size += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				offset = prev->first;
+				size += prev->second;
+				freeRanges.erase(prev);
+			}
+		}
+		freeRanges[offset] = size;
+	}
+
+	OvrGeometryPool::OvrGeometryPool(OVRDevice& device)
+		: ovrDevice{ device }, vertexPages(OvrModel::VERTEX_LAYOUT_COUNT) {}
+
+	OvrGeometryPool::~OvrGeometryPool()
+	{
+		for (auto& pages : vertexPages) {
+			for (auto& page : pages) {
+				assert(page->ranges.used == 0 && "a model outlived the geometry pool");
+				for (size_t stream = 0; stream < page->buffers.size(); stream++) {
+					ovrDevice.destroyBuffer(page->buffers[stream], page->allocations[stream]);
+				}
+			}
+		}
+		for (auto& page : indexPages) {
+			assert(page->ranges.used == 0 && "a model outlived the geometry pool");
+			ovrDevice.destroyBuffer(page->buffer, page->allocation);
+		}
+	}
+
+	OvrGeometryPool::VertexRange OvrGeometryPool::allocateVertices(uint32_t vertexLayout, uint32_t count)
+	{
+		assert(vertexLayout < OvrModel::VERTEX_LAYOUT_COUNT && "unknown vertex layout");
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto& pages = vertexPages[vertexLayout];
+		VertexRange range{ vertexLayout, INVALID_PAGE, 0, count };
+
+		VkDeviceSize firstVertex = 0;
+		for (size_t i = 0; i < pages.size(); i++) {
+			if (pages[i]->ranges.allocate(count, 1, firstVertex)) {
+				range.page = static_cast<uint32_t>(i);
+				range.firstVertex = static_cast<uint32_t>(firstVertex);
+				return range;
+			}
+		}
+
+		auto page = std::make_unique<VertexPage>();
+		page->streams = OvrModel::getBindingDescriptions(vertexLayout, OvrModel::ALL_STREAMS);
+		page->capacity = std::max(VERTEX_PAGE_CAPACITY, count);
+		page->buffers.resize(page->streams.size());
+		page->allocations.resize(page->streams.size());
+		for (size_t stream = 0; stream < page->streams.size(); stream++) {
+			ovrDevice.createBuffer(
+				static_cast<VkDeviceSize>(page->streams[stream].stride) * page->capacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				page->buffers[stream],
+				page->allocations[stream]);
+		}
+		page->ranges.freeRanges[0] = page->capacity;
+		if (!page->ranges.allocate(count, 1, firstVertex)) {
+			throw std::runtime_error("failed to allocate vertices from a new geometry page!");
+		}
+		range.page = static_cast<uint32_t>(pages.size());
+		range.firstVertex = static_cast<uint32_t>(firstVertex);
+		pages.push_back(std::move(page));
+		return range;
+	}
+
+	OvrGeometryPool::IndexRange OvrGeometryPool::allocateIndices(VkIndexType indexType, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		const VkDeviceSize size = static_cast<VkDeviceSize>(indexSize(indexType)) * count;
+		IndexRange range{ INVALID_PAGE, indexType, 0, count };
+
+		VkDeviceSize offset = 0;
+		for (size_t i = 0; i < indexPages.size(); i++) {
+			if (indexPages[i]->ranges.allocate(size, indexSize(indexType), offset)) {
+				range.page = static_cast<uint32_t>(i);
+				range.firstIndex = static_cast<uint32_t>(offset / indexSize(indexType));
+				return range;
+			}
+		}
+
+		auto page = std::make_unique<IndexPage>();
+		page->size = std::max(INDEX_PAGE_SIZE, size);
+		ovrDevice.createBuffer(
+			page->size,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			page->buffer,
+			page->allocation);
+		page->ranges.freeRanges[0] = page->size;
+		if (!page->ranges.allocate(size, indexSize(indexType), offset)) {
+			throw std::runtime_error("failed to allocate indices from a new geometry page!");
+		}
+		range.page = static_cast<uint32_t>(indexPages.size());
+		range.firstIndex = static_cast<uint32_t>(offset / indexSize(indexType));
+		indexPages.push_back(std::move(page));
+		return range;
+	}
+
+	void OvrGeometryPool::free(VertexRange& range)
+	{
+		if (range.page == INVALID_PAGE) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock{ mutex };
+		vertexPages[range.vertexLayout][range.page]->ranges.free(range.firstVertex, range.count);
+		range.page = INVALID_PAGE;
+	}
+
+	void OvrGeometryPool::free(IndexRange& range)
+	{
+		if (range.page == INVALID_PAGE) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock{ mutex };
+		const VkDeviceSize size = indexSize(range.indexType);
+		indexPages[range.page]->ranges.free(range.firstIndex * size, range.count * size);
+		range.page = INVALID_PAGE;
+	}
+
+	VkBuffer OvrGeometryPool::getVertexBuffer(const VertexRange& range, uint32_t binding, VkDeviceSize& offset) const
+	{
+		const VertexPage& page = *vertexPages[range.vertexLayout][range.page];
+		for (size_t stream = 0; stream < page.streams.size(); stream++) {
+			if (page.streams[stream].binding == binding) {
+				offset = static_cast<VkDeviceSize>(page.streams[stream].stride) * range.firstVertex;
+				return page.buffers[stream];
+			}
+		}
+		throw std::runtime_error("failed to find the vertex stream of a binding!");
+	}
+
+	VkBuffer OvrGeometryPool::getIndexBuffer(const IndexRange& range) const
+	{
+		return indexPages[range.page]->buffer;
+	}
+
+	void OvrGeometryPool::bindVertices(
+		VkCommandBuffer commandBuffer, const VertexRange& range, uint32_t streams, BindState* state) const
+	{
+		if (state != nullptr && state->vertexLayout == range.vertexLayout && state->vertexPage == range.page &&
+			(state->streams & streams) == streams) {
+			return;
+		}
+
+		const VertexPage& page = *vertexPages[range.vertexLayout][range.page];
+		// an interleaved page has the attributes in its position buffer, so it binds that anyway
+		const bool interleaved = std::none_of(page.streams.begin(), page.streams.end(),
+			[](const VkVertexInputBindingDescription& stream) { return stream.binding == OvrModel::ATTRIBUTE_BINDING; });
+		const VkDeviceSize offsets[] = { 0 };
+		for (size_t stream = 0; stream < page.streams.size(); stream++) {
+			const bool wanted = page.streams[stream].binding == OvrModel::POSITION_BINDING
+				? (streams & OvrModel::POSITION_STREAM) || interleaved
+				: (streams & OvrModel::ATTRIBUTE_STREAM) != 0;
+			if (wanted) {
+				vkCmdBindVertexBuffers(commandBuffer, page.streams[stream].binding, 1, &page.buffers[stream], offsets);
+			}
+		}
+
+		if (state != nullptr) {
+			const bool samePage = state->vertexLayout == range.vertexLayout && state->vertexPage == range.page;
+			state->streams = samePage ? state->streams | streams : streams;
+			state->vertexLayout = range.vertexLayout;
+			state->vertexPage = range.page;
+		}
+	}
+
+	void OvrGeometryPool::bindIndices(VkCommandBuffer commandBuffer, const IndexRange& range, BindState* state) const
+	{
+		if (state != nullptr && state->indexPage == range.page && state->indexType == range.indexType) {
+			return;
+		}
+		vkCmdBindIndexBuffer(commandBuffer, indexPages[range.page]->buffer, 0, range.indexType);
+		if (state != nullptr) {
+			state->indexPage = range.page;
+			state->indexType = range.indexType;
+		}
+	}
+
+	OvrGeometryPool::Stats OvrGeometryPool::getStats()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		Stats stats{};
+		for (const auto& pages : vertexPages) {
+			for (const auto& page : pages) {
+				VkDeviceSize vertexSize = 0;
+				for (const auto& stream : page->streams) {
+					vertexSize += stream.stride;
+				}
+				stats.vertexPageCount++;
+				stats.vertexBytes += vertexSize * page->capacity;
+				stats.vertexBytesUsed += vertexSize * page->ranges.used;
+			}
+		}
+		for (const auto& page : indexPages) {
+			stats.indexPageCount++;
+			stats.indexBytes += page->size;
+			stats.indexBytesUsed += page->ranges.used;
+		}
+		return stats;
+	}
+
+	void OvrGeometryPool::printStats()
+	{
+		Stats s = getStats();
+		std::cout << "geometry pool: " << s.vertexPageCount << " vertex pages (used " << s.vertexBytesUsed / 1024
+			<< " of " << s.vertexBytes / 1024 << " KiB), " << s.indexPageCount << " index pages (used "
+			<< s.indexBytesUsed / 1024 << " of " << s.indexBytes / 1024 << " KiB)" << std::endl;
+	}
+}
@@ -0,0 +1,119 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_device.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ovr {
+
+	// Sub-allocates the geometry of every OvrModel from a few large buffers, so consecutive draws share
+	// their bindings and address their mesh with firstIndex/vertexOffset. Owned by OVRDevice.
+	// Vertices: pages per OvrModel vertex layout, with one buffer per stream of the layout. A mesh takes
+	// the same vertex range in each, so vertexOffset addresses all of its streams.
+	// Indices: pages shared by 16 and 32 bit indices, a range starts at a multiple of its index size so
+	// firstIndex addresses it whatever type the page is bound as.
+	// A full page is never grown, the next mesh goes to a new page, sized for it if it is bigger. Pages
+	// live as long as the pool, emptied ones are reused.
+	class OvrGeometryPool {
+	public:
+		static constexpr uint32_t VERTEX_PAGE_CAPACITY = 1u << 18;  // vertices per page of a layout
+		static constexpr VkDeviceSize INDEX_PAGE_SIZE = 16ull << 20; // bytes
+		static constexpr uint32_t INVALID_PAGE = 0xFFFFFFFFu;
+
+		struct VertexRange {
+			uint32_t vertexLayout = 0;
+			uint32_t page = INVALID_PAGE;
+			uint32_t firstVertex = 0; // vertexOffset of the draws
+			uint32_t count = 0;
+		};
+
+		struct IndexRange {
+			uint32_t page = INVALID_PAGE;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+			uint32_t firstIndex = 0; // in indices of indexType from the page start
+			uint32_t count = 0;
+		};
+
+		// what is bound in a command buffer, lets bind skip consecutive draws from the same pages
+		struct BindState {
+			uint32_t vertexLayout = INVALID_PAGE;
+			uint32_t vertexPage = INVALID_PAGE;
+			uint32_t streams = 0;
+			uint32_t indexPage = INVALID_PAGE;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		};
+
+		struct Stats {
+			uint32_t vertexPageCount = 0;
+			uint32_t indexPageCount = 0;
+			VkDeviceSize vertexBytes = 0; // of all pages
+			VkDeviceSize vertexBytesUsed = 0;
+			VkDeviceSize indexBytes = 0;
+			VkDeviceSize indexBytesUsed = 0;
+		};
+
+		OvrGeometryPool(OVRDevice& device);
+		~OvrGeometryPool(); // every range must be freed, the GPU must be done with the pages
+
+		OvrGeometryPool(const OvrGeometryPool&) = delete;
+		OvrGeometryPool& operator=(const OvrGeometryPool&) = delete;
+
+		VertexRange allocateVertices(uint32_t vertexLayout, uint32_t count);
+		IndexRange allocateIndices(VkIndexType indexType, uint32_t count);
+		void free(VertexRange& range);
+		void free(IndexRange& range);
+
+		// the buffer of the range's stream at binding and the byte offset of its first vertex there
+		VkBuffer getVertexBuffer(const VertexRange& range, uint32_t binding, VkDeviceSize& offset) const;
+		VkBuffer getIndexBuffer(const IndexRange& range) const;
+
+		// binds the pages of the ranges, streams as in OvrModel::bind, unless state says they are bound
+		void bindVertices(VkCommandBuffer commandBuffer, const VertexRange& range, uint32_t streams, BindState* state) const;
+		void bindIndices(VkCommandBuffer commandBuffer, const IndexRange& range, BindState* state) const;
+
+		Stats getStats();
+		void printStats();
+
+	private:
+		// free ranges of a page, first fit and coalesced like OvrMemoryAllocator's free list
+		struct Ranges {
+			std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size
+			VkDeviceSize used = 0;
+
+			bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+			void free(VkDeviceSize offset, VkDeviceSize size);
+		};
+
+		struct VertexPage {
+			std::vector<VkVertexInputBindingDescription> streams; // binding and stride of every stream
+			std::vector<VkBuffer> buffers;
+			std::vector<OvrAllocation> allocations;
+			uint32_t capacity = 0; // vertices
+			Ranges ranges;         // in vertices
+		};
+
+		struct IndexPage {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			OvrAllocation allocation{};
+			VkDeviceSize size = 0;
+			Ranges ranges; // in bytes
+		};
+
+		static uint32_t indexSize(VkIndexType indexType) { return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+
+		OVRDevice& ovrDevice;
+		std::vector<std::vector<std::unique_ptr<VertexPage>>> vertexPages; // [vertex layout][page]
+		std::vector<std::unique_ptr<IndexPage>> indexPages;
+		std::mutex mutex; // models are created and destroyed on any thread
+	};
+}
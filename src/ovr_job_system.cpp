@@ -0,0 +1,198 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_job_system.h"
+
+#include <algorithm>
+
+namespace ovr {
+	// which worker of which job system the current thread is
+	static thread_local const OvrJobSystem* currentJobSystem = nullptr;
+	static thread_local uint32_t currentWorkerIndex = 0;
+
+	OvrJobSystem::OvrJobSystem(uint32_t threadCount) {
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency()); // may report 0
+		}
+		const uint32_t workerCount = threadCount - 1;
+		for (uint32_t i = 0; i <= workerCount; i++) {
+			queues.push_back(std::make_unique<WorkerQueue>());
+		}
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back(&OvrJobSystem::workerLoop, this, i);
+		}
+	}
+
+	OvrJobSystem::~OvrJobSystem() {
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	uint32_t OvrJobSystem::getThreadIndex() const {
+		return currentJobSystem == this ? currentWorkerIndex : getWorkerCount();
+	}
+
+	void OvrJobSystem::run(std::function<void()> job, OvrJobCounter* counter) {
+		if (counter != nullptr) {
+			counter->pending.fetch_add(1, std::memory_order_acq_rel);
+		}
+		push(Job{ std::move(job), counter });
+	}
+
+	void OvrJobSystem::runAfter(OvrJobCounter& dependency, std::function<void()> job, OvrJobCounter* counter) {
+		if (counter != nullptr) {
+			counter->pending.fetch_add(1, std::memory_order_acq_rel);
+		}
+		{
+			// finish() takes the same lock when it drops dependency to zero, so the continuation is
+			// either seen by it or the count was already zero here
+			std::lock_guard<std::mutex> lock{ dependency.mutex };
+			if (dependency.pending.load(std::memory_order_acquire) != 0) {
+				dependency.continuations.push_back({ std::move(job), counter });
+				return;
+			}
+		}
+		push(Job{ std::move(job), counter });
+	}
+
+	void OvrJobSystem::wait(OvrJobCounter& counter) {
+		const uint32_t threadIndex = getThreadIndex();
+		while (!counter.isDone()) {
+			Job job;
+			if (pop(threadIndex, job) || steal(threadIndex, job)) {
+				execute(job);
+			}
+			else {
+				std::this_thread::yield(); // the last jobs are running elsewhere
+			}
+		}
+		// the thread that brought it to zero may still hold the lock, the caller is free to destroy it after
+		std::lock_guard<std::mutex> lock{ counter.mutex };
+	}
+
+	void OvrJobSystem::parallelFor(
+		uint32_t count,
+		uint32_t grainSize,
+		const std::function<void(uint32_t begin, uint32_t end)>& function) {
+		if (count == 0) {
+			return;
+		}
+		if (grainSize == 0) {
+			grainSize = std::max(1u, count / (getThreadCount() * 4));
+		}
+		OvrJobCounter counter{};
+		splitRange(0, count, grainSize, function, counter);
+		wait(counter);
+	}
+
+	void OvrJobSystem::splitRange(
+		uint32_t begin,
+		uint32_t end,
+		uint32_t grainSize,
+		const std::function<void(uint32_t, uint32_t)>& function,
+		OvrJobCounter& counter) {
+		// hand the upper half to whoever steals it, keep going with the lower half
+		while (end - begin > grainSize) {
+			uint32_t middle = begin + (end - begin) / 2;
+			run([this, middle, end, grainSize, &function, &counter]() {
+				splitRange(middle, end, grainSize, function, counter);
+			}, &counter);
+			end = middle;
+		}
+		function(begin, end);
+	}
+
+	void OvrJobSystem::workerLoop(uint32_t workerIndex) {
+		currentJobSystem = this;
+		currentWorkerIndex = workerIndex;
+		while (true) {
+			Job job;
+			if (pop(workerIndex, job) || steal(workerIndex, job)) {
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			// push() reads sleepingWorkers after bumping queuedJobs, so either it sees this worker asleep
+			// and notifies under the lock, or the predicate below already sees its job
+			sleepingWorkers.fetch_add(1);
+			jobAvailable.wait(lock, [this]() { return stopping || queuedJobs.load() > 0; });
+			sleepingWorkers.fetch_sub(1);
+			if (stopping && queuedJobs.load() == 0) {
+				return; // stopping and drained
+			}
+		}
+	}
+
+	void OvrJobSystem::push(Job job) {
+		WorkerQueue& queue = *queues[getThreadIndex()];
+		{
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			queue.jobs.push_back(std::move(job));
+		}
+		queuedJobs.fetch_add(1);
+		if (sleepingWorkers.load() > 0) {
+			{
+				std::lock_guard<std::mutex> lock{ sleepMutex };
+			}
+			jobAvailable.notify_one();
+		}
+	}
+
+	bool OvrJobSystem::pop(uint32_t threadIndex, Job& job) {
+		WorkerQueue& queue = *queues[threadIndex];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		if (queue.jobs.empty()) {
+			return false;
+		}
+		job = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+		queuedJobs.fetch_sub(1);
+		return true;
+	}
+
+	bool OvrJobSystem::steal(uint32_t threadIndex, Job& job) {
+		const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+		for (uint32_t i = 1; i < queueCount; i++) {
+			WorkerQueue& queue = *queues[(threadIndex + i) % queueCount];
+			std::unique_lock<std::mutex> lock{ queue.mutex, std::try_to_lock };
+			if (!lock.owns_lock() || queue.jobs.empty()) {
+				continue; // busy or empty, try the next victim
+			}
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			queuedJobs.fetch_sub(1);
+			return true;
+		}
+		return false;
+	}
+
+	void OvrJobSystem::execute(Job& job) {
+		job.function();
+		if (job.counter != nullptr) {
+			finish(*job.counter);
+		}
+	}
+
+	void OvrJobSystem::finish(OvrJobCounter& counter) {
+		std::vector<OvrJobCounter::Continuation> ready;
+		{
+			std::lock_guard<std::mutex> lock{ counter.mutex };
+			if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				ready.swap(counter.continuations);
+			}
+		}
+		for (auto& continuation : ready) {
+			push(Job{ std::move(continuation.function), continuation.counter });
+		}
+	}
+}
@@ -0,0 +1,104 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ovr {
+
+	// Number of jobs still pending, jobs started with a counter increment it and decrement it when they
+	// finish. Other jobs can be made to wait for it with OvrJobSystem::runAfter.
+	// Must outlive the jobs it counts, OvrJobSystem::wait on it before it goes out of scope.
+	class OvrJobCounter {
+	public:
+		OvrJobCounter() = default;
+		OvrJobCounter(const OvrJobCounter&) = delete;
+		OvrJobCounter& operator=(const OvrJobCounter&) = delete;
+
+		bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class OvrJobSystem;
+		struct Continuation {
+			std::function<void()> function;
+			OvrJobCounter* counter;
+		};
+
+		std::atomic<uint32_t> pending{ 0 };
+		std::mutex mutex; // guards continuations and the transition to zero
+		std::vector<Continuation> continuations; // started once pending drops to zero
+	};
+
+	// Work stealing job system. Every worker owns a deque: it pushes and pops its own jobs at the back
+	// (newest first, still warm in cache) and steals from the front of the others' when it runs dry.
+	// Jobs started from outside a worker go into one shared deque that every worker steals from.
+	// Threads waiting on a counter run jobs instead of blocking, so jobs may wait on jobs they start.
+	class OvrJobSystem {
+	public:
+		// threadCount counts the thread that waits, so threadCount - 1 workers are started and 1 runs every
+		// job inside wait. 0 picks hardware_concurrency
+		explicit OvrJobSystem(uint32_t threadCount = 0);
+		~OvrJobSystem(); // runs every job still queued before returning
+
+		OvrJobSystem(const OvrJobSystem&) = delete;
+		OvrJobSystem& operator=(const OvrJobSystem&) = delete;
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+		// workers plus the one calling thread that helps while waiting
+		uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+		// 0..getWorkerCount()-1 on a worker, getWorkerCount() on any other thread
+		uint32_t getThreadIndex() const;
+
+		// counter, when set, is incremented now and decremented once job has run
+		void run(std::function<void()> job, OvrJobCounter* counter = nullptr);
+		// starts job once dependency reaches zero, which may be right away
+		void runAfter(OvrJobCounter& dependency, std::function<void()> job, OvrJobCounter* counter = nullptr);
+		// runs queued jobs until counter reaches zero, exceptions from jobs end the program
+		void wait(OvrJobCounter& counter);
+
+		// Calls function(begin, end) over [0, count) in ranges of at most grainSize, returns when all are
+		// done. Ranges are split in halves, so a thief takes half of what is left instead of one range.
+		// 0 grainSize splits into about four ranges per thread.
+		void parallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+	private:
+		struct Job {
+			std::function<void()> function;
+			OvrJobCounter* counter = nullptr;
+		};
+		struct alignas(64) WorkerQueue { // own cache line, the owner and thieves hit different queues
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void workerLoop(uint32_t workerIndex);
+		void push(Job job);
+		bool pop(uint32_t threadIndex, Job& job);
+		bool steal(uint32_t threadIndex, Job& job);
+		void execute(Job& job);
+		void finish(OvrJobCounter& counter);
+		void splitRange(uint32_t begin, uint32_t end, uint32_t grainSize,
+			const std::function<void(uint32_t, uint32_t)>& function, OvrJobCounter& counter);
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkerQueue>> queues; // one per worker, then the shared one
+
+		std::atomic<uint32_t> queuedJobs{ 0 };
+		std::atomic<uint32_t> sleepingWorkers{ 0 };
+		std::mutex sleepMutex;
+		std::condition_variable jobAvailable;
+		bool stopping = false;
+	};
+}
@@ -0,0 +1,84 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_lod_selector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ovr {
+	void OvrLodSelector::setEnabled(bool enable)
+	{
+		enabled = enable;
+		levels.clear();
+	}
+
+	void OvrLodSelector::beginFrame(const OvrCamera& camera, float viewportHeight)
+	{
+		// an error e at view depth z covers e * projection[1][1] / z of the 2 units tall clip space,
+		// an orthographic projection (projection[2][3] == 0) doesn't divide by z
+		const glm::mat4& projection = camera.getProjection();
+		cameraPosition = camera.getPosition();
+		pixelsPerUnit = std::abs(projection[1][1]) * viewportHeight * 0.5f;
+		perspective = projection[2][3] != 0.f;
+	}
+
+	float OvrLodSelector::projectError(float worldError, const glm::vec3& center, float radius) const
+	{
+		if (!perspective) {
+			return worldError * pixelsPerUnit;
+		}
+		const float distance = glm::length(center - cameraPosition) - radius;
+		if (distance <= 0.f) {
+			return std::numeric_limits<float>::infinity();
+		}
+		return worldError * pixelsPerUnit / distance;
+	}
+
+	uint32_t OvrLodSelector::select(OvrScene::id_t id, const OvrModel::Lod* lods, uint32_t lodCount,
+		const glm::vec3& worldCenter, float worldRadius, float scale)
+	{
+		if (!enabled || lodCount <= 1) {
+			return 0;
+		}
+		if (id >= levels.size()) {
+			levels.resize(static_cast<size_t>(id) + 1, 0);
+		}
+		// the distance is the same for every level, only the error differs
+		const float pixelsPerError = projectError(scale, worldCenter, worldRadius);
+		auto fits = [&](uint32_t level, float limit) { return lods[level].error * pixelsPerError <= limit; };
+
+		uint32_t current = std::min<uint32_t>(levels[id], lodCount - 1);
+		if (!fits(current, maxPixelError * (1.f + hysteresis))) {
+			// too coarse even with the margin, the coarsest one that fits without it
+			while (current > 0 && !fits(current, maxPixelError)) {
+				current--;
+			}
+		}
+		else {
+			while (current + 1 < lodCount && fits(current + 1, maxPixelError * (1.f - hysteresis))) {
+				current++;
+			}
+		}
+		levels[id] = static_cast<uint8_t>(current);
+		return current;
+	}
+
+	uint32_t OvrLodSelector::select(const OvrScene& scene, uint32_t index)
+	{
+		const OvrModel* model = scene.getModel(scene.getModelHandles()[index]);
+		if (!enabled || model->getLodCount() <= 1) {
+			return 0;
+		}
+		const glm::mat4& m = scene.getWorldMatrices()[index];
+		const glm::vec4& sphere = model->getBoundingSphere();
+		const float scale = glm::sqrt(glm::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+			glm::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])))));
+		return select(scene.getIds()[index], model->getLods().data(), model->getLodCount(),
+			glm::vec3(m * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * scale, scale);
+	}
+}
@@ -0,0 +1,60 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_camera.h"
+#include "ovr_model.h"
+#include "ovr_scene.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	// Picks an OvrModel::Lod per entity: the coarsest level whose error, projected at the entity's
+	// distance with the camera's projection, stays under maxPixelError.
+	// The level last picked for every entity id is remembered. A coarser one is only taken once its error
+	// is a hysteresis fraction under the limit and the current one is only left for a finer one once its
+	// error is that much over, so an entity sitting at a switching distance doesn't pop every frame.
+	class OvrLodSelector {
+	public:
+		static constexpr float DEFAULT_MAX_PIXEL_ERROR = 1.f;
+		static constexpr float DEFAULT_HYSTERESIS = 0.25f;
+
+		void setMaxPixelError(float pixels) { maxPixelError = pixels; }
+		float getMaxPixelError() const { return maxPixelError; }
+		void setHysteresis(float fraction) { hysteresis = fraction; }
+		// off always picks level 0, the entities' levels are forgotten
+		void setEnabled(bool enable);
+		bool isEnabled() const { return enabled; }
+
+		// once per frame before select, viewportHeight in pixels
+		void beginFrame(const OvrCamera& camera, float viewportHeight);
+
+		// pixels covered by a world space error at the nearest point of a world space bounding sphere,
+		// infinite when the camera is inside it
+		float projectError(float worldError, const glm::vec3& center, float radius) const;
+
+		// the level for entity id drawing lods, the model space errors are scaled by the world matrix's
+		// largest axis scale
+		uint32_t select(OvrScene::id_t id, const OvrModel::Lod* lods, uint32_t lodCount,
+			const glm::vec3& worldCenter, float worldRadius, float scale);
+		// the same for the entity at a dense index of scene, from its world matrix and model
+		uint32_t select(const OvrScene& scene, uint32_t index);
+
+	private:
+		float maxPixelError = DEFAULT_MAX_PIXEL_ERROR;
+		float hysteresis = DEFAULT_HYSTERESIS;
+		bool enabled = true;
+
+		glm::vec3 cameraPosition{ 0.f };
+		float pixelsPerUnit = 0.f; // at distance 1 when perspective
+		bool perspective = true;
+
+		std::vector<uint8_t> levels; // entity id -> level last picked
+	};
+}
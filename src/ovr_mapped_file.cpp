@@ -0,0 +1,123 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+#include <utility>
+
+namespace ovr {
+#ifdef _WIN32
+	OvrMappedFile::OvrMappedFile(const std::string& filepath) {
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize{};
+		GetFileSizeEx(file, &fileSize);
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+		if (size_ == 0) {
+			return; // empty files can't be mapped
+		}
+
+		mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) {
+			unmap();
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+		data_ = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (data_ == nullptr) {
+			unmap();
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+	}
+
+	void OvrMappedFile::unmap() {
+		if (data_) {
+			UnmapViewOfFile(data_);
+		}
+		if (mappingHandle) {
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle) {
+			CloseHandle(fileHandle);
+		}
+		data_ = nullptr;
+		size_ = 0;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+	}
+#else
+	OvrMappedFile::OvrMappedFile(const std::string& filepath) {
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		struct stat fileStat {};
+		if (fstat(fd, &fileStat) != 0) {
+			close(fd);
+			throw std::runtime_error("failed to stat file: " + filepath);
+		}
+		size_ = static_cast<size_t>(fileStat.st_size);
+		if (size_ == 0) {
+			close(fd);
+			return; // empty files can't be mapped
+		}
+
+		void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file alive
+		if (mapped == MAP_FAILED) {
+			size_ = 0;
+			throw std::runtime_error("failed to map file: " + filepath);
+		}
+		data_ = static_cast<const char*>(mapped);
+	}
+
+	void OvrMappedFile::unmap() {
+		if (data_) {
+			munmap(const_cast<char*>(data_), size_);
+		}
+		data_ = nullptr;
+		size_ = 0;
+	}
+#endif
+
+	OvrMappedFile::~OvrMappedFile() {
+		unmap();
+	}
+
+	OvrMappedFile::OvrMappedFile(OvrMappedFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	OvrMappedFile& OvrMappedFile::operator=(OvrMappedFile&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+#ifdef _WIN32
+			std::swap(fileHandle, other.fileHandle);
+			std::swap(mappingHandle, other.mappingHandle);
+#endif
+		}
+		return *this;
+	}
+}
@@ -0,0 +1,41 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ovr {
+
+	// Read-only memory mapping of a whole file, the bytes are paged in on first access
+	// instead of being copied into a buffer. The mapping starts page aligned.
+	class OvrMappedFile {
+	public:
+		OvrMappedFile() = default;
+		explicit OvrMappedFile(const std::string& filepath); // throws if the file can't be opened
+		~OvrMappedFile();
+
+		OvrMappedFile(const OvrMappedFile&) = delete;
+		OvrMappedFile& operator=(const OvrMappedFile&) = delete;
+		OvrMappedFile(OvrMappedFile&& other) noexcept;
+		OvrMappedFile& operator=(OvrMappedFile&& other) noexcept;
+
+		const char* data() const { return data_; }
+		size_t size() const { return size_; }
+		bool empty() const { return size_ == 0; }
+
+	private:
+		void unmap();
+
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#endif
+	};
+}
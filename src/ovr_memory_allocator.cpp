@@ -0,0 +1,270 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_memory_allocator.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace ovr {
+
+struct OvrMemoryBlock {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+  bool dedicated = false;  // holds exactly one oversized allocation
+
+  std::map<VkDeviceSize, VkDeviceSize> freeRanges;  // free-list: offset -> size
+  VkDeviceSize head = 0;                             // linear: next free offset
+
+  uint32_t liveAllocations = 0;
+  VkDeviceSize usedBytes = 0;   // sizes requested by live allocations
+  VkDeviceSize rangeBytes = 0;  // same, plus their alignment padding
+};
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+OvrMemoryAllocator::OvrMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice)
+    : device{device} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+  for (uint32_t i = 0; i < pools.size(); i++) {
+    pools[i].memoryTypeIndex = i / 4;
+    pools[i].strategy = (i & 1) ? OvrAllocationStrategy::Linear : OvrAllocationStrategy::FreeList;
+  }
+}
+
+OvrMemoryAllocator::~OvrMemoryAllocator() {
+  if (stats.allocationCount > 0) {
+    std::cerr << "memory allocator: " << stats.allocationCount
+              << " allocations still alive at shutdown" << std::endl;
+  }
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      vkFreeMemory(device, block->memory, nullptr);  // implicitly unmaps
+    }
+    pool.blocks.clear();
+  }
+}
+
+uint32_t OvrMemoryAllocator::poolIndex(
+    uint32_t memoryTypeIndex, bool isImage, OvrAllocationStrategy strategy) {
+  return memoryTypeIndex * 4 + (isImage ? 2 : 0) +
+         (strategy == OvrAllocationStrategy::Linear ? 1 : 0);
+}
+
+OvrMemoryBlock *OvrMemoryAllocator::createBlock(Pool &pool, VkDeviceSize size, bool dedicated) {
+  if (stats.blockCount >= maxAllocationCount) {
+    throw std::runtime_error("exceeded maxMemoryAllocationCount!");
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+  auto block = std::make_unique<OvrMemoryBlock>();
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory block!");
+  }
+  block->size = size;
+  block->dedicated = dedicated;
+  block->freeRanges[0] = size;
+
+  // host visible blocks stay mapped for their whole lifetime
+  if (memoryProperties.memoryTypes[pool.memoryTypeIndex].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+      throw std::runtime_error("failed to map device memory block!");
+    }
+  }
+
+  stats.blockCount++;
+  stats.blockBytes += size;
+  pool.blocks.push_back(std::move(block));
+  return pool.blocks.back().get();
+}
+
+void OvrMemoryAllocator::destroyBlock(Pool &pool, OvrMemoryBlock *block) {
+  auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const auto &b) {
+    return b.get() == block;
+  });
+  assert(it != pool.blocks.end() && "block does not belong to this pool");
+
+  vkFreeMemory(device, block->memory, nullptr);
+  stats.blockCount--;
+  stats.blockBytes -= block->size;
+  pool.blocks.erase(it);
+}
+
+bool OvrMemoryAllocator::allocateFromBlock(
+    OvrMemoryBlock &block,
+    OvrAllocationStrategy strategy,
+    const VkMemoryRequirements &requirements,
+    OvrAllocation &allocation) {
+  VkDeviceSize rangeOffset = 0;
+  VkDeviceSize offset = 0;
+
+  if (strategy == OvrAllocationStrategy::Linear) {
+    rangeOffset = block.head;
+    offset = alignUp(block.head, requirements.alignment);
+    if (offset + requirements.size > block.size) {
+      return false;
+    }
+    block.head = offset + requirements.size;
+  } else {
+    // first fit, the alignment padding in front stays attached to the allocation
+    auto it = block.freeRanges.begin();
+    for (; it != block.freeRanges.end(); ++it) {
+      offset = alignUp(it->first, requirements.alignment);
+      if (offset + requirements.size <= it->first + it->second) {
+        break;
+      }
+    }
+    if (it == block.freeRanges.end()) {
+      return false;
+    }
+
+    rangeOffset = it->first;
+    VkDeviceSize rangeEnd = it->first + it->second;
+    block.freeRanges.erase(it);
+    if (offset + requirements.size < rangeEnd) {
+      block.freeRanges[offset + requirements.size] = rangeEnd - (offset + requirements.size);
+    }
+  }
+
+  allocation.memory = block.memory;
+  allocation.offset = offset;
+  allocation.size = requirements.size;
+  allocation.mapped = block.mapped ? static_cast<char *>(block.mapped) + offset : nullptr;
+  allocation.block = &block;
+  allocation.rangeOffset = rangeOffset;
+  allocation.rangeSize = offset + requirements.size - rangeOffset;
+
+  block.liveAllocations++;
+  block.usedBytes += allocation.size;
+  block.rangeBytes += allocation.rangeSize;
+  return true;
+}
+
+OvrAllocation OvrMemoryAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    uint32_t memoryTypeIndex,
+    bool isImage,
+    OvrAllocationStrategy strategy) {
+  std::lock_guard<std::mutex> lock{mutex};
+
+  OvrAllocation allocation{};
+  allocation.poolIndex = poolIndex(memoryTypeIndex, isImage, strategy);
+  Pool &pool = pools[allocation.poolIndex];
+
+  // oversized requests get a block of their own instead of fragmenting the shared ones
+  if (requirements.size > DEFAULT_BLOCK_SIZE / 2) {
+    OvrMemoryBlock *block = createBlock(pool, requirements.size, true);
+    allocateFromBlock(*block, strategy, requirements, allocation);
+    stats.allocationCount++;
+    return allocation;
+  }
+
+  for (auto &block : pool.blocks) {
+    if (!block->dedicated && allocateFromBlock(*block, strategy, requirements, allocation)) {
+      stats.allocationCount++;
+      return allocation;
+    }
+  }
+
+  OvrMemoryBlock *block = createBlock(pool, DEFAULT_BLOCK_SIZE, false);
+  if (!allocateFromBlock(*block, strategy, requirements, allocation)) {
+    throw std::runtime_error("failed to sub-allocate device memory!");
+  }
+  stats.allocationCount++;
+  return allocation;
+}
+
+void OvrMemoryAllocator::free(OvrAllocation &allocation) {
+  if (allocation.block == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock{mutex};
+
+  Pool &pool = pools[allocation.poolIndex];
+  OvrMemoryBlock &block = *allocation.block;
+
+  block.liveAllocations--;
+  block.usedBytes -= allocation.size;
+  block.rangeBytes -= allocation.rangeSize;
+  stats.allocationCount--;
+
+  if (pool.strategy == OvrAllocationStrategy::FreeList) {
+    // insert the range back and merge it with its neighbours
+    VkDeviceSize offset = allocation.rangeOffset;
+    VkDeviceSize size = allocation.rangeSize;
+    auto next = block.freeRanges.lower_bound(offset);
+    if (next != block.freeRanges.end() && offset + size == next->first) {
+      size += next->second;
+      next = block.freeRanges.erase(next);
+    }
+    if (next != block.freeRanges.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        offset = prev->first;
+        size += prev->second;
+        block.freeRanges.erase(prev);
+      }
+    }
+    block.freeRanges[offset] = size;
+  } else if (block.liveAllocations == 0) {
+    block.head = 0;  // linear blocks are recycled as a whole
+  }
+
+  // keep one empty shared block per pool around so alloc/free cycles don't hit the driver,
+  // any further block that empties out goes back
+  if (block.liveAllocations == 0) {
+    bool spareExists = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&block](const auto &b) {
+      return b.get() != &block && !b->dedicated && b->liveAllocations == 0;
+    });
+    if (block.dedicated || spareExists) {
+      destroyBlock(pool, &block);
+    }
+  }
+
+  allocation = OvrAllocation{};
+}
+
+OvrMemoryStats OvrMemoryAllocator::getStats() {
+  std::lock_guard<std::mutex> lock{mutex};
+
+  OvrMemoryStats result = stats;
+  result.usedBytes = 0;
+  result.wastedBytes = 0;
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      result.usedBytes += block->usedBytes;
+      result.wastedBytes += pool.strategy == OvrAllocationStrategy::Linear
+                                ? block->head - block->usedBytes
+                                : block->rangeBytes - block->usedBytes;
+    }
+  }
+  return result;
+}
+
+void OvrMemoryAllocator::printStats() {
+  OvrMemoryStats s = getStats();
+  std::cout << "device memory: " << s.blockCount << " blocks (" << s.blockBytes / 1024
+            << " KiB), " << s.allocationCount << " allocations, used " << s.usedBytes / 1024
+            << " KiB, wasted " << s.wastedBytes / 1024 << " KiB" << std::endl;
+}
+
+}  // namespace ovr
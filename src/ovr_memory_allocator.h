@@ -0,0 +1,98 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ovr {
+
+enum class OvrAllocationStrategy {
+  FreeList,  // general purpose, freed ranges are coalesced and reused
+  Linear     // bump allocation, a block is only recycled once all its allocations are freed
+};
+
+struct OvrMemoryBlock;
+
+// Sub-range of a larger VkDeviceMemory block handed out by OvrMemoryAllocator
+struct OvrAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;  // aligned offset to bind the resource at
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;  // persistently mapped pointer, only for host visible memory
+
+ private:
+  friend class OvrMemoryAllocator;
+  OvrMemoryBlock *block = nullptr;
+  uint32_t poolIndex = 0;
+  VkDeviceSize rangeOffset = 0;  // start of the range including alignment padding
+  VkDeviceSize rangeSize = 0;
+};
+
+struct OvrMemoryStats {
+  uint32_t blockCount = 0;       // vkAllocateMemory calls currently alive
+  uint32_t allocationCount = 0;  // sub-allocations currently alive
+  VkDeviceSize blockBytes = 0;   // total size of all blocks
+  VkDeviceSize usedBytes = 0;    // bytes requested by live sub-allocations
+  VkDeviceSize wastedBytes = 0;  // alignment padding + linear space not reclaimed yet
+};
+
+class OvrMemoryAllocator {
+ public:
+  static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  OvrMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+  ~OvrMemoryAllocator();
+
+  OvrMemoryAllocator(const OvrMemoryAllocator &) = delete;
+  OvrMemoryAllocator &operator=(const OvrMemoryAllocator &) = delete;
+
+  // isImage keeps optimal tiling images and buffers in separate pools, so
+  // bufferImageGranularity never has to be honoured inside a block
+  OvrAllocation allocate(
+      const VkMemoryRequirements &requirements,
+      uint32_t memoryTypeIndex,
+      bool isImage,
+      OvrAllocationStrategy strategy = OvrAllocationStrategy::FreeList);
+  void free(OvrAllocation &allocation);
+
+  OvrMemoryStats getStats();
+  void printStats();
+
+ private:
+  struct Pool {
+    uint32_t memoryTypeIndex = 0;
+    OvrAllocationStrategy strategy = OvrAllocationStrategy::FreeList;
+    std::vector<std::unique_ptr<OvrMemoryBlock>> blocks;
+  };
+
+  static uint32_t poolIndex(uint32_t memoryTypeIndex, bool isImage, OvrAllocationStrategy strategy);
+  OvrMemoryBlock *createBlock(Pool &pool, VkDeviceSize size, bool dedicated);
+  void destroyBlock(Pool &pool, OvrMemoryBlock *block);
+  bool allocateFromBlock(
+      OvrMemoryBlock &block,
+      OvrAllocationStrategy strategy,
+      const VkMemoryRequirements &requirements,
+      OvrAllocation &allocation);
+
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t maxAllocationCount;
+
+  std::array<Pool, VK_MAX_MEMORY_TYPES * 4> pools;
+  OvrMemoryStats stats;
+  std::mutex mutex;
+};
+
+}  // namespace ovr
@@ -0,0 +1,290 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_mesh_cache.h"
+#include "ovr_mesh_optimizer.h"
+#include "ovr_mesh_simplifier.h"
+#include "ovr_meshlet_builder.h"
+#include "ovr_utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace ovr {
+	// little endian, the vertex, index, meshlet and lod arrays start at 16 byte aligned offsets
+	struct OvrMeshFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t vertexStride;       // sizeof(OvrModel::Vertex) of the writer
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;  // std::filesystem::file_time_type ticks
+		uint64_t sourceHash;         // hashLargeBytes of the whole source
+		uint64_t flags;              // MESH_FLAG_*
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t vertexOffset;       // from the start of the file
+		uint64_t indexOffset;
+		uint64_t meshletCount;
+		uint64_t meshletOffset;
+		uint64_t lodCount;
+		uint64_t lodOffset;
+		float boundsMin[3];
+		float boundsMax[3];
+		float boundsSphere[4];
+	};
+	static_assert(std::is_trivially_copyable<OvrMeshFileHeader>::value, "header is written as raw bytes");
+	static_assert(std::is_trivially_copyable<OvrModel::Vertex>::value, "vertices are written as raw bytes");
+	static_assert(std::is_trivially_copyable<OvrModel::Meshlet>::value, "meshlets are written as raw bytes");
+	static_assert(std::is_trivially_copyable<OvrModel::Lod>::value, "lods are written as raw bytes");
+
+	static constexpr char MESH_FILE_MAGIC[8] = { 'O', 'V', 'R', 'M', 'E', 'S', 'H', '\0' };
+	static constexpr uint64_t MESH_FILE_ALIGNMENT = 16;
+	static constexpr uint64_t MESH_FLAG_OPTIMIZED = 1; // went through OvrMeshOptimizer::optimize
+
+	struct OvrSourceStamp {
+		uint64_t size = 0;
+		int64_t modifiedTime = 0;
+	};
+
+	static bool readSourceStamp(const std::string& sourcePath, OvrSourceStamp& stamp) {
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error) {
+			return false;
+		}
+		stamp.size = static_cast<uint64_t>(std::filesystem::file_size(sourcePath, error));
+		stamp.modifiedTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		return !error;
+	}
+
+	static uint64_t alignOffset(uint64_t offset) {
+		return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+	}
+
+	// everything the header says is inside the file and readable through aligned pointers
+	static bool readHeader(const OvrMappedFile& file, OvrMeshFileHeader& header) {
+		if (file.size() < sizeof(OvrMeshFileHeader)) {
+			return false;
+		}
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0 ||
+			header.version != OvrMeshCache::VERSION ||
+			header.vertexStride != sizeof(OvrModel::Vertex)) {
+			return false;
+		}
+		const uint64_t fileSize = file.size();
+		auto fits = [fileSize](uint64_t offset, uint64_t count, uint64_t elementSize) {
+			return offset % MESH_FILE_ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+		};
+		const uint64_t maxCount = std::numeric_limits<uint32_t>::max(); // OvrModel counts are 32 bit
+		return header.vertexCount <= maxCount && header.indexCount <= maxCount && header.meshletCount <= maxCount &&
+			header.lodCount <= maxCount &&
+			fits(header.vertexOffset, header.vertexCount, sizeof(OvrModel::Vertex)) &&
+			fits(header.indexOffset, header.indexCount, sizeof(uint32_t)) &&
+			fits(header.meshletOffset, header.meshletCount, sizeof(OvrModel::Meshlet)) &&
+			fits(header.lodOffset, header.lodCount, sizeof(OvrModel::Lod));
+	}
+
+	static bool hashSource(const std::string& sourcePath, uint64_t& hash) {
+		try {
+			OvrMappedFile source{ sourcePath };
+			hash = hashLargeBytes(source.data(), source.size());
+			return true;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	std::string OvrMeshCache::getCachePath(const std::string& sourcePath) {
+		return std::filesystem::path{ sourcePath }.replace_extension(".ovrmesh").string();
+	}
+
+	OvrMappedFile OvrMeshCache::open(const std::string& sourcePath, bool optimized) {
+		OvrSourceStamp stamp{};
+		if (!readSourceStamp(sourcePath, stamp)) {
+			return {};
+		}
+		const std::string cachePath = getCachePath(sourcePath);
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(cachePath, error)) {
+			return {};
+		}
+
+		OvrMappedFile file{};
+		try {
+			file = OvrMappedFile{ cachePath };
+		}
+		catch (const std::exception&) {
+			return {};
+		}
+		OvrMeshFileHeader header{};
+		if (!readHeader(file, header) || header.sourceSize != stamp.size ||
+			((header.flags & MESH_FLAG_OPTIMIZED) != 0) != optimized) {
+			return {};
+		}
+
+		if (header.sourceModifiedTime != stamp.modifiedTime) {
+			// touched by a checkout or copy, still good if the bytes are the same
+			uint64_t sourceHash = 0;
+			if (!hashSource(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+				return {};
+			}
+			// best effort, so the next load can skip the hash. Fails harmlessly where the mapping locks the file
+			std::fstream out{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+			if (out) {
+				out.seekp(offsetof(OvrMeshFileHeader, sourceModifiedTime));
+				out.write(reinterpret_cast<const char*>(&stamp.modifiedTime), sizeof(stamp.modifiedTime));
+			}
+		}
+		return file;
+	}
+
+	OvrModel::MeshData OvrMeshCache::getMeshData(const OvrMappedFile& cacheFile) {
+		OvrMeshFileHeader header{};
+		if (!readHeader(cacheFile, header)) {
+			throw std::runtime_error("invalid mesh cache file!");
+		}
+		OvrModel::MeshData mesh{};
+		// the mapping is page aligned and the offsets 16 byte aligned
+		mesh.vertices = reinterpret_cast<const OvrModel::Vertex*>(cacheFile.data() + header.vertexOffset);
+		mesh.vertexCount = static_cast<size_t>(header.vertexCount);
+		mesh.indices = reinterpret_cast<const uint32_t*>(cacheFile.data() + header.indexOffset);
+		mesh.indexCount = static_cast<size_t>(header.indexCount);
+		mesh.meshlets = reinterpret_cast<const OvrModel::Meshlet*>(cacheFile.data() + header.meshletOffset);
+		mesh.meshletCount = static_cast<size_t>(header.meshletCount);
+		mesh.lods = reinterpret_cast<const OvrModel::Lod*>(cacheFile.data() + header.lodOffset);
+		mesh.lodCount = static_cast<size_t>(header.lodCount);
+		mesh.bounds.min = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+		mesh.bounds.max = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+		mesh.bounds.sphere = { header.boundsSphere[0], header.boundsSphere[1], header.boundsSphere[2], header.boundsSphere[3] };
+		return mesh;
+	}
+
+	bool OvrMeshCache::write(const std::string& sourcePath, const OvrModel::MeshData& mesh, bool optimized) {
+		OvrMeshFileHeader header{};
+		std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+		header.version = VERSION;
+		header.vertexStride = sizeof(OvrModel::Vertex);
+		header.flags = optimized ? MESH_FLAG_OPTIMIZED : 0;
+
+		OvrSourceStamp stamp{};
+		if (!readSourceStamp(sourcePath, stamp) || !hashSource(sourcePath, header.sourceHash)) {
+			return false;
+		}
+		header.sourceSize = stamp.size;
+		header.sourceModifiedTime = stamp.modifiedTime;
+
+		OvrModel::Bounds bounds = mesh.bounds.isValid() ? mesh.bounds : OvrModel::Bounds::fromVertices(mesh.vertices, mesh.vertexCount);
+		for (int axis = 0; axis < 3; axis++) {
+			header.boundsMin[axis] = bounds.min[axis];
+			header.boundsMax[axis] = bounds.max[axis];
+		}
+		for (int component = 0; component < 4; component++) {
+			header.boundsSphere[component] = bounds.sphere[component];
+		}
+
+		const uint64_t vertexBytes = mesh.vertexCount * sizeof(OvrModel::Vertex);
+		const uint64_t indexBytes = mesh.indexCount * sizeof(uint32_t);
+		const uint64_t meshletBytes = mesh.meshletCount * sizeof(OvrModel::Meshlet);
+		const uint64_t lodBytes = mesh.lodCount * sizeof(OvrModel::Lod);
+		header.vertexCount = mesh.vertexCount;
+		header.indexCount = mesh.indexCount;
+		header.meshletCount = mesh.meshletCount;
+		header.lodCount = mesh.lodCount;
+		header.vertexOffset = alignOffset(sizeof(OvrMeshFileHeader));
+		header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+		header.meshletOffset = alignOffset(header.indexOffset + indexBytes);
+		header.lodOffset = alignOffset(header.meshletOffset + meshletBytes);
+
+		// per thread name, two loads of the same file must not write into each other's temporary
+		const std::string cachePath = getCachePath(sourcePath);
+		const std::string tempPath = cachePath + ".tmp" +
+			std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		{
+			std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!out) {
+				return false;
+			}
+			const char padding[MESH_FILE_ALIGNMENT] = {};
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+			out.write(reinterpret_cast<const char*>(mesh.vertices), static_cast<std::streamsize>(vertexBytes));
+			out.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - vertexBytes));
+			out.write(reinterpret_cast<const char*>(mesh.indices), static_cast<std::streamsize>(indexBytes));
+			out.write(padding, static_cast<std::streamsize>(header.meshletOffset - header.indexOffset - indexBytes));
+			out.write(reinterpret_cast<const char*>(mesh.meshlets), static_cast<std::streamsize>(meshletBytes));
+			out.write(padding, static_cast<std::streamsize>(header.lodOffset - header.meshletOffset - meshletBytes));
+			out.write(reinterpret_cast<const char*>(mesh.lods), static_cast<std::streamsize>(lodBytes));
+			if (!out) {
+				out.close();
+				std::error_code error;
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	OvrMeshAsset OvrMeshAsset::load(const std::string& filepath, OvrJobSystem* jobSystem, bool optimize) {
+		OvrMeshAsset asset{};
+		asset.cacheFile = OvrMeshCache::open(filepath, optimize);
+		if (!asset.cacheFile.empty()) {
+			return asset;
+		}
+
+		asset.builder.loadModel(filepath, jobSystem);
+		if (optimize) {
+			OvrVertexCacheStats before{}, after{};
+			OvrMeshOptimizer::optimize(asset.builder.vertices, asset.builder.indices, &before, &after);
+			std::cout << "Optimized " << filepath << ": ACMR " << before.acmr << " -> " << after.acmr
+				<< ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+		}
+		// after the optimizer, which would undo the clustering
+		asset.builder.meshlets = OvrMeshletBuilder::build(
+			asset.builder.vertices.data(), asset.builder.vertices.size(), asset.builder.indices);
+		// the coarser levels go after the clustered full one, each ordered for the vertex cache on its own
+		auto& indices = asset.builder.indices;
+		asset.builder.lods = OvrMeshSimplifier::buildLods(
+			asset.builder.vertices.data(), asset.builder.vertices.size(), indices);
+		for (size_t i = 1; optimize && i < asset.builder.lods.size(); i++) {
+			const OvrModel::Lod& lod = asset.builder.lods[i];
+			std::vector<uint32_t> levelIndices(indices.begin() + lod.firstIndex,
+				indices.begin() + lod.firstIndex + lod.indexCount);
+			OvrMeshOptimizer::optimizeVertexCache(levelIndices, asset.builder.vertices.size());
+			std::copy(levelIndices.begin(), levelIndices.end(), indices.begin() + lod.firstIndex);
+		}
+		std::cout << "Simplified " << filepath << ": " << asset.builder.lods.size() << " LODs, triangles";
+		for (const OvrModel::Lod& lod : asset.builder.lods) {
+			std::cout << " " << lod.indexCount / 3;
+		}
+		std::cout << "\n";
+		if (!OvrMeshCache::write(filepath, asset.builder.getMeshData(), optimize)) {
+			std::cerr << "failed to write mesh cache: " << OvrMeshCache::getCachePath(filepath) << "\n";
+		}
+		return asset;
+	}
+
+	OvrModel::MeshData OvrMeshAsset::getMeshData() const {
+		return isFromCache() ? OvrMeshCache::getMeshData(cacheFile) : builder.getMeshData();
+	}
+}
@@ -0,0 +1,56 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_mapped_file.h"
+#include "ovr_model.h"
+
+#include <cstdint>
+#include <string>
+
+namespace ovr {
+
+	// Binary .ovrmesh cache next to a model file: the deduplicated vertices, the indices and the bounds
+	// Builder::loadModel produced, the meshlets of OvrMeshletBuilder and the OvrMeshSimplifier levels of
+	// detail, laid out so a mapping of the file can be uploaded without parsing.
+	// The header records the source's size, modification time and content hash. A cache is used when the
+	// size matches and either the time matches or, when the source was only touched, the hash does.
+	class OvrMeshCache {
+	public:
+		static constexpr uint32_t VERSION = 4; // bump whenever the layout or OvrModel::Vertex changes
+
+		// "models/car.obj" -> "models/car.ovrmesh"
+		static std::string getCachePath(const std::string& sourcePath);
+
+		// maps the cache of sourcePath, an empty file when it is missing, from another version, stale
+		// or not (or the other way round) run through OvrMeshOptimizer as optimized asks
+		static OvrMappedFile open(const std::string& sourcePath, bool optimized);
+		// the mesh in a file returned by open, pointing into its mapping
+		static OvrModel::MeshData getMeshData(const OvrMappedFile& cacheFile);
+		// writes the cache of sourcePath through a temporary file, so a crash never leaves a torn one behind.
+		// false when it could not be written (read-only directory...), loading works without it
+		static bool write(const std::string& sourcePath, const OvrModel::MeshData& mesh, bool optimized);
+	};
+
+	// Mesh of a model file ready for upload: mapped from its cache, or parsed (and optimized, see
+	// OvrMeshOptimizer), clustered into meshlets and simplified into levels of detail when there was no valid
+	// cache, which writes one.
+	// Different files can be loaded on different threads.
+	class OvrMeshAsset {
+	public:
+		// throws if the source can't be parsed, which happens on jobSystem when given
+		static OvrMeshAsset load(const std::string& filepath, OvrJobSystem* jobSystem = nullptr, bool optimize = true);
+
+		bool isFromCache() const { return !cacheFile.empty(); }
+		// valid as long as the asset is
+		OvrModel::MeshData getMeshData() const;
+
+	private:
+		OvrMappedFile cacheFile;
+		OvrModel::Builder builder; // only filled when parsed
+	};
+}
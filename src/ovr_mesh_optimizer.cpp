@@ -0,0 +1,285 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_mesh_optimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace ovr {
+	static constexpr uint32_t NO_VERTEX = 0xFFFFFFFFu;
+
+	// FIFO cache by timestamps: a vertex is cached while fewer than cacheSize misses happened since its own
+	struct OvrCacheSimulation {
+		std::vector<uint32_t> cacheTimes;
+		uint32_t time;
+		uint32_t cacheSize;
+
+		OvrCacheSimulation(size_t vertexCount, uint32_t cacheSize)
+			: cacheTimes(vertexCount, 0), time{ cacheSize + 1 }, cacheSize{ cacheSize } {}
+
+		bool access(uint32_t vertex) { // true on a miss
+			if (time - cacheTimes[vertex] > cacheSize) {
+				cacheTimes[vertex] = time++;
+				return true;
+			}
+			return false;
+		}
+
+		void reset() {
+			time += cacheSize + 1; // every vertex is out
+		}
+	};
+
+	OvrVertexCacheStats OvrMeshOptimizer::analyzeVertexCache(
+		const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+		OvrVertexCacheStats stats{};
+		if (indices.empty() || vertexCount == 0) {
+			return stats;
+		}
+		OvrCacheSimulation cache{ vertexCount, cacheSize };
+		size_t misses = 0;
+		for (uint32_t index : indices) {
+			misses += cache.access(index);
+		}
+
+		std::vector<bool> used(vertexCount, false);
+		size_t usedCount = 0;
+		for (uint32_t index : indices) {
+			usedCount += !used[index];
+			used[index] = true;
+		}
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+		return stats;
+	}
+
+	std::vector<uint32_t> OvrMeshOptimizer::optimizeVertexCache(
+		std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<uint32_t> clusters;
+		if (triangleCount == 0) {
+			return clusters;
+		}
+
+		// vertex -> triangles adjacency, offsets then one flat array
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices) {
+			liveTriangles[index]++;
+		}
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<uint32_t> cacheTimes(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds;   // recently used vertices to fall back on, most recent last
+		std::vector<uint32_t> candidates; // vertices of the triangles just emitted
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0; // vertices below it have no live triangles left
+
+		uint32_t fanVertex = 0;
+		while (fanVertex < vertexCount && liveTriangles[fanVertex] == 0) {
+			fanVertex++;
+		}
+		clusters.push_back(0);
+		while (fanVertex < vertexCount) {
+			candidates.clear();
+			for (uint32_t a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; a++) {
+				const uint32_t triangle = adjacency[a];
+				if (emitted[triangle]) {
+					continue;
+				}
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					const uint32_t vertex = indices[triangle * 3 + corner];
+					result.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cacheTimes[vertex] > cacheSize) {
+						cacheTimes[vertex] = time++;
+					}
+				}
+				emitted[triangle] = true;
+			}
+
+			// next fan: the candidate still in cache after its remaining triangles are emitted, the oldest such
+			uint32_t next = NO_VERTEX;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (liveTriangles[vertex] == 0) {
+					continue;
+				}
+				int64_t priority = 0;
+				if (static_cast<int64_t>(time - cacheTimes[vertex]) + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= cacheSize) {
+					priority = time - cacheTimes[vertex];
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+
+			if (next == NO_VERTEX) {
+				// dead end: a recent vertex with triangles left, or else the next one in input order
+				while (!deadEnds.empty() && next == NO_VERTEX) {
+					const uint32_t vertex = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[vertex] > 0) {
+						next = vertex;
+					}
+				}
+				if (next == NO_VERTEX) {
+					while (cursor < vertexCount && liveTriangles[cursor] == 0) {
+						cursor++;
+					}
+					if (cursor < vertexCount) {
+						next = cursor;
+						// unrelated to what was drawn so far, a hard cluster boundary
+						clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+					}
+				}
+			}
+			fanVertex = next == NO_VERTEX ? static_cast<uint32_t>(vertexCount) : next;
+		}
+
+		indices.swap(result);
+		return clusters;
+	}
+
+	void OvrMeshOptimizer::optimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& clusters,
+		float threshold,
+		uint32_t cacheSize) {
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// soft boundaries inside the hard clusters, wherever the cluster so far is within threshold of
+		// the whole mesh's ACMR (starting a cluster with an empty cache is what costs)
+		const float maxAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr * threshold;
+		std::vector<uint32_t> starts;
+		OvrCacheSimulation cache{ vertices.size(), cacheSize };
+		for (size_t c = 0; c < clusters.size(); c++) {
+			const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+			uint32_t start = clusters[c];
+			uint32_t misses = 0;
+			cache.reset();
+			starts.push_back(start);
+			for (uint32_t triangle = start; triangle < end; triangle++) {
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					misses += cache.access(indices[triangle * 3 + corner]);
+				}
+				const uint32_t clusterTriangles = triangle + 1 - start;
+				if (triangle + 1 < end && static_cast<float>(misses) <= maxAcmr * clusterTriangles) {
+					start = triangle + 1;
+					misses = 0;
+					cache.reset();
+					starts.push_back(start);
+				}
+			}
+		}
+
+		// outward facing clusters first: the offset of the cluster's centroid from the mesh's along its
+		// average normal, both area weighted
+		glm::vec3 meshCenter{ 0.f };
+		float meshArea = 0.f;
+		std::vector<float> sortKeys(starts.size());
+		std::vector<glm::vec3> centroids(starts.size());
+		std::vector<glm::vec3> normals(starts.size());
+		for (size_t c = 0; c < starts.size(); c++) {
+			const uint32_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area = 0.f;
+			for (uint32_t triangle = starts[c]; triangle < end; triangle++) {
+				const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].position;
+				const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+				const float triangleArea = glm::length(cross);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += cross;
+				area += triangleArea;
+			}
+			meshCenter += centroid;
+			meshArea += area;
+			centroids[c] = area > 0.f ? centroid / area : vertices[indices[starts[c] * 3]].position;
+			normals[c] = normal;
+		}
+		if (meshArea > 0.f) {
+			meshCenter /= meshArea;
+		}
+		for (size_t c = 0; c < starts.size(); c++) {
+			const float normalLength = glm::length(normals[c]);
+			sortKeys[c] = normalLength > 0.f ? glm::dot(centroids[c] - meshCenter, normals[c] / normalLength) : 0.f;
+		}
+
+		std::vector<uint32_t> order(starts.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t c : order) {
+			const uint32_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+			result.insert(result.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+		}
+		indices.swap(result);
+	}
+
+	void OvrMeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+		std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+		std::vector<Vertex> result;
+		result.reserve(vertices.size());
+		for (uint32_t& index : indices) {
+			if (remap[index] == NO_VERTEX) {
+				remap[index] = static_cast<uint32_t>(result.size());
+				result.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		// unreferenced vertices stay, at the end
+		for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+			if (remap[vertex] == NO_VERTEX) {
+				result.push_back(vertices[vertex]);
+			}
+		}
+		vertices.swap(result);
+	}
+
+	void OvrMeshOptimizer::optimize(
+		std::vector<Vertex>& vertices,
+		std::vector<uint32_t>& indices,
+		OvrVertexCacheStats* before,
+		OvrVertexCacheStats* after) {
+		if (indices.size() % 3 != 0) {
+			return; // not a triangle list, leave it alone
+		}
+		if (before != nullptr) {
+			*before = analyzeVertexCache(indices, vertices.size());
+		}
+		std::vector<uint32_t> clusters = optimizeVertexCache(indices, vertices.size());
+		optimizeOverdraw(indices, vertices, clusters);
+		optimizeVertexFetch(vertices, indices);
+		if (after != nullptr) {
+			*after = analyzeVertexCache(indices, vertices.size());
+		}
+	}
+}
@@ -0,0 +1,57 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	// post-transform cache efficiency of an index buffer, lower is better
+	struct OvrVertexCacheStats {
+		float acmr = 0.f; // average cache miss ratio, vertex shader runs per triangle (0.5 at best, 3 at worst)
+		float atvr = 0.f; // average transformed vertex ratio, vertex shader runs per vertex (1 at best)
+	};
+
+	// Reorders a mesh for the GPU after loading, the triangles themselves stay the same:
+	// optimizeVertexCache orders triangles for the post-transform cache (Tipsify, Sander et al. 2007),
+	// optimizeOverdraw then sorts clusters of them so outward facing ones draw first and win early-z,
+	// optimizeVertexFetch renumbers the vertices in first use order so fetches walk memory forward.
+	class OvrMeshOptimizer {
+	public:
+		using Vertex = OvrModel::Vertex;
+
+		static constexpr uint32_t CACHE_SIZE = 16;       // FIFO entries assumed for the GPU
+		static constexpr float OVERDRAW_THRESHOLD = 1.05f; // ACMR a cluster split may cost, relative to the whole mesh
+
+		// simulates a FIFO cache of cacheSize vertices
+		static OvrVertexCacheStats analyzeVertexCache(
+			const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+		// returns the first triangle of every cluster, where Tipsify had to jump to an unrelated vertex
+		static std::vector<uint32_t> optimizeVertexCache(
+			std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+		// clusters are optimizeVertexCache's, split further where that costs little cache efficiency
+		static void optimizeOverdraw(
+			std::vector<uint32_t>& indices,
+			const std::vector<Vertex>& vertices,
+			const std::vector<uint32_t>& clusters,
+			float threshold = OVERDRAW_THRESHOLD,
+			uint32_t cacheSize = CACHE_SIZE);
+		static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// all three in order, returns the stats before and after
+		static void optimize(
+			std::vector<Vertex>& vertices,
+			std::vector<uint32_t>& indices,
+			OvrVertexCacheStats* before = nullptr,
+			OvrVertexCacheStats* after = nullptr);
+	};
+}
@@ -0,0 +1,329 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ovr {
+	// sum of the squared distances to planes weighted by their triangle's area,
+	// error(p) = pAp + 2bp + c with A symmetric, kept in double as the terms cancel out
+	struct OvrQuadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		// plane dot(normal, p) + d = 0, normal of unit length
+		void addPlane(const glm::dvec3& normal, double d, double planeWeight) {
+			a00 += planeWeight * normal.x * normal.x;
+			a01 += planeWeight * normal.x * normal.y;
+			a02 += planeWeight * normal.x * normal.z;
+			a11 += planeWeight * normal.y * normal.y;
+			a12 += planeWeight * normal.y * normal.z;
+			a22 += planeWeight * normal.z * normal.z;
+			b0 += planeWeight * normal.x * d;
+			b1 += planeWeight * normal.y * d;
+			b2 += planeWeight * normal.z * d;
+			c += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void add(const OvrQuadric& other) {
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// root of the weighted mean squared distance, a distance in model space
+		float error(const glm::vec3& p) const {
+			if (weight <= 0.0) {
+				return 0.f;
+			}
+			const double x = p.x, y = p.y, z = p.z;
+			const double sum = a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return static_cast<float>(std::sqrt(std::max(sum, 0.0) / weight));
+		}
+	};
+
+	// vertex from moves onto vertex to
+	struct OvrCollapse {
+		float error;
+		uint32_t from;
+		uint32_t to;
+	};
+
+	// vertices sharing their position with another (attribute seams) and those on edges that don't have
+	// exactly two triangles (open borders, non-manifold fans). Edges are compared by position so a seam
+	// isn't taken for a border
+	static std::vector<uint8_t> findLockedVertices(
+		const OvrModel::Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+		std::vector<uint32_t> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0u);
+		auto lessPosition = [vertices](uint32_t a, uint32_t b) {
+			const glm::vec3& pa = vertices[a].position;
+			const glm::vec3& pb = vertices[b].position;
+			return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+		};
+		std::sort(order.begin(), order.end(), lessPosition);
+
+		std::vector<uint32_t> positionIds(vertexCount);
+		std::vector<uint8_t> lockedPositions;
+		for (size_t i = 0; i < vertexCount; i++) {
+			const bool sameAsPrevious = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+			if (!sameAsPrevious) {
+				lockedPositions.push_back(0);
+			}
+			else {
+				lockedPositions.back() = 1;
+			}
+			positionIds[order[i]] = static_cast<uint32_t>(lockedPositions.size() - 1);
+		}
+
+		std::vector<uint64_t> edges;
+		edges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				const uint64_t a = positionIds[indices[i + corner]];
+				const uint64_t b = positionIds[indices[i + (corner + 1) % 3]];
+				edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t first = 0; first < edges.size();) {
+			size_t last = first + 1;
+			while (last < edges.size() && edges[last] == edges[first]) {
+				last++;
+			}
+			if (last - first != 2) {
+				lockedPositions[edges[first] >> 32] = 1;
+				lockedPositions[edges[first] & 0xFFFFFFFFu] = 1;
+			}
+			first = last;
+		}
+
+		std::vector<uint8_t> locked(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++) {
+			locked[i] = lockedPositions[positionIds[i]];
+		}
+		return locked;
+	}
+
+	// true when moving from onto to would turn one of from's triangles over, or make it degenerate.
+	// Triangles holding both disappear with the collapse, they aren't tested
+	static bool collapseFlips(
+		const OvrModel::Vertex* vertices,
+		const uint32_t* indices,
+		const uint32_t* triangles,
+		size_t triangleCount,
+		uint32_t from,
+		uint32_t to) {
+		for (size_t i = 0; i < triangleCount; i++) {
+			const uint32_t* triangle = indices + triangles[i] * 3;
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+				continue;
+			}
+			glm::vec3 p[3];
+			for (int corner = 0; corner < 3; corner++) {
+				p[corner] = vertices[triangle[corner]].position;
+			}
+			const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			for (int corner = 0; corner < 3; corner++) {
+				if (triangle[corner] == from) {
+					p[corner] = vertices[to].position;
+				}
+			}
+			const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+			// more than about 75 degrees of turn counts as a flip
+			if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<uint32_t> OvrMeshSimplifier::simplify(
+		const Vertex* vertices,
+		size_t vertexCount,
+		const uint32_t* indices,
+		size_t indexCount,
+		size_t targetIndexCount,
+		float maxError,
+		float* resultError) {
+		std::vector<uint32_t> result(indices, indices + indexCount);
+		if (resultError != nullptr) {
+			*resultError = 0.f;
+		}
+		if (indexCount % 3 != 0 || vertexCount == 0) {
+			return result;
+		}
+
+		const std::vector<uint8_t> locked = findLockedVertices(vertices, vertexCount, indices, indexCount);
+		std::vector<OvrQuadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			const glm::dvec3 p0{ vertices[indices[i + 0]].position };
+			const glm::dvec3 p1{ vertices[indices[i + 1]].position };
+			const glm::dvec3 p2{ vertices[indices[i + 2]].position };
+			glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const double length = glm::length(normal);
+			if (length == 0.0) {
+				continue;
+			}
+			normal /= length;
+			const double d = -glm::dot(normal, p0);
+			for (size_t corner = 0; corner < 3; corner++) {
+				quadrics[indices[i + corner]].addPlane(normal, d, length * 0.5);
+			}
+		}
+
+		// collapses are done in passes. Each takes the cheapest ones that touch no triangle another one
+		// of the pass changed, then the triangles are rewritten and the costs measured again
+		std::vector<OvrCollapse> collapses;
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<uint32_t> adjacencyCursor;
+		float error = 0.f;
+		while (result.size() > targetIndexCount) {
+			const size_t triangleCount = result.size() / 3;
+
+			// each inner edge is seen from both its triangles, it's taken where it runs up in index
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (size_t corner = 0; corner < 3; corner++) {
+					const uint32_t a = result[i + corner];
+					const uint32_t b = result[i + (corner + 1) % 3];
+					if (a > b || (locked[a] && locked[b])) {
+						continue;
+					}
+					const float errorAB = locked[a] ? std::numeric_limits<float>::max() :
+						quadrics[a].error(vertices[b].position);
+					const float errorBA = locked[b] ? std::numeric_limits<float>::max() :
+						quadrics[b].error(vertices[a].position);
+					collapses.push_back(errorAB <= errorBA ? OvrCollapse{ errorAB, a, b } : OvrCollapse{ errorBA, b, a });
+				}
+			}
+			if (collapses.empty()) {
+				break;
+			}
+
+			// a collapse removes two triangles. Ones far costlier than the goal wait for the next pass,
+			// cheaper collapses may have been blocked by this one's. Only those in reach are sorted
+			auto lessError = [](const OvrCollapse& a, const OvrCollapse& b) { return a.error < b.error; };
+			const size_t collapseGoal = (triangleCount - targetIndexCount / 3) / 2 + 1;
+			float errorGoal = std::numeric_limits<float>::max();
+			if (collapseGoal < collapses.size()) {
+				std::nth_element(collapses.begin(), collapses.begin() + collapseGoal, collapses.end(), lessError);
+				errorGoal = collapses[collapseGoal].error * 1.5f;
+				collapses.erase(std::partition(collapses.begin(), collapses.end(),
+					[errorGoal](const OvrCollapse& collapse) { return collapse.error <= errorGoal; }), collapses.end());
+			}
+			std::sort(collapses.begin(), collapses.end(), lessError);
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+			for (uint32_t index : result) {
+				adjacencyOffsets[index + 1]++;
+			}
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+			adjacency.resize(result.size());
+			adjacencyCursor.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				adjacency[adjacencyCursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::iota(remap.begin(), remap.end(), 0u);
+			std::fill(touched.begin(), touched.end(), uint8_t{ 0 });
+			size_t collapseCount = 0;
+			for (const OvrCollapse& collapse : collapses) {
+				if (collapse.error > maxError || collapse.error > errorGoal || collapseCount >= collapseGoal) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+				const uint32_t* triangles = adjacency.data() + adjacencyOffsets[collapse.from];
+				const size_t count = adjacencyOffsets[collapse.from + 1] - adjacencyOffsets[collapse.from];
+				if (collapseFlips(vertices, result.data(), triangles, count, collapse.from, collapse.to)) {
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				// whatever shares a triangle with from sits still for the rest of the pass, so the flip
+				// tests above saw the triangles as they will be
+				for (size_t i = 0; i < count; i++) {
+					for (size_t corner = 0; corner < 3; corner++) {
+						touched[result[triangles[i] * 3 + corner]] = 1;
+					}
+				}
+				error = std::max(error, collapse.error);
+				collapseCount++;
+			}
+			if (collapseCount == 0) {
+				break;
+			}
+
+			size_t written = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				const uint32_t a = remap[result[i + 0]];
+				const uint32_t b = remap[result[i + 1]];
+				const uint32_t c = remap[result[i + 2]];
+				if (a != b && b != c && a != c) {
+					result[written++] = a;
+					result[written++] = b;
+					result[written++] = c;
+				}
+			}
+			result.resize(written);
+		}
+
+		if (resultError != nullptr) {
+			*resultError = error;
+		}
+		return result;
+	}
+
+	std::vector<OvrModel::Lod> OvrMeshSimplifier::buildLods(
+		const Vertex* vertices,
+		size_t vertexCount,
+		std::vector<uint32_t>& indices,
+		uint32_t maxLods) {
+		std::vector<Lod> lods{ Lod{ 0, static_cast<uint32_t>(indices.size()), 0.f } };
+		if (indices.size() % 3 != 0) {
+			return lods;
+		}
+
+		size_t levelBegin = 0;
+		size_t levelCount = indices.size();
+		float error = 0.f;
+		while (lods.size() < maxLods) {
+			const size_t targetTriangles = static_cast<size_t>(levelCount / 3 * LOD_RATIO);
+			if (targetTriangles < MIN_LOD_TRIANGLES) {
+				break;
+			}
+			// from the previous level, quicker than from level 0 and its collapses are kept
+			float levelError = 0.f;
+			std::vector<uint32_t> level = simplify(vertices, vertexCount, indices.data() + levelBegin, levelCount,
+				targetTriangles * 3, std::numeric_limits<float>::max(), &levelError);
+			if (level.size() > levelCount * MIN_LOD_REDUCTION) {
+				break; // held by locked vertices
+			}
+			error += levelError;
+			levelBegin = indices.size();
+			levelCount = level.size();
+			lods.push_back(Lod{ static_cast<uint32_t>(levelBegin), static_cast<uint32_t>(levelCount), error });
+			indices.insert(indices.end(), level.begin(), level.end());
+		}
+		return lods;
+	}
+}
@@ -0,0 +1,54 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ovr {
+
+	// Builds the OvrModel::Lod chain of a mesh after loading. Edge collapses ordered by quadric error
+	// (Garland and Heckbert 1997) remove triangles but keep the vertices, so every level is only new
+	// indices over the same vertex buffer.
+	// A vertex only ever moves onto a neighbour, never to a new position. Vertices on open borders and
+	// attribute seams (one position, several vertices) are locked so the silhouette and the uvs hold.
+	// Collapses that would flip a triangle are skipped.
+	class OvrMeshSimplifier {
+	public:
+		using Vertex = OvrModel::Vertex;
+		using Lod = OvrModel::Lod;
+
+		static constexpr uint32_t MAX_LODS = 5;          // level 0 included
+		static constexpr float LOD_RATIO = 0.5f;         // triangles of a level, relative to the previous
+		static constexpr float MIN_LOD_REDUCTION = 0.8f; // a level keeping more triangles than this isn't worth it
+		static constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+		// the triangles of indices reduced to at most targetIndexCount indices, or as far as collapses below
+		// maxError (model space distance) and the locked vertices allow. resultError gets the largest error
+		// of a collapse taken
+		static std::vector<uint32_t> simplify(
+			const Vertex* vertices,
+			size_t vertexCount,
+			const uint32_t* indices,
+			size_t indexCount,
+			size_t targetIndexCount,
+			float maxError = std::numeric_limits<float>::max(),
+			float* resultError = nullptr);
+
+		// appends the coarser levels to indices, each simplified from the one before to LOD_RATIO of its
+		// triangles. Level 0 is indices as given. Errors add up along the chain, so they only grow
+		static std::vector<Lod> buildLods(
+			const Vertex* vertices,
+			size_t vertexCount,
+			std::vector<uint32_t>& indices,
+			uint32_t maxLods = MAX_LODS);
+	};
+}
@@ -0,0 +1,215 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_meshlet_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ovr {
+	static constexpr uint32_t NO_TRIANGLE = 0xFFFFFFFFu;
+	static constexpr uint32_t NO_MESHLET = 0xFFFFFFFFu;
+
+	// the meshlet being grown, vertexMeshlets marks its vertices so membership is one lookup
+	struct OvrMeshletState {
+		std::vector<uint32_t> vertices;
+		std::vector<uint32_t> triangles;
+		uint32_t id = 0;
+	};
+
+	// sphere around the meshlet's vertices and cone around its triangle normals. Each triangle's normal is
+	// flipped to agree with its own vertex normals, whatever the winding convention of that triangle
+	static void computeBounds(
+		const OvrModel::Vertex* vertices,
+		const uint32_t* indices,
+		const OvrMeshletState& state,
+		OvrModel::Meshlet& meshlet) {
+		glm::vec3 min{ vertices[state.vertices[0]].position };
+		glm::vec3 max{ min };
+		for (uint32_t vertex : state.vertices) {
+			min = glm::min(min, vertices[vertex].position);
+			max = glm::max(max, vertices[vertex].position);
+		}
+		const glm::vec3 center = (min + max) * .5f;
+		float radius = 0.f;
+		for (uint32_t vertex : state.vertices) {
+			radius = std::max(radius, glm::length(vertices[vertex].position - center));
+		}
+		meshlet.boundingSphere = glm::vec4{ center, radius };
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(state.triangles.size());
+		glm::vec3 axis{ 0.f };
+		for (uint32_t triangle : state.triangles) {
+			const OvrModel::Vertex& v0 = vertices[indices[triangle * 3 + 0]];
+			const OvrModel::Vertex& v1 = vertices[indices[triangle * 3 + 1]];
+			const OvrModel::Vertex& v2 = vertices[indices[triangle * 3 + 2]];
+			glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+			if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.f) {
+				normal = -normal;
+			}
+			const float length = glm::length(normal);
+			if (length > 0.f) { // degenerate triangles are never drawn, they don't widen the cone
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+		}
+		meshlet.cone = glm::vec4{ 0.f, 0.f, 0.f, 2.f };
+		const float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength == 0.f) {
+			return;
+		}
+		axis /= axisLength;
+		float minDot = 1.f;
+		for (const glm::vec3& normal : normals) {
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		}
+		minDot -= OvrMeshletBuilder::CONE_MARGIN;
+		if (minDot > OvrMeshletBuilder::MIN_CONE_DOT) {
+			meshlet.cone = glm::vec4{ axis, std::sqrt(1.f - minDot * minDot) };
+		}
+	}
+
+	std::vector<OvrModel::Meshlet> OvrMeshletBuilder::build(
+		const Vertex* vertices,
+		size_t vertexCount,
+		std::vector<uint32_t>& indices,
+		uint32_t maxVertices,
+		uint32_t maxTriangles) {
+		std::vector<Meshlet> meshlets;
+		const size_t triangleCount = indices.size() / 3;
+		if (indices.size() % 3 != 0 || triangleCount == 0) {
+			return meshlets;
+		}
+
+		// vertex -> live triangles adjacency, offsets then one flat array. Emitted triangles are swapped
+		// behind liveCounts so the search never looks at them again
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t index : indices) {
+			adjacencyOffsets[index + 1]++;
+		}
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+		std::vector<uint32_t> liveCounts(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			liveCounts[vertex] = adjacencyOffsets[vertex + 1] - adjacencyOffsets[vertex];
+		}
+
+		std::vector<uint32_t> vertexMeshlets(vertexCount, NO_MESHLET);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		OvrMeshletState state{};
+		size_t cursor = 0; // triangles below it are emitted
+
+		auto newVertices = [&](uint32_t triangle) {
+			uint32_t count = 0;
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				count += vertexMeshlets[indices[triangle * 3 + corner]] != state.id;
+			}
+			return count;
+		};
+		auto flush = [&]() {
+			Meshlet meshlet{};
+			meshlet.firstIndex = static_cast<uint32_t>(result.size());
+			meshlet.triangleCount = static_cast<uint32_t>(state.triangles.size());
+			meshlet.vertexCount = static_cast<uint32_t>(state.vertices.size());
+			computeBounds(vertices, indices.data(), state, meshlet);
+			for (uint32_t triangle : state.triangles) {
+				result.insert(result.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+			}
+			meshlets.push_back(meshlet);
+			state.vertices.clear();
+			state.triangles.clear();
+			state.id++;
+		};
+
+		while (true) {
+			// the live neighbour adding the fewest vertices, any that fits would do but fewer keeps it compact
+			uint32_t best = NO_TRIANGLE;
+			uint32_t bestNew = 3;
+			for (size_t v = 0; v < state.vertices.size() && bestNew > 0; v++) {
+				const uint32_t vertex = state.vertices[v];
+				const uint32_t* live = adjacency.data() + adjacencyOffsets[vertex];
+				for (uint32_t a = 0; a < liveCounts[vertex]; a++) {
+					const uint32_t triangle = live[a];
+					const uint32_t count = newVertices(triangle);
+					if (count < bestNew || best == NO_TRIANGLE) {
+						best = triangle;
+						bestNew = count;
+						if (count == 0) {
+							break;
+						}
+					}
+				}
+			}
+
+			if (best == NO_TRIANGLE) {
+				// nothing connected left, the next triangle in input order starts a new meshlet
+				while (cursor < triangleCount && emitted[cursor]) {
+					cursor++;
+				}
+				if (cursor == triangleCount) {
+					break;
+				}
+				if (!state.triangles.empty()) {
+					flush();
+				}
+				best = static_cast<uint32_t>(cursor);
+				bestNew = newVertices(best);
+			}
+			else if (state.vertices.size() + bestNew > maxVertices) {
+				flush();
+				bestNew = newVertices(best);
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				const uint32_t vertex = indices[best * 3 + corner];
+				if (vertexMeshlets[vertex] != state.id) {
+					vertexMeshlets[vertex] = state.id;
+					state.vertices.push_back(vertex);
+				}
+				uint32_t* live = adjacency.data() + adjacencyOffsets[vertex];
+				uint32_t& liveCount = liveCounts[vertex];
+				for (uint32_t a = 0; a < liveCount; a++) {
+					if (live[a] == best) {
+						std::swap(live[a], live[--liveCount]);
+						break;
+					}
+				}
+			}
+			state.triangles.push_back(best);
+			emitted[best] = true;
+			if (state.triangles.size() == maxTriangles) {
+				flush();
+			}
+		}
+		if (!state.triangles.empty()) {
+			flush();
+		}
+
+		indices.swap(result);
+		return meshlets;
+	}
+
+	bool OvrMeshletBuilder::isBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+		if (meshlet.cone.w > 1.f) {
+			return false;
+		}
+		// every direction from the camera into the sphere is within the cone's complement
+		const glm::vec3 direction = glm::vec3{ meshlet.boundingSphere } - cameraPosition;
+		return glm::dot(direction, glm::vec3{ meshlet.cone }) >=
+			meshlet.cone.w * glm::length(direction) + meshlet.boundingSphere.w;
+	}
+}
@@ -0,0 +1,47 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	// Splits a mesh into OvrModel::Meshlet clusters after loading, for GpuDrivenRenderSystem to cull
+	// each on its own by frustum and optionally normal cone. Plain index ranges, so no mesh shaders are needed.
+	// A meshlet grows greedily over the triangles sharing its vertices, the one adding the fewest new
+	// vertices first, and starts over from the next triangle in input order when none is left, so an
+	// OvrMeshOptimizer order is mostly kept.
+	class OvrMeshletBuilder {
+	public:
+		using Vertex = OvrModel::Vertex;
+		using Meshlet = OvrModel::Meshlet;
+
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+		// no cone when some normal is further than this from the average (dot product), too wide to cull
+		static constexpr float MIN_CONE_DOT = 0.1f;
+		// widens every cone a bit for the rounding of compressed positions
+		static constexpr float CONE_MARGIN = 0.01f;
+
+		// reorders the triangles of indices so every meshlet's are contiguous, triangles and their
+		// winding stay the same. Empty when indices is not a triangle list
+		static std::vector<Meshlet> build(
+			const Vertex* vertices,
+			size_t vertexCount,
+			std::vector<uint32_t>& indices,
+			uint32_t maxVertices = MAX_VERTICES,
+			uint32_t maxTriangles = MAX_TRIANGLES);
+
+		// the test of shaders/gpu_cluster_cull.comp in model space: true when no triangle of the meshlet
+		// can face cameraPosition
+		static bool isBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+	};
+}
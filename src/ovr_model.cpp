@@ -4,242 +4,404 @@
 //------------------------------------------------------------------------
 // Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
 //========================================================================
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
 #include "ovr_model.h"
+#include "ovr_mesh_cache.h"
+#include "ovr_job_system.h"
+#include "ovr_obj_parser.h"
+#include "ovr_vertex_compression.h"
+#include "ovr_vertex_table.h"
 
 #include <iostream>
 
 #include "ovr_utils.h"
 
-#define GLM_ENABLE_EXPERIMENTAL
-
 #include <cassert>
+#include <cstddef>
 #include <cstring>
-#include <glm/gtx/hash.hpp>
-#include <unordered_map>
-
-namespace std {
-	template<> 
-	struct hash<ovr::OvrModel::Vertex> {
-		size_t operator()(ovr::OvrModel::Vertex const& vertex) const {
-			size_t seed = 0;
-			ovr::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
+#include <limits>
 
 namespace ovr {
-	OvrModel::OvrModel(OVRDevice& device, const OvrModel::Builder &builder) : ovrDevice{device}
+	static_assert(offsetof(OvrModel::Vertex, color) == sizeof(glm::vec3) &&
+		sizeof(OvrModel::Vertex) == sizeof(glm::vec3) + sizeof(OvrModel::VertexAttributes),
+		"a Vertex must be its position followed by its VertexAttributes");
+	static_assert(sizeof(OvrModel::Meshlet) == 48, "Meshlet must match the std430 layout of the cluster cull shader");
+	static_assert(sizeof(OvrModel::Lod) == 16, "Lod is written to the mesh cache as raw bytes");
+	static_assert(offsetof(OvrModel::CompressedVertex, normal) == 4 * sizeof(uint16_t) &&
+		sizeof(OvrModel::CompressedVertex) == 4 * sizeof(uint16_t) + sizeof(OvrModel::CompressedAttributes),
+		"a CompressedVertex must be its position followed by its CompressedAttributes");
+
+	OvrModel::OvrModel(OVRDevice& device, const OvrModel::Builder &builder, OvrUploadBatch* uploadBatch,
+		VertexFormat format, bool splitStreams)
+		: OvrModel{ device, builder.getMeshData(), uploadBatch, format, splitStreams } {}
+
+	OvrModel::OvrModel(OVRDevice& device, const MeshData& meshData, OvrUploadBatch* uploadBatch,
+		VertexFormat format, bool splitStreams)
+		: ovrDevice{device}, vertexFormat{format}, splitStreams{splitStreams}
 	{
-		CreateVertexBuffers(builder.vertices);
-		CreateIndexBuffers(builder.indices);
+		bounds = meshData.bounds.isValid() ? meshData.bounds : Bounds::fromVertices(meshData.vertices, meshData.vertexCount);
+		if (vertexFormat == VertexFormat::Compressed &&
+			OvrVertexCompression::hasVertexColors(meshData.vertices, meshData.vertexCount)) {
+			vertexFormat = VertexFormat::CompressedColor;
+		}
+
+		auto createBuffers = [&](OvrUploadBatch& batch) {
+			if (vertexFormat == VertexFormat::Float) {
+				CreateVertexBuffers(meshData.vertices, meshData.vertexCount, splitStreams, batch);
+			}
+			else {
+				CreateCompressedVertexBuffers(meshData.vertices, meshData.vertexCount, splitStreams, batch);
+			}
+			CreateIndexBuffers(meshData.indices, meshData.indexCount, batch);
+		};
+		meshlets.assign(meshData.meshlets, meshData.meshlets + meshData.meshletCount);
+		lods.assign(meshData.lods, meshData.lods + meshData.lodCount);
+		if (lods.empty()) {
+			lods.push_back(Lod{ 0, static_cast<uint32_t>(meshData.indexCount), 0.f });
+		}
+		if (uploadBatch) {
+			uploadTicket = uploadBatch->ticket();
+			createBuffers(*uploadBatch);
+		}
+		else {
+			OvrUploadBatch batch{ ovrDevice };
+			uploadTicket = batch.ticket();
+			createBuffers(batch);
+			batch.submit();
+		}
 	}
 
 	OvrModel::~OvrModel()
 	{
-		vkDestroyBuffer(ovrDevice.device(), vertexBuffer, nullptr);
-		vkFreeMemory(ovrDevice.device(), vertexBufferMemory, nullptr);
-	
-		if (hasIndexBuffer) {
-			vkDestroyBuffer(ovrDevice.device(), indexBuffer, nullptr);
-			vkFreeMemory(ovrDevice.device(), indexBufferMemory, nullptr);
+		ovrDevice.waitForUpload(uploadTicket); // the copy may still be writing the buffers
+		ovrDevice.geometryPool().free(vertexRange);
+		ovrDevice.geometryPool().free(indexRange);
+	}
+
+	OvrModel::Bounds OvrModel::Bounds::fromVertices(const std::vector<Vertex>& vertices)
+	{
+		return fromVertices(vertices.data(), vertices.size());
+	}
+
+	OvrModel::Bounds OvrModel::Bounds::fromVertices(const Vertex* vertices, size_t vertexCount)
+	{
+		Bounds bounds{};
+		for (size_t i = 0; i < vertexCount; i++) {
+			bounds.min = glm::min(bounds.min, vertices[i].position);
+			bounds.max = glm::max(bounds.max, vertices[i].position);
 		}
+		if (!bounds.isValid()) {
+			return bounds;
+		}
+
+		// sphere around the box center: not minimal, but cheap and at most the box half diagonal
+		glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+		float radiusSquared = 0.f;
+		for (size_t i = 0; i < vertexCount; i++) {
+			glm::vec3 offset = vertices[i].position - center;
+			radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.sphere = glm::vec4{ center, glm::sqrt(radiusSquared) };
+		return bounds;
 	}
 
 	std::unique_ptr<OvrModel> OvrModel::createModelFromFile(
-		OVRDevice& device, const std::string& filepath) {
-		Builder builder{};
-		builder.loadModel(filepath);
-		std::cout << "Vertex count:" << builder.vertices.size() << "\n";
-		return std::make_unique<OvrModel>(device, builder);
+		OVRDevice& device, const std::string& filepath, OvrUploadBatch* uploadBatch, VertexFormat format, bool splitStreams) {
+		OvrMeshAsset asset = OvrMeshAsset::load(filepath);
+		std::cout << "Vertex count:" << asset.getMeshData().vertexCount << (asset.isFromCache() ? " (cached)\n" : "\n");
+		return std::make_unique<OvrModel>(device, asset.getMeshData(), uploadBatch, format, splitStreams);
+	}
+
+	VkDeviceSize OvrModel::getVertexMemorySize() const
+	{
+		switch (vertexFormat) {
+		case VertexFormat::Compressed:
+			return sizeof(CompressedVertex) * vertexCount;
+		case VertexFormat::CompressedColor:
+			return (sizeof(CompressedVertex) + sizeof(uint32_t)) * vertexCount;
+		default:
+			return sizeof(Vertex) * vertexCount;
+		}
 	}
 
 
-	void OvrModel::CreateVertexBuffers(const std::vector<Vertex>& vertices)
+	void OvrModel::CreateVertexBuffers(const Vertex* vertices, size_t count, bool splitStreams, OvrUploadBatch& uploadBatch)
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
+		vertexCount = static_cast<uint32_t>(count);
 		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-
-		ovrDevice.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory
-		);
-		void* data;
-		vkMapMemory(ovrDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	
-		memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(ovrDevice.device(), stagingBufferMemory);
-	
-		ovrDevice.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			vertexBuffer,
-			vertexBufferMemory
-		);
-
-		ovrDevice.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-		vkDestroyBuffer(ovrDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(ovrDevice.device(), stagingBufferMemory, nullptr);
-	}
-
-	void OvrModel::CreateIndexBuffers(const std::vector<uint32_t>& indices)
-	{
-		indexCount = static_cast<uint32_t>(indices.size());
-		hasIndexBuffer = indexCount > 0;
+		CreateStreamBuffers(vertices, sizeof(glm::vec3), sizeof(VertexAttributes), splitStreams, uploadBatch);
+	}
 
-		if (!hasIndexBuffer) {
-			return;
+	void OvrModel::CreateCompressedVertexBuffers(const Vertex* vertices, size_t count, bool splitStreams, OvrUploadBatch& uploadBatch)
+	{
+		vertexCount = static_cast<uint32_t>(count);
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
+		dequantization = OvrVertexCompression::getDequantization(bounds);
+
+		const bool withColor = vertexFormat == VertexFormat::CompressedColor;
+		std::vector<CompressedVertex> compressed;
+		std::vector<uint32_t> colors;
+		OvrVertexCompression::compress(vertices, count, dequantization, compressed, withColor ? &colors : nullptr);
+
+		CreateStreamBuffers(compressed.data(), 4 * sizeof(uint16_t), sizeof(CompressedAttributes), splitStreams, uploadBatch);
+		if (withColor) {
+			uploadVertexStream(COLOR_BINDING, colors.data(), sizeof(colors[0]) * vertexCount, uploadBatch);
 		}
+	}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+	void OvrModel::CreateStreamBuffers(
+		const void* vertices, uint32_t positionSize, uint32_t attributeSize, bool splitStreams, OvrUploadBatch& uploadBatch)
+	{
+		vertexRange = ovrDevice.geometryPool().allocateVertices(getVertexLayout(), vertexCount);
+
+		const uint32_t vertexSize = positionSize + attributeSize;
+		if (!splitStreams) {
+			uploadVertexStream(POSITION_BINDING, vertices, static_cast<VkDeviceSize>(vertexSize) * vertexCount, uploadBatch);
+			return;
+		}
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
+		std::vector<uint8_t> positions(static_cast<size_t>(positionSize) * vertexCount);
+		std::vector<uint8_t> attributes(static_cast<size_t>(attributeSize) * vertexCount);
+		const auto* vertex = static_cast<const uint8_t*>(vertices);
+		for (size_t i = 0; i < vertexCount; i++, vertex += vertexSize) {
+			std::memcpy(positions.data() + i * positionSize, vertex, positionSize);
+			std::memcpy(attributes.data() + i * attributeSize, vertex + positionSize, attributeSize);
+		}
+		uploadVertexStream(POSITION_BINDING, positions.data(), positions.size(), uploadBatch);
+		uploadVertexStream(ATTRIBUTE_BINDING, attributes.data(), attributes.size(), uploadBatch);
+	}
 
-		ovrDevice.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBuffer,
-			stagingBufferMemory
-		);
-		void* data;
-		vkMapMemory(ovrDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+	void OvrModel::uploadVertexStream(uint32_t binding, const void* data, VkDeviceSize size, OvrUploadBatch& uploadBatch)
+	{
+		VkDeviceSize offset = 0;
+		VkBuffer buffer = ovrDevice.geometryPool().getVertexBuffer(vertexRange, binding, offset);
+		uploadBatch.uploadBuffer(buffer, data, size, offset);
+	}
 
-		memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-		vkUnmapMemory(ovrDevice.device(), stagingBufferMemory);
+	void OvrModel::CreateIndexBuffers(const uint32_t* indices, size_t count, OvrUploadBatch& uploadBatch)
+	{
+		// every level goes into the same range
+		const uint32_t totalCount = static_cast<uint32_t>(count);
+		indexCount = lods[0].indexCount;
+		hasIndexBuffer = indexCount > 0;
 
-		ovrDevice.createBuffer(
-			bufferSize,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			indexBuffer,
-			indexBufferMemory
-		);
+		if (!hasIndexBuffer) {
+			return;
+		}
 
-		ovrDevice.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+		// half the index memory and fetch bandwidth whenever 16 bits address every vertex
+		const bool shortIndices = vertexCount <= std::numeric_limits<uint16_t>::max();
+		indexRange = ovrDevice.geometryPool().allocateIndices(
+			shortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32, totalCount);
+		VkBuffer indexBuffer = ovrDevice.geometryPool().getIndexBuffer(indexRange);
 
-		vkDestroyBuffer(ovrDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(ovrDevice.device(), stagingBufferMemory, nullptr);
+		if (shortIndices) {
+			std::vector<uint16_t> shortIndexData(indices, indices + totalCount);
+			uploadBatch.uploadBuffer(indexBuffer, shortIndexData.data(), sizeof(uint16_t) * totalCount,
+				sizeof(uint16_t) * static_cast<VkDeviceSize>(indexRange.firstIndex));
+		}
+		else {
+			uploadBatch.uploadBuffer(indexBuffer, indices, sizeof(uint32_t) * totalCount,
+				sizeof(uint32_t) * static_cast<VkDeviceSize>(indexRange.firstIndex));
+		}
 	}
 
-	void OvrModel::draw(VkCommandBuffer commandBuffer)
+	void OvrModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
 	{
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			assert(lod < lods.size() && "LOD out of range");
+			vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, instanceCount, indexRange.firstIndex + lods[lod].firstIndex,
+				getVertexOffset(), firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, vertexRange.firstVertex, firstInstance);
 		}
 	}
 
-	void OvrModel::bind(VkCommandBuffer commandBuffer)
+	void OvrModel::bind(VkCommandBuffer commandBuffer, uint32_t streams, OvrGeometryPool::BindState* bindState)
 	{
-		VkBuffer buffers[] = { vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
+		ovrDevice.geometryPool().bindVertices(commandBuffer, vertexRange, streams, bindState);
 		if (hasIndexBuffer) {
-			// max vectex count for INDEX_UINT32 about 4 billion, INDEX_UINT16 - 64 000, INDEX_UINT8 - 256
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32); 
+			ovrDevice.geometryPool().bindIndices(commandBuffer, indexRange, bindState);
 		}
 	}
 	std::vector<VkVertexInputBindingDescription> OvrModel::Vertex::getBindingDescriptions()
 	{
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return OvrModel::getBindingDescriptions(getVertexLayout(VertexFormat::Float, false), ALL_STREAMS);
+	}
+
+	std::vector<VkVertexInputAttributeDescription> OvrModel::Vertex::getAttributeDescriptions()
+	{
+		return OvrModel::getAttributeDescriptions(getVertexLayout(VertexFormat::Float, false), ALL_STREAMS);
+	}
+
+	// sizes and formats of one vertex layout, the attributes start right after the position when interleaved
+	struct OvrStreamLayout {
+		uint32_t positionSize;
+		uint32_t attributeSize;
+		uint32_t attributeBinding;
+		uint32_t attributeOffset;
+		bool interleaved;
+		bool compressed;
+		bool withColor;
+
+		explicit OvrStreamLayout(uint32_t vertexLayout) {
+			const OvrModel::VertexFormat format = OvrModel::getVertexFormat(vertexLayout);
+			interleaved = vertexLayout < OvrModel::VERTEX_FORMAT_COUNT;
+			compressed = format != OvrModel::VertexFormat::Float;
+			withColor = format == OvrModel::VertexFormat::CompressedColor;
+			positionSize = compressed ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+			attributeSize = compressed ? sizeof(OvrModel::CompressedAttributes) : sizeof(OvrModel::VertexAttributes);
+			attributeBinding = interleaved ? OvrModel::POSITION_BINDING : OvrModel::ATTRIBUTE_BINDING;
+			attributeOffset = interleaved ? positionSize : 0;
+		}
+	};
+
+	std::vector<VkVertexInputBindingDescription> OvrModel::getBindingDescriptions(uint32_t vertexLayout, uint32_t streams)
+	{
+		const OvrStreamLayout layout{ vertexLayout };
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		if (layout.interleaved) {
+			// the stride covers the attributes even when only the positions are read
+			bindingDescriptions.push_back({ POSITION_BINDING, layout.positionSize + layout.attributeSize, VK_VERTEX_INPUT_RATE_VERTEX });
+		}
+		else {
+			if (streams & POSITION_STREAM) {
+				bindingDescriptions.push_back({ POSITION_BINDING, layout.positionSize, VK_VERTEX_INPUT_RATE_VERTEX });
+			}
+			if (streams & ATTRIBUTE_STREAM) {
+				bindingDescriptions.push_back({ ATTRIBUTE_BINDING, layout.attributeSize, VK_VERTEX_INPUT_RATE_VERTEX });
+			}
+		}
+		if ((streams & ATTRIBUTE_STREAM) && layout.withColor) {
+			bindingDescriptions.push_back({ COLOR_BINDING, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_VERTEX });
+		}
 		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> OvrModel::getAttributeDescriptions(uint32_t vertexLayout, uint32_t streams)
+	{
+		const OvrStreamLayout layout{ vertexLayout };
+		const uint32_t binding = layout.attributeBinding;
+		const uint32_t offset = layout.attributeOffset;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+		// compressed positions and normals are decoded by the shader
+		if (streams & POSITION_STREAM) {
+			attributeDescriptions.push_back({ 0, POSITION_BINDING,
+				layout.compressed ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT, 0 });
+		}
+		if ((streams & ATTRIBUTE_STREAM) && layout.compressed) {
+			if (layout.withColor) {
+				attributeDescriptions.push_back({ 1, COLOR_BINDING, VK_FORMAT_R8G8B8A8_UNORM, 0 });
+			}
+			attributeDescriptions.push_back({ 2, binding, VK_FORMAT_R16G16_SNORM,
+				static_cast<uint32_t>(offset + offsetof(CompressedAttributes, normal)) });
+			attributeDescriptions.push_back({ 3, binding, VK_FORMAT_R16G16_SFLOAT,
+				static_cast<uint32_t>(offset + offsetof(CompressedAttributes, uv)) });
+		}
+		else if (streams & ATTRIBUTE_STREAM) {
+			attributeDescriptions.push_back({ 1, binding, VK_FORMAT_R32G32B32_SFLOAT,
+				static_cast<uint32_t>(offset + offsetof(VertexAttributes, color)) });
+			attributeDescriptions.push_back({ 2, binding, VK_FORMAT_R32G32B32_SFLOAT,
+				static_cast<uint32_t>(offset + offsetof(VertexAttributes, normal)) });
+			attributeDescriptions.push_back({ 3, binding, VK_FORMAT_R32G32_SFLOAT,
+				static_cast<uint32_t>(offset + offsetof(VertexAttributes, uv)) });
+		}
 
+		return attributeDescriptions;
 	}
-	std::vector<VkVertexInputAttributeDescription> OvrModel::Vertex::getAttributeDescriptions()
+
+	std::vector<VkVertexInputBindingDescription> OvrModel::InstanceData::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = BINDING;
+		bindingDescriptions[0].stride = sizeof(InstanceData);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> OvrModel::InstanceData::getAttributeDescriptions()
 	{
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
+		// a mat4 attribute takes one location per column
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({ 4 + column, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)) });
+		}
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({ 8 + column, BINDING, VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4)) });
+		}
 
 		return attributeDescriptions;
 	}
 
-	void OvrModel::Builder::loadModel(const std::string& filepath) {
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
-		
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filepath.c_str())) {
-			//std::cout << err << std::endl;
-			throw std::runtime_error(warn + err);
+	void OvrModel::Builder::loadModel(const std::string& filepath, OvrJobSystem* jobSystem) {
+		loadObj(OvrObjParser::parseFile(filepath, jobSystem), jobSystem);
+	}
+
+	static OvrModel::Vertex makeVertex(const OvrObjData& obj, const OvrObjData::Corner& index) {
+		OvrModel::Vertex vertex{};
+		if (index.position >= 0) {
+			vertex.position = {
+				obj.positions[3 * index.position + 0],
+				obj.positions[3 * index.position + 1],
+				obj.positions[3 * index.position + 2],
+			};
+
+			auto colorIndex = 3 * static_cast<size_t>(index.position) + 2;
+			if (colorIndex < obj.colors.size()) {
+				vertex.color = {
+					obj.colors[colorIndex - 2],
+					obj.colors[colorIndex - 1],
+					obj.colors[colorIndex - 0],
+				};
+			}
+			else {
+				vertex.color = { 1.f, 1.f, 1.f };  // set default color
+			}
 		}
 
+		if (index.normal >= 0) {
+			vertex.normal = {
+				obj.normals[3 * index.normal + 0],
+				obj.normals[3 * index.normal + 1],
+				obj.normals[3 * index.normal + 2],
+			};
+		}
+		if (index.texcoord >= 0) {
+			vertex.uv = {
+				obj.texcoords[2 * index.texcoord + 0],
+				obj.texcoords[2 * index.texcoord + 1],
+			};
+		}
+		return vertex;
+	}
+
+	void OvrModel::Builder::loadObj(const OvrObjData& obj, OvrJobSystem* jobSystem) {
 		vertices.clear();
 		indices.clear();
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex{};
-				if (index.vertex_index >= 0) {
-					vertex.position = {
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-
-					auto colorIndex = 3 * index.vertex_index + 2;
-					if (colorIndex < attrib.colors.size()) {
-						vertex.color = {
-							attrib.colors[colorIndex - 2],
-							attrib.colors[colorIndex - 1],
-							attrib.colors[colorIndex - 0],
-						};
-					}
-					else {
-						vertex.color = { 1.f, 1.f, 1.f };  // set default color
-					}
-					vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
+		const size_t cornerCount = obj.corners.size();
+		if (jobSystem != nullptr && cornerCount >= OvrVertexTable::PARALLEL_MIN_CORNERS) {
+			std::vector<Vertex> cornerVertices(cornerCount);
+			jobSystem->parallelFor(static_cast<uint32_t>(cornerCount), 0, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					cornerVertices[i] = makeVertex(obj, obj.corners[i]);
 				}
-
-				if (index.normal_index >= 0) {
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-				if (index.texcoord_index >= 0) {
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
+			});
+			OvrVertexTable::deduplicate(cornerVertices.data(), cornerCount, *jobSystem, vertices, indices);
+		}
+		else {
+			OvrVertexTable uniqueVertices{ cornerCount };
+			indices.reserve(cornerCount);
+			for (const auto& index : obj.corners) {
+				indices.push_back(uniqueVertices.insert(makeVertex(obj, index), vertices));
 			}
 		}
+
+		bounds = Bounds::fromVertices(vertices);
 	}
 
 }
\ No newline at end of file
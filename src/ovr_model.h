@@ -6,15 +6,51 @@
 //========================================================================
 #pragma once
 #include "ovr_device.h"
+#include "ovr_geometry_pool.h"
+#include "ovr_upload_batch.h"
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <limits>
 #include <vector>
 #include <memory>
 
 namespace ovr {
+	class OvrJobSystem;
+	struct OvrObjData;
+
 	class OvrModel {
 	public:
+		// vertex layout of a model's buffers, every one has its own pipeline (see the render systems)
+		enum class VertexFormat : uint32_t {
+			Float,           // Vertex, 44 bytes
+			Compressed,      // CompressedVertex, 16 bytes, drawn white
+			CompressedColor, // CompressedVertex and a color stream, 20 bytes
+		};
+		static constexpr uint32_t VERTEX_FORMAT_COUNT = 3;
+		// a format stored interleaved or split into streams, see getVertexLayout
+		static constexpr uint32_t VERTEX_LAYOUT_COUNT = VERTEX_FORMAT_COUNT * 2;
+
+		// vertex buffer bindings, InstanceData::BINDING sits between them
+		static constexpr uint32_t POSITION_BINDING = 0;  // the interleaved vertices, or only their positions
+		static constexpr uint32_t ATTRIBUTE_BINDING = 2; // everything but the positions, split models only
+		static constexpr uint32_t COLOR_BINDING = 3;     // R8G8B8A8_UNORM, VertexFormat::CompressedColor only
+
+		// what a pipeline reads and bind binds, the color stream goes with the attributes
+		enum VertexStreamBits : uint32_t {
+			POSITION_STREAM = 1 << 0,
+			ATTRIBUTE_STREAM = 1 << 1,
+			ALL_STREAMS = POSITION_STREAM | ATTRIBUTE_STREAM,
+		};
+
+		// an interleaved vertex is its position followed by its attributes, split models store the
+		// positions tightly packed in one buffer and the attributes in another
+		struct VertexAttributes {
+			glm::vec3 color{};
+			glm::vec3 normal{};
+			glm::vec2 uv{};
+		};
+
 		struct Vertex {
 			glm::vec3 position{};
 			glm::vec3 color{};
@@ -30,39 +66,193 @@ namespace ovr {
 			}
 		};
 
+		struct CompressedAttributes {
+			int16_t normal[2];
+			uint16_t uv[2];
+		};
+
+		// positions as 16 bit unorm within the model's bounds, decoded with Dequantization in the shader,
+		// octahedral normals in 2x16 bit snorm and half float uvs (see OvrVertexCompression)
+		struct CompressedVertex {
+			uint16_t position[4]; // w is padding
+			int16_t normal[2];
+			uint16_t uv[2];
+		};
+
+		// model space position = offset + decoded unorm * scale, identity for VertexFormat::Float.
+		// vec4 so it can be pushed after the projection as std430 push constants
+		struct Dequantization {
+			glm::vec4 positionScale{ 1.f };
+			glm::vec4 positionOffset{ 0.f };
+		};
+
+		// a cluster of at most OvrMeshletBuilder::MAX_VERTICES vertices and MAX_TRIANGLES triangles, contiguous
+		// in the model's indices, culled on its own by GpuDrivenRenderSystem. Matches shaders/gpu_cluster_cull.comp
+		struct Meshlet {
+			glm::vec4 boundingSphere{ 0.f }; // model space, xyz = center, w = radius
+			glm::vec4 cone{ 0.f, 0.f, 0.f, 2.f }; // xyz = average normal, w = sine of the normals' spread, above 1 when none
+			uint32_t firstIndex = 0;         // relative to the model's first index
+			uint32_t triangleCount = 0;
+			uint32_t vertexCount = 0;
+			uint32_t padding = 0;
+		};
+
+		// a level of detail, its own triangles over the model's vertices (see OvrMeshSimplifier). Level 0 is
+		// the full mesh, every further one has fewer triangles and a larger error
+		struct Lod {
+			uint32_t firstIndex = 0; // relative to the model's first index
+			uint32_t indexCount = 0;
+			float error = 0.f;       // model space distance to the full mesh, roughly, 0 for level 0
+			uint32_t padding = 0;
+		};
+
+		// index of a format and storage pair, below VERTEX_LAYOUT_COUNT
+		static uint32_t getVertexLayout(VertexFormat format, bool splitStreams) {
+			return static_cast<uint32_t>(format) + (splitStreams ? VERTEX_FORMAT_COUNT : 0);
+		}
+		static VertexFormat getVertexFormat(uint32_t vertexLayout) {
+			return static_cast<VertexFormat>(vertexLayout % VERTEX_FORMAT_COUNT);
+		}
+		// the descriptions of the streams given, locations 0-3 as in Vertex whatever the format.
+		// OvrVertexLayout picks the streams at compile time
+		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(uint32_t vertexLayout, uint32_t streams);
+		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(uint32_t vertexLayout, uint32_t streams);
+
+		// per-instance attributes read from binding 1, locations 4-11
+		struct InstanceData {
+			glm::mat4 modelMatrix{ 1.f };
+			glm::mat4 normalMatrix{ 1.f };
+
+			static constexpr uint32_t BINDING = 1;
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		// model space bounding volumes
+		struct Bounds {
+			glm::vec3 min{ std::numeric_limits<float>::max() };
+			glm::vec3 max{ std::numeric_limits<float>::lowest() };
+			glm::vec4 sphere{ 0.f }; // xyz = center, w = radius
+
+			bool isValid() const { return min.x <= max.x; }
+			static Bounds fromVertices(const std::vector<Vertex>& vertices);
+			static Bounds fromVertices(const Vertex* vertices, size_t vertexCount);
+		};
+
+		// vertices and indices owned by someone else, a Builder or a mapped .ovrmesh (see OvrMeshCache).
+		// Only read while the model is constructed, the uploads copy them into staging memory.
+		struct MeshData {
+			const Vertex* vertices = nullptr;
+			size_t vertexCount = 0;
+			const uint32_t* indices = nullptr;
+			size_t indexCount = 0;
+			const Meshlet* meshlets = nullptr; // over the indices of level 0, none for meshes that were not clustered
+			size_t meshletCount = 0;
+			const Lod* lods = nullptr; // over indices, which hold every level. None is one level of all of them
+			size_t lodCount = 0;
+			Bounds bounds{}; // computed by OvrModel when left empty
+		};
+
 		struct Builder {
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			std::vector<Meshlet> meshlets{}; // see OvrMeshletBuilder, indices must be in their order
+			std::vector<Lod> lods{};         // see OvrMeshSimplifier::buildLods
+			Bounds bounds{}; // filled by loadModel, computed by OvrModel when left empty
 
-			void loadModel(const std::string& filepath);
+			// parses the OBJ, always, in chunks on jobSystem when given.
+			// OvrModel::createModelFromFile goes through the mesh cache instead
+			void loadModel(const std::string& filepath, OvrJobSystem* jobSystem = nullptr);
+			// deduplicates the corners of a parsed OBJ into vertices and indices, sort based on
+			// jobSystem for big meshes (see OvrVertexTable)
+			void loadObj(const OvrObjData& obj, OvrJobSystem* jobSystem = nullptr);
+			MeshData getMeshData() const {
+				return MeshData{ vertices.data(), vertices.size(), indices.data(), indices.size(),
+					meshlets.data(), meshlets.size(), lods.data(), lods.size(), bounds };
+			}
 		};
 
-		OvrModel(OVRDevice &device, const OvrModel::Builder &builder);
+		// records the vertex/index uploads into uploadBatch, or submits them on its own when null.
+		// Compressed leaves out the color stream when every vertex is white, CompressedColor always keeps it.
+		// splitStreams stores the positions apart so position only passes fetch nothing else
+		OvrModel(OVRDevice &device, const OvrModel::Builder &builder, OvrUploadBatch* uploadBatch = nullptr,
+			VertexFormat format = VertexFormat::Float, bool splitStreams = false);
+		OvrModel(OVRDevice &device, const MeshData &meshData, OvrUploadBatch* uploadBatch = nullptr,
+			VertexFormat format = VertexFormat::Float, bool splitStreams = false);
 		~OvrModel();
 
 		OvrModel(const OvrModel&) = delete;
 		OvrModel& operator=(const OvrModel&) = delete;
 
+		// maps the file's .ovrmesh cache when it is up to date, otherwise parses the file and writes the cache
 		static std::unique_ptr<OvrModel> createModelFromFile(
-			OVRDevice& device, const std::string& filepath);
+			OVRDevice& device,
+			const std::string& filepath,
+			OvrUploadBatch* uploadBatch = nullptr,
+			VertexFormat format = VertexFormat::Float,
+			bool splitStreams = false);
+
+		// false while the upload that fills the buffers is still in flight
+		bool isUploaded() { return ovrDevice.isUploadComplete(uploadTicket); }
 
-		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		const Bounds& getBounds() const { return bounds; }
+		// model space, xyz = center, w = radius
+		const glm::vec4& getBoundingSphere() const { return bounds.sphere; }
+		bool hasIndices() const { return hasIndexBuffer; }
+		// of level 0
+		uint32_t getIndexCount() const { return indexCount; }
+		uint32_t getVertexCount() const { return vertexCount; }
+		// where the mesh is in the device's OvrGeometryPool pages, for draws recorded by hand
+		uint32_t getFirstIndex() const { return indexRange.firstIndex; }
+		int32_t getVertexOffset() const { return static_cast<int32_t>(vertexRange.firstVertex); }
+		// empty when the mesh was not clustered, firstIndex of each is relative to getFirstIndex
+		const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+		// at least level 0, firstIndex of each is relative to getFirstIndex
+		const std::vector<Lod>& getLods() const { return lods; }
+		uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+		// UINT16 whenever every vertex can be addressed with it
+		VkIndexType getIndexType() const { return indexRange.indexType; }
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		bool hasSplitStreams() const { return splitStreams; }
+		uint32_t getVertexLayout() const { return getVertexLayout(vertexFormat, hasSplitStreams()); }
+		const Dequantization& getDequantization() const { return dequantization; }
+		// bytes of every vertex buffer together
+		VkDeviceSize getVertexMemorySize() const;
+
+		// binds the geometry pool pages holding streams (VertexStreamBits) and the indices. An interleaved
+		// model has the attributes in its position buffer, so it fetches them anyway.
+		// With a bindState the pages already bound for the previous model are not bound again
+		void bind(VkCommandBuffer commandBuffer, uint32_t streams = ALL_STREAMS,
+			OvrGeometryPool::BindState* bindState = nullptr);
+		// lod is below getLodCount, models without indices only have one
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
 
 	private:
-		void CreateVertexBuffers(const std::vector<Vertex>& vertices);
-		void CreateIndexBuffers(const std::vector<uint32_t>& indices);
+		void CreateVertexBuffers(const Vertex* vertices, size_t count, bool splitStreams, OvrUploadBatch& uploadBatch);
+		void CreateCompressedVertexBuffers(const Vertex* vertices, size_t count, bool splitStreams, OvrUploadBatch& uploadBatch);
+		// the interleaved vertices as they are, or split into the position and attribute streams
+		void CreateStreamBuffers(const void* vertices, uint32_t positionSize, uint32_t attributeSize, bool splitStreams,
+			OvrUploadBatch& uploadBatch);
+		// copies data into the stream at binding of the model's vertex range
+		void uploadVertexStream(uint32_t binding, const void* data, VkDeviceSize size, OvrUploadBatch& uploadBatch);
+		void CreateIndexBuffers(const uint32_t* indices, size_t count, OvrUploadBatch& uploadBatch);
 
 		OVRDevice& ovrDevice;
+		OvrUploadTicket uploadTicket;
+
+		VertexFormat vertexFormat = VertexFormat::Float;
+		bool splitStreams = false;
+		Dequantization dequantization{};
 
-		VkBuffer vertexBuffer;
-		VkDeviceMemory vertexBufferMemory;
+		OvrGeometryPool::VertexRange vertexRange{};
 		uint32_t vertexCount;
 
 		bool hasIndexBuffer = false;
-
-		VkBuffer indexBuffer;
-		VkDeviceMemory indexBufferMemory;
+		OvrGeometryPool::IndexRange indexRange{};
 		uint32_t indexCount;
+		std::vector<Meshlet> meshlets; // kept for the render systems to upload
+		std::vector<Lod> lods;
+
+		Bounds bounds{};
 	};
 }
\ No newline at end of file
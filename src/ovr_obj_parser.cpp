@@ -0,0 +1,396 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_obj_parser.h"
+#include "ovr_job_system.h"
+#include "ovr_mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace ovr {
+	static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;  // smaller chunks cost more in the merge than they save
+	static constexpr uint32_t CHUNKS_PER_THREAD = 4;    // so threads that finish early have something to steal
+
+	// a face corner before triangulation, relative has a bit per attribute whose index is chunk local
+	struct OvrFaceCorner {
+		OvrObjData::Corner corner{};
+		uint8_t relative = 0;
+	};
+
+	struct OvrObjChunk {
+		OvrObjData data;
+		std::vector<size_t> relativeSlots; // corner * 3 + attribute, indices to rebase in the merge
+		std::vector<OvrFaceCorner> face;   // the face being parsed
+	};
+
+	static bool isSpace(char c) { return c == ' ' || c == '\t'; }
+	static bool isDigit(char c) { return static_cast<unsigned int>(c - '0') < 10u; }
+
+	static int32_t& cornerSlot(OvrObjData::Corner& corner, size_t attribute) {
+		return attribute == 0 ? corner.position : attribute == 1 ? corner.texcoord : corner.normal;
+	}
+
+	// tinyobj's tryParseDouble over [s, end). The same operations in the same order, so the doubles
+	// (and the floats they are rounded to) come out identical, a correctly rounded parser would differ
+	static bool parseDouble(const char* s, const char* end, double& result) {
+		static const double POW_LUT[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+		constexpr int LUT_ENTRIES = sizeof(POW_LUT) / sizeof(POW_LUT[0]);
+		if (s >= end) {
+			return false;
+		}
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		char sign = '+';
+		const char* curr = s;
+		if (*curr == '+' || *curr == '-') {
+			sign = *curr;
+			curr++;
+		}
+		else if (!isDigit(*curr)) {
+			return false;
+		}
+
+		int read = 0;
+		while (curr != end && isDigit(*curr)) {
+			mantissa *= 10;
+			mantissa += static_cast<int>(*curr - '0');
+			curr++;
+			read++;
+		}
+		if (read == 0) {
+			return false;
+		}
+
+		if (curr != end && *curr == '.') {
+			curr++;
+			read = 1;
+			while (curr != end && isDigit(*curr)) {
+				mantissa += static_cast<int>(*curr - '0') * (read < LUT_ENTRIES ? POW_LUT[read] : std::pow(10.0, -read));
+				read++;
+				curr++;
+			}
+		}
+
+		if (curr != end && (*curr == 'e' || *curr == 'E')) {
+			curr++;
+			char exponentSign = '+';
+			if (curr != end && (*curr == '+' || *curr == '-')) {
+				exponentSign = *curr;
+				curr++;
+			}
+			else if (curr == end || !isDigit(*curr)) {
+				return false; // empty exponent
+			}
+			read = 0;
+			while (curr != end && isDigit(*curr)) {
+				exponent *= 10;
+				exponent += static_cast<int>(*curr - '0');
+				curr++;
+				read++;
+			}
+			exponent *= (exponentSign == '+' ? 1 : -1);
+			if (read == 0) {
+				return false;
+			}
+		}
+
+		result = (sign == '+' ? 1 : -1) *
+			(exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	// tinyobj's parseReal: the next space separated token, defaultValue when it isn't a number
+	static float parseReal(const char*& token, const char* lineEnd, double defaultValue) {
+		while (token < lineEnd && isSpace(*token)) {
+			token++;
+		}
+		const char* end = token;
+		while (end < lineEnd && !isSpace(*end)) {
+			end++;
+		}
+		double value = defaultValue;
+		parseDouble(token, end, value);
+		token = end;
+		return static_cast<float>(value);
+	}
+
+	// atoi, bounded by the line
+	static int32_t parseInt(const char* token, const char* lineEnd) {
+		while (token < lineEnd && (isSpace(*token) || *token == '\v' || *token == '\f')) {
+			token++;
+		}
+		bool negative = false;
+		if (token < lineEnd && (*token == '+' || *token == '-')) {
+			negative = *token == '-';
+			token++;
+		}
+		uint32_t value = 0;
+		while (token < lineEnd && isDigit(*token)) {
+			value = value * 10 + static_cast<uint32_t>(*token - '0');
+			token++;
+		}
+		return static_cast<int32_t>(negative ? 0u - value : value);
+	}
+
+	static const char* skipIndex(const char* token, const char* lineEnd) {
+		while (token < lineEnd && *token != '/' && !isSpace(*token)) {
+			token++;
+		}
+		return token;
+	}
+
+	// tinyobj's fixIndex, except that negative indices stay chunk local until the merge
+	static int32_t fixIndex(int32_t index, size_t localCount, uint32_t attribute, uint8_t& relative) {
+		if (index > 0) {
+			return index - 1;
+		}
+		if (index == 0) {
+			return 0;
+		}
+		relative |= static_cast<uint8_t>(1u << attribute);
+		return static_cast<int32_t>(localCount) + index;
+	}
+
+	// tinyobj's parseTriple: i, i/j, i//k or i/j/k
+	static OvrFaceCorner parseCorner(const char*& token, const char* lineEnd, const OvrObjData& data) {
+		OvrFaceCorner result{};
+		OvrObjData::Corner& corner = result.corner;
+		corner.position = fixIndex(parseInt(token, lineEnd), data.positions.size() / 3, 0, result.relative);
+		token = skipIndex(token, lineEnd);
+		if (token == lineEnd || *token != '/') {
+			return result;
+		}
+		token++;
+
+		if (token != lineEnd && *token == '/') {
+			token++;
+			corner.normal = fixIndex(parseInt(token, lineEnd), data.normals.size() / 3, 2, result.relative);
+			token = skipIndex(token, lineEnd);
+			return result;
+		}
+
+		corner.texcoord = fixIndex(parseInt(token, lineEnd), data.texcoords.size() / 2, 1, result.relative);
+		token = skipIndex(token, lineEnd);
+		if (token == lineEnd || *token != '/') {
+			return result;
+		}
+		token++;
+		corner.normal = fixIndex(parseInt(token, lineEnd), data.normals.size() / 3, 2, result.relative);
+		token = skipIndex(token, lineEnd);
+		return result;
+	}
+
+	static void emitCorner(const OvrFaceCorner& faceCorner, OvrObjChunk& chunk) {
+		const size_t cornerIndex = chunk.data.corners.size();
+		chunk.data.corners.push_back(faceCorner.corner);
+		for (uint32_t attribute = 0; attribute < 3; attribute++) {
+			if (faceCorner.relative & (1u << attribute)) {
+				chunk.relativeSlots.push_back(cornerIndex * 3 + attribute);
+			}
+		}
+	}
+
+	static void parseLine(const char* token, const char* lineEnd, OvrObjChunk& chunk) {
+		while (token < lineEnd && isSpace(*token)) {
+			token++;
+		}
+		if (lineEnd - token < 2) {
+			return;
+		}
+		OvrObjData& data = chunk.data;
+
+		if (token[0] == 'v' && isSpace(token[1])) {
+			token += 2;
+			float x = parseReal(token, lineEnd, 0.0);
+			float y = parseReal(token, lineEnd, 0.0);
+			float z = parseReal(token, lineEnd, 0.0);
+			float r = parseReal(token, lineEnd, 1.0);
+			float g = parseReal(token, lineEnd, 1.0);
+			float b = parseReal(token, lineEnd, 1.0);
+			data.positions.insert(data.positions.end(), { x, y, z });
+			data.colors.insert(data.colors.end(), { r, g, b });
+		}
+		else if (token[0] == 'v' && lineEnd - token >= 3 && token[1] == 'n' && isSpace(token[2])) {
+			token += 3;
+			float x = parseReal(token, lineEnd, 0.0);
+			float y = parseReal(token, lineEnd, 0.0);
+			float z = parseReal(token, lineEnd, 0.0);
+			data.normals.insert(data.normals.end(), { x, y, z });
+		}
+		else if (token[0] == 'v' && lineEnd - token >= 3 && token[1] == 't' && isSpace(token[2])) {
+			token += 3;
+			float u = parseReal(token, lineEnd, 0.0);
+			float v = parseReal(token, lineEnd, 0.0);
+			data.texcoords.insert(data.texcoords.end(), { u, v });
+		}
+		else if (token[0] == 'f' && isSpace(token[1])) {
+			token += 2;
+			while (token < lineEnd && isSpace(*token)) {
+				token++;
+			}
+			chunk.face.clear();
+			while (token < lineEnd) {
+				chunk.face.push_back(parseCorner(token, lineEnd, data));
+				while (token < lineEnd && isSpace(*token)) {
+					token++;
+				}
+			}
+			// triangle fan, like tinyobj with triangulation on
+			for (size_t k = 2; k < chunk.face.size(); k++) {
+				emitCorner(chunk.face[0], chunk);
+				emitCorner(chunk.face[k - 1], chunk);
+				emitCorner(chunk.face[k], chunk);
+			}
+		}
+	}
+
+	static void parseChunk(const char* begin, const char* end, OvrObjChunk& chunk) {
+		const char* line = begin;
+		while (line < end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			if (lineEnd == nullptr) {
+				lineEnd = end;
+			}
+			const char* next = lineEnd + 1;
+			// tinyobj also ends a line at '\r', "\r\n" then reads as a line and an empty one
+			const char* carriageReturn = static_cast<const char*>(std::memchr(line, '\r', lineEnd - line));
+			if (carriageReturn != nullptr) {
+				lineEnd = carriageReturn;
+				next = carriageReturn + 1;
+			}
+			parseLine(line, lineEnd, chunk);
+			line = next;
+		}
+	}
+
+	// where each chunk's elements go in the merged arrays
+	struct OvrChunkBase {
+		size_t positions = 0; // in vertices, not floats
+		size_t normals = 0;
+		size_t texcoords = 0;
+		size_t corners = 0;
+	};
+
+	static void copyAppend(std::vector<float>& destination, size_t offset, const std::vector<float>& source) {
+		if (!source.empty()) {
+			std::memcpy(destination.data() + offset, source.data(), source.size() * sizeof(float));
+		}
+	}
+
+	static OvrObjData mergeChunks(std::vector<OvrObjChunk>& chunks, OvrJobSystem* jobSystem) {
+		const uint32_t chunkCount = static_cast<uint32_t>(chunks.size());
+		std::vector<OvrChunkBase> bases(chunkCount + 1);
+		for (uint32_t i = 0; i < chunkCount; i++) {
+			const OvrObjData& data = chunks[i].data;
+			bases[i + 1].positions = bases[i].positions + data.positions.size() / 3;
+			bases[i + 1].normals = bases[i].normals + data.normals.size() / 3;
+			bases[i + 1].texcoords = bases[i].texcoords + data.texcoords.size() / 2;
+			bases[i + 1].corners = bases[i].corners + data.corners.size();
+		}
+		const OvrChunkBase& totals = bases[chunkCount];
+
+		OvrObjData merged{};
+		if (chunkCount == 1) {
+			merged = std::move(chunks[0].data);
+		}
+		else {
+			merged.positions.resize(totals.positions * 3);
+			merged.colors.resize(totals.positions * 3);
+			merged.normals.resize(totals.normals * 3);
+			merged.texcoords.resize(totals.texcoords * 2);
+			merged.corners.resize(totals.corners);
+		}
+
+		std::atomic<bool> outOfRange{ false };
+		auto mergeRange = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				const OvrChunkBase& base = bases[i];
+				OvrObjChunk& chunk = chunks[i];
+				if (chunkCount > 1) {
+					copyAppend(merged.positions, base.positions * 3, chunk.data.positions);
+					copyAppend(merged.colors, base.positions * 3, chunk.data.colors);
+					copyAppend(merged.normals, base.normals * 3, chunk.data.normals);
+					copyAppend(merged.texcoords, base.texcoords * 2, chunk.data.texcoords);
+					std::copy(chunk.data.corners.begin(), chunk.data.corners.end(), merged.corners.begin() + base.corners);
+				}
+
+				OvrObjData::Corner* corners = merged.corners.data() + base.corners;
+				for (size_t slot : chunk.relativeSlots) {
+					const size_t attribute = slot % 3;
+					const size_t attributeBase = attribute == 0 ? base.positions : attribute == 1 ? base.texcoords : base.normals;
+					cornerSlot(corners[slot / 3], attribute) += static_cast<int32_t>(attributeBase);
+				}
+
+				// negative indices are "none" to the model builder, like before. Past the end is a broken file
+				const size_t cornerCount = bases[i + 1].corners - base.corners;
+				for (size_t c = 0; c < cornerCount; c++) {
+					const OvrObjData::Corner& corner = corners[c];
+					if ((corner.position >= 0 && static_cast<size_t>(corner.position) >= totals.positions) ||
+						(corner.texcoord >= 0 && static_cast<size_t>(corner.texcoord) >= totals.texcoords) ||
+						(corner.normal >= 0 && static_cast<size_t>(corner.normal) >= totals.normals)) {
+						outOfRange.store(true, std::memory_order_relaxed);
+						break;
+					}
+				}
+			}
+		};
+		if (jobSystem != nullptr) {
+			jobSystem->parallelFor(chunkCount, 1, mergeRange);
+		}
+		else {
+			mergeRange(0, chunkCount);
+		}
+
+		if (outOfRange.load()) {
+			throw std::runtime_error("failed to parse OBJ: face index out of range!");
+		}
+		return merged;
+	}
+
+	OvrObjData OvrObjParser::parseFile(const std::string& filepath, OvrJobSystem* jobSystem) {
+		OvrMappedFile file{ filepath };
+		return parse(file.data(), file.size(), jobSystem);
+	}
+
+	OvrObjData OvrObjParser::parse(const char* text, size_t size, OvrJobSystem* jobSystem) {
+		size_t chunkCount = 1;
+		if (jobSystem != nullptr) {
+			chunkCount = std::min<size_t>(
+				jobSystem->getThreadCount() * CHUNKS_PER_THREAD,
+				std::max<size_t>(1, size / MIN_CHUNK_BYTES));
+		}
+
+		// chunk i is [starts[i], starts[i + 1]), every start but the first right after a '\n'
+		const char* end = text + size;
+		std::vector<const char*> starts(chunkCount + 1);
+		starts[0] = text;
+		starts[chunkCount] = end;
+		for (size_t i = 1; i < chunkCount; i++) {
+			const char* target = std::max(text + size / chunkCount * i, starts[i - 1]);
+			const char* newline = static_cast<const char*>(std::memchr(target, '\n', end - target));
+			starts[i] = newline != nullptr ? newline + 1 : end;
+		}
+
+		std::vector<OvrObjChunk> chunks(chunkCount);
+		auto parseRange = [&](uint32_t begin, uint32_t last) {
+			for (uint32_t i = begin; i < last; i++) {
+				parseChunk(starts[i], starts[i + 1], chunks[i]);
+			}
+		};
+		if (jobSystem != nullptr) {
+			jobSystem->parallelFor(static_cast<uint32_t>(chunkCount), 1, parseRange);
+		}
+		else {
+			parseRange(0, static_cast<uint32_t>(chunkCount));
+		}
+		return mergeChunks(chunks, jobSystem);
+	}
+}
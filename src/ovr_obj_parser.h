@@ -0,0 +1,45 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ovr {
+	class OvrJobSystem;
+
+	// OBJ geometry the way tinyobj::LoadObj returns it, with the indices of all shapes concatenated
+	// in file order (the order OvrModel::Builder walks them in)
+	struct OvrObjData {
+		struct Corner {
+			int32_t position = -1; // zero based, -1 when the face doesn't reference one
+			int32_t texcoord = -1;
+			int32_t normal = -1;
+		};
+
+		std::vector<float> positions; // xyz per v line
+		std::vector<float> colors;    // rgb per v line, 1 when the line has none
+		std::vector<float> normals;   // xyz per vn line
+		std::vector<float> texcoords; // uv per vt line
+		std::vector<Corner> corners;  // 3 per triangle, polygons are fan triangulated
+	};
+
+	// Native OBJ parser, a drop in for the tinyobj::LoadObj call the models used to make.
+	// The file is mapped and split into line aligned chunks that are parsed as jobs, each into its own
+	// arrays, then the arrays are stitched together and relative (negative) indices rebased.
+	// Numbers are parsed with tinyobj's own arithmetic so the results are identical to the bit.
+	// Materials, groups, lines, points and tags are skipped, they don't change the triangles.
+	class OvrObjParser {
+	public:
+		// throws if the file can't be read or a face references a vertex that doesn't exist
+		static OvrObjData parseFile(const std::string& filepath, OvrJobSystem* jobSystem = nullptr);
+		// one chunk per job, on the calling thread alone without a job system
+		static OvrObjData parse(const char* text, size_t size, OvrJobSystem* jobSystem = nullptr);
+	};
+}
@@ -0,0 +1,82 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_device.h"
+#include "ovr_swap_chain.h"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+// Render target used instead of OVRSwapChain when there is no window to present to.
+// Owns one color + depth image pair per frame in flight, the render pass and framebuffers.
+class OvrOffscreenTarget {
+ public:
+  static constexpr int MAX_FRAMES_IN_FLIGHT = OVRSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+  OvrOffscreenTarget(OVRDevice &deviceRef, VkExtent2D extent);
+  ~OvrOffscreenTarget();
+
+  OvrOffscreenTarget(const OvrOffscreenTarget &) = delete;
+  void operator=(const OvrOffscreenTarget &) = delete;
+
+  VkFramebuffer getFrameBuffer(int index) { return framebuffers[index]; }
+  VkRenderPass getRenderPass() { return renderPass; }
+  VkImageView getImageView(int index) { return colorImageViews[index]; }
+  size_t imageCount() { return colorImages.size(); }
+  VkFormat getColorFormat() { return colorFormat; }
+  VkExtent2D getExtent() { return extent; }
+  uint32_t width() { return extent.width; }
+  uint32_t height() { return extent.height; }
+
+  float extentAspectRatio() {
+    return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+  }
+  VkFormat findDepthFormat();
+
+  // same contract as OVRSwapChain, minus the semaphores and the present
+  VkResult acquireNextImage(uint32_t *imageIndex);
+  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+
+  // waits for the frame that rendered imageIndex and copies its color image
+  // into tightly packed RGBA8 rows (width * height * 4 bytes)
+  std::vector<uint8_t> readPixels(uint32_t imageIndex);
+
+ private:
+  void createColorResources();
+  void createDepthResources();
+  void createRenderPass();
+  void createFramebuffers();
+  void createSyncObjects();
+
+  VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  VkFormat depthFormat;
+  VkExtent2D extent;
+
+  VkRenderPass renderPass;
+  std::vector<VkFramebuffer> framebuffers;
+
+  std::vector<VkImage> colorImages;
+  std::vector<OvrAllocation> colorImageAllocations;
+  std::vector<VkImageView> colorImageViews;
+  std::vector<VkImage> depthImages;
+  std::vector<OvrAllocation> depthImageAllocations;
+  std::vector<VkImageView> depthImageViews;
+
+  OVRDevice &device;
+
+  std::vector<VkFence> inFlightFences;
+  size_t currentFrame = 0;
+};
+
+}  // namespace ovr
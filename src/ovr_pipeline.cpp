@@ -18,7 +18,7 @@
 
 //std
 #include <cassert>
-#include <fstream>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
 
@@ -36,34 +36,9 @@ namespace ovr {
 
 	OvrPipeline::~OvrPipeline()
 	{
-		vkDestroyShaderModule(ovrDevice.device(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(ovrDevice.device(), fragShaderModule, nullptr);
 		vkDestroyPipeline(ovrDevice.device(), graphicsPipeline, nullptr);
 	}
 
-	std::vector<char> OvrPipeline::readFile(const std::string& filepath) {               
-		std::ifstream file(filepath, 
-			std::ios::ate | std::ios::binary); //place cursor at end of file & read as binary file
-
-		if (!file.is_open())
-		{
-			throw std::runtime_error("failed to open file: " + filepath);
-		}
-
-		//get size of the file
-		size_t fileSize = static_cast<size_t>(
-			file.tellg() //get last position, wich is file size
-			);
-		std::vector<char> buffer(fileSize); //init buffer
-
-		file.seekg(0); //put cursor to the start of file
-		file.read(buffer.data(), fileSize); // write file to buffer
-
-		file.close();
-		return buffer;
-
-	}
-
 	void OvrPipeline::createGraphicsPipeline(
 
 		const std::string& vertFilepath, 
@@ -74,16 +49,15 @@ namespace ovr {
 		assert(configInfo.renderPass != VK_NULL_HANDLE &&
 			"Cannot create graphics pipline: no renderpath provided int configInfo");
 
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
-
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		vertShaderModule = ovrDevice.shaderCache().acquire(vertFilepath);
+		if (!fragFilepath.empty()) {
+			fragShaderModule = ovrDevice.shaderCache().acquire(fragFilepath);
+		}
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].module = vertShaderModule->module();
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
 		shaderStages[0].pNext = nullptr;
@@ -91,14 +65,14 @@ namespace ovr {
 
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].module = fragShaderModule ? fragShaderModule->module() : VK_NULL_HANDLE;
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = OvrModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = OvrModel::Vertex::getAttributeDescriptions();
+		auto& bindingDescriptions = configInfo.bindingDescriptions;
+		auto& attributeDescriptions = configInfo.attributeDescriptions;
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -109,7 +83,7 @@ namespace ovr {
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
+		pipelineInfo.stageCount = fragShaderModule ? 2 : 1; // depth only passes need no fragment shader
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
 		pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -129,7 +103,8 @@ namespace ovr {
 		pipelineInfo.basePipelineIndex = -1;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(ovrDevice.device(), VK_NULL_HANDLE,
+		auto createStart = std::chrono::high_resolution_clock::now();
+		if (vkCreateGraphicsPipelines(ovrDevice.device(), ovrDevice.pipelineCache(),
 			1,
 			&pipelineInfo,
 			nullptr,
@@ -137,18 +112,9 @@ namespace ovr {
 		{
 			throw std::runtime_error("failed to create graphics pipeline");
 		}
-	}
-
-	void OvrPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
-	{
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-		if (vkCreateShaderModule(ovrDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create shader module");
-		}
+		ovrDevice.recordPipelineCreation(static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::high_resolution_clock::now() - createStart).count()));
 	}
 
 	void OvrPipeline::bind(VkCommandBuffer commandBuffer)
@@ -231,6 +197,9 @@ namespace ovr {
 		configInfo.dynamicStateInfo.dynamicStateCount =
 			static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 		configInfo.dynamicStateInfo.flags = 0;
+
+		configInfo.bindingDescriptions = OvrModel::Vertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = OvrModel::Vertex::getAttributeDescriptions();
 	}
 
 }
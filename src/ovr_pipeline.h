@@ -8,6 +8,7 @@
 
 #include "ovr_device.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 namespace ovr {
@@ -17,6 +18,9 @@ namespace ovr {
 		PipelineConfigInfo() = default;
 		PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+		// per-vertex layout by default, render systems append their own bindings (e.g. per-instance data)
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 		VkPipelineViewportStateCreateInfo viewportInfo;
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 		VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -35,6 +39,7 @@ namespace ovr {
 
 	class OvrPipeline {
 	public:
+		// an empty fragFilepath creates a pipeline without fragment stage, for depth only passes
 		OvrPipeline(
 			OVRDevice &device,
 			const std::string& vertFilepath, 
@@ -51,21 +56,17 @@ namespace ovr {
 			PipelineConfigInfo& configInfo);
 
 	private:
-		static std::vector<char> readFile(const std::string& filepath);
-
 		void createGraphicsPipeline(
 			const std::string& vertFilepath,
 			const std::string& fragFilepath,
 			const PipelineConfigInfo& configInfo);
 
 
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
-
-
 		OVRDevice& ovrDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		// borrowed from the device shader cache
+		std::shared_ptr<const OvrShaderModule> vertShaderModule;
+		std::shared_ptr<const OvrShaderModule> fragShaderModule;
 	};
 
 }
@@ -0,0 +1,78 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_pipeline_builder.h"
+
+namespace ovr {
+	OvrPipelineBuilder::OvrPipelineBuilder(OVRDevice& device, uint32_t threadCount) : ovrDevice{ device } {
+		if (threadCount == 0) {
+			uint32_t hardwareThreads = std::thread::hardware_concurrency(); // may report 0
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		for (uint32_t i = 0; i < threadCount; i++) {
+			workers.emplace_back(&OvrPipelineBuilder::workerLoop, this);
+		}
+	}
+
+	OvrPipelineBuilder::~OvrPipelineBuilder() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	OvrPipelineHandle OvrPipelineBuilder::requestPipeline(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		std::unique_ptr<PipelineConfigInfo> configInfo) {
+		// vkCreateGraphicsPipelines and the device pipeline cache are safe to use from any thread
+		auto config = std::shared_ptr<PipelineConfigInfo>(std::move(configInfo));
+		auto task = std::make_shared<std::packaged_task<std::shared_ptr<OvrPipeline>()>>(
+			[this, vertFilepath, fragFilepath, config]() {
+				return std::make_shared<OvrPipeline>(ovrDevice, vertFilepath, fragFilepath, *config);
+			});
+		OvrPipelineHandle handle{ task->get_future().share() };
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobAvailable.notify_one();
+		return handle;
+	}
+
+	void OvrPipelineBuilder::waitIdle() {
+		std::unique_lock<std::mutex> lock{ mutex };
+		jobsDone.wait(lock, [this]() { return jobs.empty() && runningJobs == 0; });
+	}
+
+	void OvrPipelineBuilder::workerLoop() {
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (true) {
+			jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty()) {
+				return; // stopping and drained
+			}
+
+			auto job = std::move(jobs.front());
+			jobs.pop_front();
+			runningJobs++;
+
+			lock.unlock();
+			job(); // exceptions end up in the future
+			lock.lock();
+
+			runningJobs--;
+			if (jobs.empty() && runningJobs == 0) {
+				jobsDone.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,75 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_pipeline.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ovr {
+
+	// Pipeline that may still be compiling on a OvrPipelineBuilder worker
+	class OvrPipelineHandle {
+	public:
+		OvrPipelineHandle() = default;
+		explicit OvrPipelineHandle(std::shared_future<std::shared_ptr<OvrPipeline>> future)
+			: future{ std::move(future) } {}
+
+		bool valid() const { return future.valid(); }
+		bool isReady() const {
+			return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+		// blocks until compiled, rethrows the creation error if it failed
+		OvrPipeline& get() const { return *future.get(); }
+
+	private:
+		std::shared_future<std::shared_ptr<OvrPipeline>> future;
+	};
+
+	// Compiles pipelines concurrently on a small pool of worker threads.
+	// Must outlive every pipeline request still in flight.
+	class OvrPipelineBuilder {
+	public:
+		// 0 threads picks hardware_concurrency - 1
+		OvrPipelineBuilder(OVRDevice& device, uint32_t threadCount = 0);
+		~OvrPipelineBuilder(); // finishes every queued request before returning
+
+		OvrPipelineBuilder(const OvrPipelineBuilder&) = delete;
+		OvrPipelineBuilder& operator=(const OvrPipelineBuilder&) = delete;
+
+		// configInfo is heap allocated because it points into itself
+		// (colorBlendInfo.pAttachments, dynamicStateInfo.pDynamicStates)
+		OvrPipelineHandle requestPipeline(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			std::unique_ptr<PipelineConfigInfo> configInfo);
+
+		void waitIdle();
+
+	private:
+		void workerLoop();
+
+		OVRDevice& ovrDevice;
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable jobAvailable;
+		std::condition_variable jobsDone;
+		uint32_t runningJobs = 0;
+		bool stopping = false;
+	};
+}
@@ -15,19 +15,36 @@
 namespace ovr {
 
 	OvrRenderer::OvrRenderer(AppWindow& window, OVRDevice& device) : 
-		appWindow{ window }, ovrDevice{ device } {
+		appWindow{ &window }, ovrDevice{ device } {
 		recreateSwapChain();
 		createCommandBuffers();
 	}
 
+	OvrRenderer::OvrRenderer(OVRDevice& device, VkExtent2D extent) :
+		ovrDevice{ device } {
+		ovrOffscreenTarget = std::make_unique<OvrOffscreenTarget>(ovrDevice, extent);
+		createCommandBuffers();
+	}
+
 	OvrRenderer::~OvrRenderer() {
+		vkDeviceWaitIdle(ovrDevice.device()); // frames may still be in flight
+		commandRecorder = nullptr;
 		freeCommandBuffers();
 	}
 
+	void OvrRenderer::setRecordingJobSystem(OvrJobSystem* jobSystem) {
+		assert(!isFrameStarted && "Can't change the recording job system while frame is in progress");
+		vkDeviceWaitIdle(ovrDevice.device()); // the old pools may still hold buffers in flight
+		commandRecorder = nullptr;
+		if (jobSystem != nullptr) {
+			commandRecorder = std::make_unique<OvrCommandRecorder>(ovrDevice, *jobSystem);
+		}
+	}
+
 	void OvrRenderer::recreateSwapChain() {
-		auto extent = appWindow.getExtent();
+		auto extent = appWindow->getExtent();
 		while (extent.width == 0 || extent.height == 0) {
-			extent = appWindow.getExtent();
+			extent = appWindow->getExtent();
 			glfwWaitEvents();
 		}
 
@@ -77,11 +94,22 @@ namespace ovr {
 	}
 
 
+	VkExtent2D OvrRenderer::getRenderExtent() const {
+		return isHeadless() ? ovrOffscreenTarget->getExtent() : ovrSwapChain->getSwapChainExtent();
+	}
+
+	VkFramebuffer OvrRenderer::getCurrentFrameBuffer() const {
+		return isHeadless() ? ovrOffscreenTarget->getFrameBuffer(currentImageIndex)
+			: ovrSwapChain->getFrameBuffer(currentImageIndex);
+	}
+
 	VkCommandBuffer OvrRenderer::beginFrame()
 	{
 		assert(!isFrameStarted && "Can't call beginFrame while already in progress");
-		
-		auto result = ovrSwapChain->acquireNextImage(&currentImageIndex);
+		ovrDevice.collectUploads();
+
+		auto result = isHeadless() ? ovrOffscreenTarget->acquireNextImage(&currentImageIndex)
+			: ovrSwapChain->acquireNextImage(&currentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			recreateSwapChain();
@@ -95,6 +123,9 @@ namespace ovr {
 
 		isFrameStarted = true;
 		auto commandBuffer = getCurrentCommandBuffer();
+		if (commandRecorder) {
+			commandRecorder->beginFrame(currentFrameIndex); // acquireNextImage waited on this frame's fence
+		}
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -113,10 +144,17 @@ namespace ovr {
 			throw std::runtime_error("failed to record command buffer!");
 		}
 
+		if (isHeadless()) {
+			ovrOffscreenTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+			isFrameStarted = false;
+			currentFrameIndex = (currentFrameIndex + 1) % OVRSwapChain::MAX_FRAMES_IN_FLIGHT;
+			return;
+		}
+
 		auto result = ovrSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-			appWindow.wasWindowResized()) {
-			appWindow.resetWindowResizedFlag();
+			appWindow->wasWindowResized()) {
+			appWindow->resetWindowResizedFlag();
 			recreateSwapChain();
 		}
 		else if (result != VK_SUCCESS) {
@@ -144,11 +182,11 @@ namespace ovr {
 
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = ovrSwapChain->getRenderPass();
-		renderPassInfo.framebuffer = ovrSwapChain->getFrameBuffer(currentImageIndex);
+		renderPassInfo.renderPass = getSwapChainRenderPass();
+		renderPassInfo.framebuffer = getCurrentFrameBuffer();
 
 		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = ovrSwapChain->getSwapChainExtent();
+		renderPassInfo.renderArea.extent = getRenderExtent();
 
 		std::array<VkClearValue, 2> clearValues{};
 		clearValues[0].color = { 0.1f, 0.3f, 0.1f, 1.0f };
@@ -157,16 +195,22 @@ namespace ovr {
 
 		renderPassInfo.pClearValues = clearValues.data();
 
+		if (commandRecorder) {
+			// secondaries don't inherit dynamic state, the recorder sets viewport and scissor in each of them
+			commandRecorder->beginRenderPass(renderPassInfo.renderPass, renderPassInfo.framebuffer, getRenderExtent());
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			return;
+		}
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(ovrSwapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(ovrSwapChain->getSwapChainExtent().height);
+		viewport.width = static_cast<float>(getRenderExtent().width);
+		viewport.height = static_cast<float>(getRenderExtent().height);
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0, 0}, ovrSwapChain->getSwapChainExtent() };
+		VkRect2D scissor{ {0, 0}, getRenderExtent() };
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
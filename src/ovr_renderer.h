@@ -11,6 +11,8 @@
 #include "AppWindow.h"
 #include "ovr_device.h"
 #include "ovr_swap_chain.h"
+#include "ovr_offscreen_target.h"
+#include "ovr_command_recorder.h"
 
 #include <memory>
 #include <vector>
@@ -23,21 +25,40 @@ namespace ovr {
 	public:
 
 		OvrRenderer(AppWindow& window, OVRDevice &device);
+		// headless renderer: draws into an OvrOffscreenTarget of the given size, nothing is presented
+		OvrRenderer(OVRDevice &device, VkExtent2D extent);
 		~OvrRenderer();
 
 		// c++11 Disallow copying (compiler will not generate those constructors)
 		OvrRenderer(const OvrRenderer&) = delete;
 		OvrRenderer& operator=(const OvrRenderer&) = delete;
 
-		VkRenderPass getSwapChainRenderPass() const { return ovrSwapChain->getRenderPass(); }
-		float getAspectRatio() const { return ovrSwapChain->extentAspectRatio(); }
+		VkRenderPass getSwapChainRenderPass() const {
+			return isHeadless() ? ovrOffscreenTarget->getRenderPass() : ovrSwapChain->getRenderPass();
+		}
+		float getAspectRatio() const {
+			return isHeadless() ? ovrOffscreenTarget->extentAspectRatio() : ovrSwapChain->extentAspectRatio();
+		}
+		// of the swapchain or the offscreen target
+		VkExtent2D getRenderExtent() const;
 		bool isFrameInProgress() const { return isFrameStarted; }
+		bool isHeadless() const { return appWindow == nullptr; }
+		OvrOffscreenTarget* getOffscreenTarget() const { return ovrOffscreenTarget.get(); }
+		uint32_t getCurrentImageIndex() const { return currentImageIndex; }
 
 		VkCommandBuffer getCurrentCommandBuffer() const {
 			assert(isFrameStarted && "Cannot get command buffer when fram not in progress");
 			return commandBuffers[currentFrameIndex];
 		}
 
+		// nullptr records the render pass inline on the calling thread (the default), otherwise the render
+		// pass contents are recorded into secondary command buffers as jobs on jobSystem, which must
+		// outlive the renderer or the next call. Waits for the device to go idle, must not be called
+		// while a frame is in progress.
+		void setRecordingJobSystem(OvrJobSystem* jobSystem);
+		// nullptr when recording inline
+		OvrCommandRecorder* getCommandRecorder() const { return commandRecorder.get(); }
+
 		int GetFrameIndex() const {
 			assert(isFrameStarted && "Cannot get frame index when frame not in progress");
 			return currentFrameIndex;
@@ -45,6 +66,8 @@ namespace ovr {
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
+		// with a command recorder the pass begins with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, everything
+		// drawn in it must then go through getCommandRecorder() and end up in vkCmdExecuteCommands
 		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
@@ -53,14 +76,17 @@ namespace ovr {
 		void createCommandBuffers();
 		void freeCommandBuffers();
 		void recreateSwapChain();
+		VkFramebuffer getCurrentFrameBuffer() const;
 
 
-		AppWindow& appWindow;
+		AppWindow* appWindow = nullptr;
 		OVRDevice& ovrDevice;
 		std::unique_ptr<OVRSwapChain> ovrSwapChain;
+		std::unique_ptr<OvrOffscreenTarget> ovrOffscreenTarget;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<OvrCommandRecorder> commandRecorder;
 
-		uint32_t currentImageIndex;
+		uint32_t currentImageIndex{ 0 };
 		int currentFrameIndex{ 0 };
 		bool isFrameStarted{false};
 	};
@@ -0,0 +1,167 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_scene.h"
+#include "ovr_job_system.h"
+#include "ovr_transform_batch.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ovr {
+	// dirty entities per transform job, a job costs about as much as a few hundred matrices
+	static constexpr uint32_t TRANSFORM_JOB_SIZE = 4096;
+
+	OvrScene::ModelHandle OvrScene::addModel(std::shared_ptr<OvrModel> model) {
+		assert(model && "cannot add a null model");
+		auto found = std::find(models.begin(), models.end(), model);
+		if (found != models.end()) {
+			return static_cast<ModelHandle>(found - models.begin());
+		}
+		models.push_back(std::move(model));
+		return static_cast<ModelHandle>(models.size() - 1);
+	}
+
+	void OvrScene::reserve(size_t count) {
+		ids.reserve(count);
+		translations.reserve(count);
+		rotations.reserve(count);
+		scales.reserve(count);
+		worldMatrices.reserve(count);
+		normalMatrices.reserve(count);
+		matrixVersions.reserve(count);
+		dirtyFlags.reserve(count);
+		modelHandles.reserve(count);
+		colors.reserve(count);
+	}
+
+	OvrScene::id_t OvrScene::createEntity(ModelHandle model) {
+		assert((model == NO_MODEL || model < models.size()) && "unknown model handle");
+		id_t id = OvrGameObject::nextId();
+		if (id >= sparse.size()) {
+			sparse.resize(static_cast<size_t>(id) + 1, INVALID_INDEX);
+		}
+		uint32_t index = static_cast<uint32_t>(ids.size());
+		sparse[id] = index;
+
+		ids.push_back(id);
+		translations.push_back(glm::vec3{ 0.f });
+		rotations.push_back(glm::vec3{ 0.f });
+		scales.push_back(glm::vec3{ 1.f });
+		worldMatrices.push_back(glm::mat4{ 1.f });
+		normalMatrices.push_back(glm::mat4{ 1.f });
+		matrixVersions.push_back(0);
+		dirtyFlags.push_back(0);
+		modelHandles.push_back(model);
+		colors.push_back(glm::vec3{ 0.f });
+		markDirty(index); // the matrices are already right, but systems syncing on versions must see it
+		return id;
+	}
+
+	void OvrScene::destroyEntity(id_t id) {
+		uint32_t index = indexOf(id);
+		assert(index != INVALID_INDEX && "entity is not in this scene");
+		uint32_t last = static_cast<uint32_t>(ids.size() - 1);
+		if (index != last) {
+			bool listed = dirtyFlags[index] != 0; // the slot already has an entry in dirtyIndices
+			ids[index] = ids[last];
+			translations[index] = translations[last];
+			rotations[index] = rotations[last];
+			scales[index] = scales[last];
+			worldMatrices[index] = worldMatrices[last];
+			normalMatrices[index] = normalMatrices[last];
+			modelHandles[index] = modelHandles[last];
+			colors[index] = colors[last];
+			sparse[ids[index]] = index;
+			// the moved entity changes index, systems keyed on indices have to notice
+			dirtyFlags[index] = 1;
+			if (!listed) {
+				dirtyIndices.push_back(index);
+			}
+		}
+		ids.pop_back();
+		translations.pop_back();
+		rotations.pop_back();
+		scales.pop_back();
+		worldMatrices.pop_back();
+		normalMatrices.pop_back();
+		matrixVersions.pop_back();
+		dirtyFlags.pop_back();
+		modelHandles.pop_back();
+		colors.pop_back();
+		sparse[id] = INVALID_INDEX;
+	}
+
+	void OvrScene::markDirty(uint32_t index) {
+		if (!dirtyFlags[index]) {
+			dirtyFlags[index] = 1;
+			dirtyIndices.push_back(index);
+		}
+	}
+
+	void OvrScene::setTranslation(uint32_t index, const glm::vec3& translation) {
+		if (translations[index] != translation) {
+			translations[index] = translation;
+			markDirty(index);
+		}
+	}
+
+	void OvrScene::setRotation(uint32_t index, const glm::vec3& rotation) {
+		if (rotations[index] != rotation) {
+			rotations[index] = rotation;
+			markDirty(index);
+		}
+	}
+
+	void OvrScene::setScale(uint32_t index, const glm::vec3& scale) {
+		if (scales[index] != scale) {
+			scales[index] = scale;
+			markDirty(index);
+		}
+	}
+
+	void OvrScene::updateWorldMatrices(OvrJobSystem* jobSystem) {
+		lastUpdatedCount = 0;
+		if (dirtyIndices.empty()) {
+			return;
+		}
+		matrixVersion++;
+
+		// drop stale and repeated entries, then recompute the rest in one batch
+		const uint32_t count = static_cast<uint32_t>(ids.size());
+		updateIndices.clear();
+		for (uint32_t index : dirtyIndices) {
+			if (index < count && dirtyFlags[index]) {
+				dirtyFlags[index] = 0;
+				matrixVersions[index] = matrixVersion;
+				updateIndices.push_back(index);
+			}
+		}
+		dirtyIndices.clear();
+
+		OvrTransformBatch batch{};
+		batch.translations = translations.data();
+		batch.rotations = rotations.data();
+		batch.scales = scales.data();
+		batch.indices = updateIndices.data();
+		batch.count = updateIndices.size();
+		batch.worldMatrices = worldMatrices.data();
+		batch.normalMatrices = normalMatrices.data();
+		if (jobSystem == nullptr || batch.count <= TRANSFORM_JOB_SIZE) {
+			computeTransforms(batch);
+		}
+		else {
+			// the outputs are indexed through updateIndices, so each range writes its own entries
+			jobSystem->parallelFor(static_cast<uint32_t>(batch.count), TRANSFORM_JOB_SIZE, [&](uint32_t begin, uint32_t end) {
+				OvrTransformBatch range = batch;
+				range.indices = updateIndices.data() + begin;
+				range.count = end - begin;
+				computeTransforms(range);
+			});
+		}
+		lastUpdatedCount = static_cast<uint32_t>(updateIndices.size());
+	}
+}
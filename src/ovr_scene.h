@@ -0,0 +1,108 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_game_object.h"
+#include "ovr_model.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace ovr {
+	class OvrJobSystem;
+
+	// Entity/component store. Every component lives in its own dense array and index i is the same
+	// entity in all of them, so a system walking transforms only touches transform memory.
+	// Entity ids come from OvrGameObject::nextId and never change; destroying an entity moves the
+	// last one into its slot, so dense indices do. Models are referenced through small handles
+	// instead of shared_ptrs, the scene keeps them alive.
+	//
+	// World and normal matrices are cached. Transform setters mark the entity dirty (only when the
+	// value actually changes) and updateWorldMatrices recomputes just the dirty entries, so a static
+	// scene costs no trig per frame.
+	class OvrScene {
+	public:
+		using id_t = OvrGameObject::id_t;
+		using ModelHandle = uint32_t;
+		static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+		static constexpr ModelHandle NO_MODEL = std::numeric_limits<ModelHandle>::max();
+
+		OvrScene() = default;
+		OvrScene(const OvrScene&) = delete;
+		OvrScene& operator=(const OvrScene&) = delete;
+
+		// adding the same model twice returns the same handle
+		ModelHandle addModel(std::shared_ptr<OvrModel> model);
+		OvrModel* getModel(ModelHandle handle) const { return models[handle].get(); }
+		size_t modelCount() const { return models.size(); }
+
+		id_t createEntity(ModelHandle model = NO_MODEL);
+		void destroyEntity(id_t id);
+		bool contains(id_t id) const { return indexOf(id) != INVALID_INDEX; }
+		// dense index of id, INVALID_INDEX when it isn't in this scene
+		uint32_t indexOf(id_t id) const {
+			return id < sparse.size() ? sparse[id] : INVALID_INDEX;
+		}
+		size_t size() const { return ids.size(); }
+		void reserve(size_t count);
+
+		void setTranslation(uint32_t index, const glm::vec3& translation);
+		void setRotation(uint32_t index, const glm::vec3& rotation); // Tait-Bryan YXZ, see TransformComponent::mat4
+		void setScale(uint32_t index, const glm::vec3& scale);
+		void setModel(uint32_t index, ModelHandle model) { modelHandles[index] = model; }
+		void setColor(uint32_t index, const glm::vec3& color) { colors[index] = color; }
+
+		// recomputes the world and normal matrices of the entities changed since the last call,
+		// in one computeTransforms batch, or split over jobSystem when there are enough of them
+		void updateWorldMatrices(OvrJobSystem* jobSystem = nullptr);
+		// entities recomputed by the last updateWorldMatrices
+		uint32_t getLastUpdatedCount() const { return lastUpdatedCount; }
+		// bumped by every updateWorldMatrices that recomputed something. getMatrixVersions()[i] is the
+		// version entity i's matrices were last recomputed at, so a system that remembers the version it
+		// last synced to can find what moved without comparing transforms
+		uint32_t getMatrixVersion() const { return matrixVersion; }
+
+		// dense component arrays, read only; only createEntity/destroyEntity change their length
+		const std::vector<id_t>& getIds() const { return ids; }
+		const std::vector<glm::vec3>& getTranslations() const { return translations; }
+		const std::vector<glm::vec3>& getRotations() const { return rotations; }
+		const std::vector<glm::vec3>& getScales() const { return scales; }
+		const std::vector<glm::mat4>& getWorldMatrices() const { return worldMatrices; }
+		const std::vector<glm::mat4>& getNormalMatrices() const { return normalMatrices; } // mat3 padded for the GPU
+		const std::vector<uint32_t>& getMatrixVersions() const { return matrixVersions; }
+		const std::vector<ModelHandle>& getModelHandles() const { return modelHandles; }
+		const std::vector<glm::vec3>& getColors() const { return colors; }
+
+	private:
+		void markDirty(uint32_t index);
+
+		std::vector<id_t> ids;
+		std::vector<glm::vec3> translations;
+		std::vector<glm::vec3> rotations;
+		std::vector<glm::vec3> scales;
+		std::vector<glm::mat4> worldMatrices;
+		std::vector<glm::mat4> normalMatrices;
+		std::vector<uint32_t> matrixVersions;
+		std::vector<uint8_t> dirtyFlags;
+		std::vector<ModelHandle> modelHandles;
+		std::vector<glm::vec3> colors;
+
+		std::vector<uint32_t> dirtyIndices; // may hold stale or repeated entries, dirtyFlags decides
+		std::vector<uint32_t> updateIndices; // dirtyIndices filtered, reused between updates
+		uint32_t matrixVersion = 0;
+		uint32_t lastUpdatedCount = 0;
+
+		std::vector<std::shared_ptr<OvrModel>> models;
+		std::vector<uint32_t> sparse; // entity id -> dense index
+	};
+}
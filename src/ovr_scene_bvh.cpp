@@ -0,0 +1,95 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_scene_bvh.h"
+
+namespace ovr {
+	OvrAabb OvrSceneBvh::worldBox(const OvrScene& scene, uint32_t index) {
+		const auto& bounds = scene.getModel(scene.getModelHandles()[index])->getBounds();
+		return OvrAabb::transform(OvrAabb{ bounds.min, bounds.max }, scene.getWorldMatrices()[index]);
+	}
+
+	void OvrSceneBvh::rebuild(const OvrScene& scene) {
+		const uint32_t count = static_cast<uint32_t>(scene.size());
+		tracked.resize(count);
+		objectItems.assign(count, OvrBvh::INVALID_ITEM);
+		itemObjects.clear();
+		boxes.clear();
+		const auto& ids = scene.getIds();
+		const auto& modelHandles = scene.getModelHandles();
+		for (uint32_t i = 0; i < count; i++) {
+			tracked[i] = { ids[i], modelHandles[i] };
+			if (modelHandles[i] != OvrScene::NO_MODEL) {
+				objectItems[i] = static_cast<uint32_t>(itemObjects.size());
+				itemObjects.push_back(i);
+				boxes.push_back(worldBox(scene, i));
+			}
+		}
+		bvh.build(boxes);
+		syncedVersion = scene.getMatrixVersion();
+		rebuildCount++;
+	}
+
+	void OvrSceneBvh::update(const OvrScene& scene) {
+		lastUpdatedCount = 0;
+		bool needsRebuild = scene.size() != tracked.size();
+		const auto& ids = scene.getIds();
+		const auto& modelHandles = scene.getModelHandles();
+		const auto& matrixVersions = scene.getMatrixVersions();
+		for (uint32_t i = 0; i < scene.size() && !needsRebuild; i++) {
+			const TrackedEntity& last = tracked[i];
+			if (ids[i] != last.id || modelHandles[i] != last.model) {
+				needsRebuild = true;
+			}
+			else if (last.model != OvrScene::NO_MODEL && matrixVersions[i] > syncedVersion) {
+				bvh.update(objectItems[i], worldBox(scene, i));
+				lastUpdatedCount++;
+			}
+		}
+		syncedVersion = scene.getMatrixVersion();
+
+		if (needsRebuild) {
+			rebuild(scene);
+			lastUpdatedCount = static_cast<uint32_t>(bvh.itemCount());
+			return;
+		}
+		if (lastUpdatedCount > 0) {
+			bvh.refit();
+			if (bvh.getSahCost() > bvh.getBuildSahCost() * REBUILD_SAH_RATIO) {
+				rebuild(scene);
+			}
+		}
+	}
+
+	void OvrSceneBvh::toSceneIndices(std::vector<uint32_t>& items, size_t first) const {
+		for (size_t i = first; i < items.size(); i++) {
+			items[i] = itemObjects[items[i]];
+		}
+	}
+
+	void OvrSceneBvh::queryFrustum(const OvrFrustumPlanes& planes, std::vector<uint32_t>& sceneIndices) const {
+		size_t first = sceneIndices.size();
+		bvh.queryFrustum(planes, sceneIndices);
+		toSceneIndices(sceneIndices, first);
+	}
+
+	void OvrSceneBvh::queryRange(const OvrAabb& range, std::vector<uint32_t>& sceneIndices) const {
+		size_t first = sceneIndices.size();
+		bvh.queryRange(range, sceneIndices);
+		toSceneIndices(sceneIndices, first);
+	}
+
+	void OvrSceneBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& sceneIndices) const {
+		size_t first = sceneIndices.size();
+		bvh.querySphere(center, radius, sceneIndices);
+		toSceneIndices(sceneIndices, first);
+	}
+
+	uint32_t OvrSceneBvh::queryNearest(const glm::vec3& point, float* distance) const {
+		uint32_t item = bvh.queryNearest(point, distance);
+		return item == OvrBvh::INVALID_ITEM ? item : itemObjects[item];
+	}
+}
@@ -0,0 +1,58 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_bvh.h"
+#include "ovr_scene.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	// BVH over the world boxes of the scene entities that have a model, queries return dense scene
+	// indices. update() recomputes the boxes of the entities whose matrix version is newer than the
+	// scene version it last synced to, then refits. Creating or destroying entities, swapping a model,
+	// or the tree degrading too far triggers a full rebuild. Call it after OvrScene::updateWorldMatrices.
+	class OvrSceneBvh {
+	public:
+		void update(const OvrScene& scene);
+
+		void queryFrustum(const OvrFrustumPlanes& planes, std::vector<uint32_t>& sceneIndices) const;
+		void queryRange(const OvrAabb& range, std::vector<uint32_t>& sceneIndices) const;
+		void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& sceneIndices) const;
+		// index of the entity closest to point, OvrBvh::INVALID_ITEM when there is none
+		uint32_t queryNearest(const glm::vec3& point, float* distance = nullptr) const;
+
+		// entities with a model
+		size_t objectCount() const { return bvh.itemCount(); }
+		uint32_t getRebuildCount() const { return rebuildCount; }
+		uint32_t getLastUpdatedCount() const { return lastUpdatedCount; }
+
+	private:
+		struct TrackedEntity {
+			OvrScene::id_t id;
+			OvrScene::ModelHandle model;
+		};
+
+		void rebuild(const OvrScene& scene);
+		static OvrAabb worldBox(const OvrScene& scene, uint32_t index);
+		void toSceneIndices(std::vector<uint32_t>& items, size_t first) const;
+
+		// rebuild once refits have made queries this much more expensive than a fresh tree
+		static constexpr float REBUILD_SAH_RATIO = 1.5f;
+
+		OvrBvh bvh;
+		std::vector<TrackedEntity> tracked;  // per dense scene index
+		std::vector<uint32_t> objectItems;   // per dense scene index, bvh item or INVALID_ITEM without a model
+		std::vector<uint32_t> itemObjects;   // per bvh item, dense scene index
+		std::vector<OvrAabb> boxes;          // per bvh item, only used while rebuilding
+		uint32_t syncedVersion = 0;
+		uint32_t rebuildCount = 0;
+		uint32_t lastUpdatedCount = 0;
+	};
+}
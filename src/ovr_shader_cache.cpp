@@ -0,0 +1,77 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_shader_cache.h"
+#include "ovr_mapped_file.h"
+#include "ovr_utils.h"
+
+// std
+#include <stdexcept>
+
+namespace ovr {
+
+std::shared_ptr<const OvrShaderModule> OvrShaderCache::acquire(const std::string &filepath) {
+  std::error_code error;
+  auto writeTime = std::filesystem::last_write_time(filepath, error);
+  uintmax_t fileSize = error ? 0 : std::filesystem::file_size(filepath, error);
+  if (error) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+
+  // unchanged file whose module is still alive: no read at all
+  auto stamp = stamps.find(filepath);
+  if (stamp != stamps.end() && stamp->second.writeTime == writeTime &&
+      stamp->second.size == fileSize) {
+    if (auto module = modules[{filepath, stamp->second.contentHash}].lock()) {
+      return module;
+    }
+  }
+
+  OvrMappedFile file{filepath};
+  if (file.empty() || file.size() % sizeof(uint32_t) != 0) {
+    throw std::runtime_error("invalid SPIR-V file: " + filepath);
+  }
+  fileLoads++;
+  uint64_t contentHash = hashBytes(file.data(), file.size());
+  stamps[filepath] = {writeTime, fileSize, contentHash};
+
+  auto &entry = modules[{filepath, contentHash}];
+  if (auto module = entry.lock()) {  // touched on disk but the same bytes
+    return module;
+  }
+
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = file.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(file.data());  // mapping is page aligned
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module");
+  }
+
+  auto module = std::make_shared<const OvrShaderModule>(device, shaderModule, filepath, contentHash);
+  entry = module;
+  return module;
+}
+
+size_t OvrShaderCache::liveModuleCount() {
+  std::lock_guard<std::mutex> lock{mutex};
+  size_t count = 0;
+  for (auto it = modules.begin(); it != modules.end();) {
+    if (it->second.expired()) {
+      it = modules.erase(it);
+    } else {
+      count++;
+      ++it;
+    }
+  }
+  return count;
+}
+
+}  // namespace ovr
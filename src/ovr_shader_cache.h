@@ -0,0 +1,76 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace ovr {
+
+// VkShaderModule shared by every pipeline that uses the same SPIR-V file,
+// destroyed when the last pipeline borrowing it goes away
+class OvrShaderModule {
+ public:
+  OvrShaderModule(VkDevice device, VkShaderModule module, std::string path, uint64_t contentHash)
+      : device{device}, module_{module}, path_{std::move(path)}, contentHash_{contentHash} {}
+  ~OvrShaderModule() { vkDestroyShaderModule(device, module_, nullptr); }
+
+  OvrShaderModule(const OvrShaderModule &) = delete;
+  OvrShaderModule &operator=(const OvrShaderModule &) = delete;
+
+  VkShaderModule module() const { return module_; }
+  const std::string &path() const { return path_; }
+  uint64_t contentHash() const { return contentHash_; }
+
+ private:
+  VkDevice device;
+  VkShaderModule module_;
+  std::string path_;
+  uint64_t contentHash_;
+};
+
+// Device level cache of shader modules keyed by path and SPIR-V content hash.
+// Files are memory mapped and only re-read when their size or write time changes.
+// Safe to use from the pipeline builder threads.
+class OvrShaderCache {
+ public:
+  OvrShaderCache(VkDevice device) : device{device} {}
+
+  OvrShaderCache(const OvrShaderCache &) = delete;
+  OvrShaderCache &operator=(const OvrShaderCache &) = delete;
+
+  std::shared_ptr<const OvrShaderModule> acquire(const std::string &filepath);
+
+  size_t liveModuleCount();
+  uint64_t getFileLoadCount() const { return fileLoads; }
+
+ private:
+  struct FileStamp {
+    std::filesystem::file_time_type writeTime;
+    uintmax_t size;
+    uint64_t contentHash;
+  };
+  using ModuleKey = std::pair<std::string, uint64_t>;
+
+  VkDevice device;
+  std::mutex mutex;
+  std::unordered_map<std::string, FileStamp> stamps;
+  std::map<ModuleKey, std::weak_ptr<const OvrShaderModule>> modules;
+  uint64_t fileLoads = 0;
+};
+
+}  // namespace ovr
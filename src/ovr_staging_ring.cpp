@@ -0,0 +1,153 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_staging_ring.h"
+#include "ovr_device.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace ovr {
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+OvrStagingRing::OvrStagingRing(OVRDevice &device, VkDeviceSize size) : device{device}, size{size} {
+  device.createBuffer(
+      size,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      buffer,
+      allocation);
+}
+
+OvrStagingRing::~OvrStagingRing() {
+  // the owner waits for the device to go idle first, so every fence has signaled
+  for (auto &pending : pendingDedicated) {
+    device.destroyBuffer(pending.buffer, pending.allocation);
+  }
+  device.destroyBuffer(buffer, allocation);
+}
+
+bool OvrStagingRing::tryAllocate(
+    VkDeviceSize requestSize, VkDeviceSize alignment, VkDeviceSize &offset) {
+  if (inFlight.empty()) {
+    head = 0;  // nothing outstanding, start over at the beginning
+  }
+
+  offset = alignUp(head, alignment);
+  if (inFlight.empty()) {
+    return offset + requestSize <= size;
+  }
+
+  VkDeviceSize tail = inFlight.front().begin;
+  if (head >= tail) {
+    // free space is [head, size) followed by [0, tail)
+    if (offset + requestSize <= size) {
+      return true;
+    }
+    offset = 0;
+    return requestSize < tail;  // strict, head == tail is reserved for "empty"
+  }
+  // wrapped around, free space is [head, tail)
+  return offset + requestSize < tail;
+}
+
+OvrStagingRegion OvrStagingRing::allocate(VkDeviceSize requestSize, VkDeviceSize alignment) {
+  assert(requestSize > 0 && "Cannot stage an empty upload");
+  retire();
+
+  if (requestSize > size / 2) {
+    return allocateDedicated(requestSize);
+  }
+
+  VkDeviceSize offset = 0;
+  while (!tryAllocate(requestSize, alignment, offset)) {
+    // wait for the oldest upload to finish, unless it hasn't even been submitted yet
+    auto &oldest = inFlight.front();
+    if (!oldest.submitted) {
+      return allocateDedicated(requestSize);
+    }
+    if (oldest.fence != VK_NULL_HANDLE) {
+      vkWaitForFences(
+          device.device(), 1, &oldest.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+    retire();
+  }
+
+  head = offset + requestSize;
+  inFlight.push_back({nextId, offset, head, VK_NULL_HANDLE, false});
+
+  OvrStagingRegion region{};
+  region.buffer = buffer;
+  region.offset = offset;
+  region.size = requestSize;
+  region.mapped = static_cast<char *>(allocation.mapped) + offset;
+  region.id = nextId++;
+  return region;
+}
+
+OvrStagingRegion OvrStagingRing::allocateDedicated(VkDeviceSize requestSize) {
+  OvrStagingRegion region{};
+  device.createBuffer(
+      requestSize,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      region.buffer,
+      region.allocation,
+      OvrAllocationStrategy::Linear);
+  region.size = requestSize;
+  region.mapped = region.allocation.mapped;
+  region.dedicated = true;
+  dedicatedFallbacks++;
+  return region;
+}
+
+void OvrStagingRing::release(OvrStagingRegion &region, VkFence fence) {
+  if (region.dedicated) {
+    pendingDedicated.push_back({region.buffer, region.allocation, fence});
+  } else {
+    auto it = std::find_if(inFlight.begin(), inFlight.end(), [&region](const InFlightRegion &r) {
+      return r.id == region.id;
+    });
+    assert(it != inFlight.end() && "Staging region released twice");
+    it->fence = fence;
+    it->submitted = true;
+  }
+  region = OvrStagingRegion{};
+  retire();
+}
+
+void OvrStagingRing::retire() {
+  // forget every signaled fence, so the caller may recycle it right after this
+  for (auto &region : inFlight) {
+    if (region.submitted && region.fence != VK_NULL_HANDLE &&
+        vkGetFenceStatus(device.device(), region.fence) == VK_SUCCESS) {
+      region.fence = VK_NULL_HANDLE;
+    }
+  }
+  while (!inFlight.empty() && inFlight.front().submitted &&
+         inFlight.front().fence == VK_NULL_HANDLE) {
+    inFlight.pop_front();
+  }
+
+  for (size_t i = 0; i < pendingDedicated.size();) {
+    auto &pending = pendingDedicated[i];
+    if (pending.fence == VK_NULL_HANDLE ||
+        vkGetFenceStatus(device.device(), pending.fence) == VK_SUCCESS) {
+      device.destroyBuffer(pending.buffer, pending.allocation);
+      pending = pendingDedicated.back();
+      pendingDedicated.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+}  // namespace ovr
@@ -0,0 +1,93 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_memory_allocator.h"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace ovr {
+
+class OVRDevice;
+
+// Host visible range to write upload data into before it's copied on the GPU
+struct OvrStagingRegion {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;  // offset of the region inside buffer, use as copy srcOffset
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+
+ private:
+  friend class OvrStagingRing;
+  uint64_t id = 0;
+  bool dedicated = false;  // payload didn't fit the ring, buffer is owned by the region
+  OvrAllocation allocation{};
+};
+
+// Persistently mapped ring buffer all uploads are staged through. Regions are
+// handed out in order and recycled once the fence of the copy that read them signals.
+class OvrStagingRing {
+ public:
+  static constexpr VkDeviceSize DEFAULT_SIZE = 32ull * 1024 * 1024;
+
+  OvrStagingRing(OVRDevice &device, VkDeviceSize size = DEFAULT_SIZE);
+  ~OvrStagingRing();
+
+  OvrStagingRing(const OvrStagingRing &) = delete;
+  OvrStagingRing &operator=(const OvrStagingRing &) = delete;
+
+  // falls back to a dedicated staging buffer when the payload is too large for the ring
+  // or every region is still waiting for a submission
+  OvrStagingRegion allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+  // hand the region back once the copy reading it has been submitted with fence.
+  // VK_NULL_HANDLE means the copy already completed. The fence must stay alive
+  // until retire() has observed it signaled.
+  void release(OvrStagingRegion &region, VkFence fence);
+
+  // recycles every region whose fence has signaled
+  void retire();
+
+  VkDeviceSize capacity() const { return size; }
+  uint64_t getDedicatedFallbackCount() const { return dedicatedFallbacks; }
+
+ private:
+  struct InFlightRegion {
+    uint64_t id;
+    VkDeviceSize begin;
+    VkDeviceSize end;
+    VkFence fence;
+    bool submitted;
+  };
+  struct PendingDedicated {
+    VkBuffer buffer;
+    OvrAllocation allocation;
+    VkFence fence;
+  };
+
+  bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+  OvrStagingRegion allocateDedicated(VkDeviceSize size);
+
+  OVRDevice &device;
+  VkDeviceSize size;
+  VkBuffer buffer;
+  OvrAllocation allocation;
+
+  VkDeviceSize head = 0;
+  std::deque<InFlightRegion> inFlight;
+  std::vector<PendingDedicated> pendingDedicated;
+  uint64_t nextId = 1;
+  uint64_t dedicatedFallbacks = 0;
+};
+
+}  // namespace ovr
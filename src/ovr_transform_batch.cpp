@@ -0,0 +1,428 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_transform_batch.h"
+#include "ovr_cpu_features.h"
+#include "ovr_game_object.h"
+
+#ifdef OVR_X86
+#include <immintrin.h>
+#endif
+
+namespace ovr {
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "the kernels read glm::vec3 arrays as packed floats");
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "the kernels write glm::mat4 as 16 packed floats");
+
+	OvrTransformKernel bestTransformKernel() {
+		const auto& features = OvrCpuFeatures::get();
+		if (features.avx2 && features.fma) {
+			return OvrTransformKernel::AVX2;
+		}
+		if (features.sse41) {
+			return OvrTransformKernel::SSE41;
+		}
+		return OvrTransformKernel::Scalar;
+	}
+
+	static uint32_t batchIndex(const OvrTransformBatch& batch, size_t i) {
+		return batch.indices ? batch.indices[i] : static_cast<uint32_t>(i);
+	}
+
+	// handles [first, count), the SIMD kernels finish their remainder here
+	static void computeTransformsScalar(const OvrTransformBatch& batch, size_t first) {
+		for (size_t i = first; i < batch.count; i++) {
+			uint32_t index = batchIndex(batch, i);
+			glm::mat4 world;
+			glm::mat3 normal;
+			TransformComponent::makeMatrices(
+				batch.translations[index], batch.rotations[index], batch.scales[index], world, normal);
+			if (batch.worldMatrices) {
+				batch.worldMatrices[index] = world;
+			}
+			if (batch.normalMatrices) {
+				batch.normalMatrices[index] = glm::mat4(normal);
+			}
+			if (batch.mvpMatrices) {
+				batch.mvpMatrices[index] = batch.projectionView * world;
+			}
+		}
+	}
+
+	static void multiplyMatricesScalar(const glm::mat4& lhs, const glm::mat4* rhs, size_t count, glm::mat4* out) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = lhs * rhs[i];
+		}
+	}
+
+#ifdef OVR_X86
+	// sin/cos polynomials and pi/4 range reduction from Cephes (sinf.c), accurate for |x| < 8192
+	static constexpr float FOUR_OVER_PI = 1.27323954473516f;
+	static constexpr float MINUS_DP1 = -0.78515625f;
+	static constexpr float MINUS_DP2 = -2.4187564849853515625e-4f;
+	static constexpr float MINUS_DP3 = -3.77489497744594108e-8f;
+	static constexpr float SIN_P0 = -1.9515295891e-4f;
+	static constexpr float SIN_P1 = 8.3321608736e-3f;
+	static constexpr float SIN_P2 = -1.6666654611e-1f;
+	static constexpr float COS_P0 = 2.443315711809948e-5f;
+	static constexpr float COS_P1 = -1.388731625493765e-3f;
+	static constexpr float COS_P2 = 4.166664568298827e-2f;
+
+	OVR_TARGET_SSE41
+	static void sinCos4(__m128 x, __m128& sinOut, __m128& cosOut) {
+		const __m128 signMask = _mm_set1_ps(-0.f);
+		__m128 sinSign = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		// octant j rounded up to even, the remainder lands in [-pi/4, pi/4]
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+
+		sinSign = _mm_xor_ps(sinSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		__m128 useSinPoly = _mm_castsi128_ps(
+			_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP1)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP2)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP3)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_P2));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(.5f))), _mm_set1_ps(1.f));
+
+		__m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_P2));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		sinOut = _mm_xor_ps(_mm_blendv_ps(cosPoly, sinPoly, useSinPoly), sinSign);
+		cosOut = _mm_xor_ps(_mm_blendv_ps(sinPoly, cosPoly, useSinPoly), cosSign);
+	}
+
+	OVR_TARGET_AVX2_FMA
+	static void sinCos8(__m256 x, __m256& sinOut, __m256& cosOut) {
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+		__m256 sinSign = _mm256_and_ps(x, signMask);
+		x = _mm256_andnot_ps(signMask, x);
+
+		__m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+		j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(j);
+
+		sinSign = _mm256_xor_ps(sinSign,
+			_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+		__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+			_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+		__m256 useSinPoly = _mm256_castsi256_ps(
+			_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(MINUS_DP1), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(MINUS_DP2), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(MINUS_DP3), x);
+		__m256 z = _mm256_mul_ps(x, x);
+
+		__m256 cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(COS_P0), z, _mm256_set1_ps(COS_P1));
+		cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(COS_P2));
+		cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+		cosPoly = _mm256_add_ps(_mm256_fnmadd_ps(z, _mm256_set1_ps(.5f), cosPoly), _mm256_set1_ps(1.f));
+
+		__m256 sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(SIN_P0), z, _mm256_set1_ps(SIN_P1));
+		sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(SIN_P2));
+		sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, z), x, x);
+
+		sinOut = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, useSinPoly), sinSign);
+		cosOut = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, useSinPoly), cosSign);
+	}
+
+	OVR_TARGET_SSE41
+	static void storeMatrices4(glm::mat4* out, const uint32_t* index, __m128* m) {
+		for (int column = 0; column < 4; column++) {
+			__m128 a = m[column * 4 + 0];
+			__m128 b = m[column * 4 + 1];
+			__m128 c = m[column * 4 + 2];
+			__m128 d = m[column * 4 + 3];
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			_mm_storeu_ps(&out[index[0]][column][0], a);
+			_mm_storeu_ps(&out[index[1]][column][0], b);
+			_mm_storeu_ps(&out[index[2]][column][0], c);
+			_mm_storeu_ps(&out[index[3]][column][0], d);
+		}
+	}
+
+	OVR_TARGET_SSE41
+	static __m128 loadComponent4(const glm::vec3* v, const uint32_t* index, int component) {
+		return _mm_setr_ps(v[index[0]][component], v[index[1]][component], v[index[2]][component], v[index[3]][component]);
+	}
+
+	OVR_TARGET_SSE41
+	static void computeTransformsSSE41(const OvrTransformBatch& batch) {
+		const glm::mat4& pv = batch.projectionView;
+		size_t i = 0;
+		for (; i + 4 <= batch.count; i += 4) {
+			uint32_t index[4];
+			for (int lane = 0; lane < 4; lane++) {
+				index[lane] = batchIndex(batch, i + lane);
+			}
+
+			__m128 sines[3], cosines[3], scale[3], translation[3];
+			for (int axis = 0; axis < 3; axis++) {
+				sinCos4(loadComponent4(batch.rotations, index, axis), sines[axis], cosines[axis]);
+				scale[axis] = loadComponent4(batch.scales, index, axis);
+				translation[axis] = loadComponent4(batch.translations, index, axis);
+			}
+			// the rotation of TransformComponent::mat4, r[column * 3 + row]; 1 = y, 2 = x, 3 = z there
+			const __m128 s1 = sines[1], c1 = cosines[1], s2 = sines[0], c2 = cosines[0], s3 = sines[2], c3 = cosines[2];
+			const __m128 s1s2 = _mm_mul_ps(s1, s2);
+			const __m128 c1s2 = _mm_mul_ps(c1, s2);
+			__m128 r[9];
+			r[0] = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+			r[1] = _mm_mul_ps(c2, s3);
+			r[2] = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+			r[3] = _mm_sub_ps(_mm_mul_ps(s1s2, c3), _mm_mul_ps(c1, s3));
+			r[4] = _mm_mul_ps(c2, c3);
+			r[5] = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+			r[6] = _mm_mul_ps(c2, s1);
+			r[7] = _mm_xor_ps(s2, _mm_set1_ps(-0.f));
+			r[8] = _mm_mul_ps(c1, c2);
+
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.f);
+			__m128 world[16];
+			for (int column = 0; column < 3; column++) {
+				for (int row = 0; row < 3; row++) {
+					world[column * 4 + row] = _mm_mul_ps(scale[column], r[column * 3 + row]);
+				}
+				world[column * 4 + 3] = zero;
+			}
+			world[12] = translation[0];
+			world[13] = translation[1];
+			world[14] = translation[2];
+			world[15] = one;
+
+			if (batch.worldMatrices) {
+				storeMatrices4(batch.worldMatrices, index, world);
+			}
+			if (batch.normalMatrices) {
+				__m128 normal[16];
+				for (int column = 0; column < 3; column++) {
+					__m128 inverseScale = _mm_div_ps(one, scale[column]);
+					for (int row = 0; row < 3; row++) {
+						normal[column * 4 + row] = _mm_mul_ps(inverseScale, r[column * 3 + row]);
+					}
+					normal[column * 4 + 3] = zero;
+				}
+				normal[12] = zero;
+				normal[13] = zero;
+				normal[14] = zero;
+				normal[15] = one;
+				storeMatrices4(batch.normalMatrices, index, normal);
+			}
+			if (batch.mvpMatrices) {
+				__m128 mvp[16];
+				for (int column = 0; column < 4; column++) {
+					for (int row = 0; row < 4; row++) {
+						__m128 sum = _mm_mul_ps(_mm_set1_ps(pv[0][row]), world[column * 4 + 0]);
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pv[1][row]), world[column * 4 + 1]));
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pv[2][row]), world[column * 4 + 2]));
+						if (column == 3) {
+							sum = _mm_add_ps(sum, _mm_set1_ps(pv[3][row])); // world[15] is 1, the others 0
+						}
+						mvp[column * 4 + row] = sum;
+					}
+				}
+				storeMatrices4(batch.mvpMatrices, index, mvp);
+			}
+		}
+		computeTransformsScalar(batch, i);
+	}
+
+	OVR_TARGET_AVX2_FMA
+	static void transpose8(__m256* m) {
+		__m256 t[8], u[8];
+		for (int k = 0; k < 8; k += 2) {
+			t[k] = _mm256_unpacklo_ps(m[k], m[k + 1]);
+			t[k + 1] = _mm256_unpackhi_ps(m[k], m[k + 1]);
+		}
+		for (int k = 0; k < 8; k += 4) {
+			u[k + 0] = _mm256_shuffle_ps(t[k + 0], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+			u[k + 1] = _mm256_shuffle_ps(t[k + 0], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+			u[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+			u[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+		}
+		for (int k = 0; k < 4; k++) {
+			m[k] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x20);
+			m[k + 4] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x31);
+		}
+	}
+
+	// m holds element e of 8 matrices in m[e], written to out[index[lane]]
+	OVR_TARGET_AVX2_FMA
+	static void storeMatrices8(glm::mat4* out, const uint32_t* index, __m256* m) {
+		transpose8(m);     // first two columns of every matrix
+		transpose8(m + 8); // last two
+		for (int lane = 0; lane < 8; lane++) {
+			_mm256_storeu_ps(&out[index[lane]][0][0], m[lane]);
+			_mm256_storeu_ps(&out[index[lane]][2][0], m[8 + lane]);
+		}
+	}
+
+	OVR_TARGET_AVX2_FMA
+	static void computeTransformsAVX2(const OvrTransformBatch& batch) {
+		const glm::mat4& pv = batch.projectionView;
+		const __m256i three = _mm256_set1_epi32(3);
+		size_t i = 0;
+		for (; i + 8 <= batch.count; i += 8) {
+			uint32_t index[8];
+			__m256i lanes;
+			if (batch.indices) {
+				lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(batch.indices + i));
+			}
+			else {
+				lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(index), lanes);
+			const __m256i offsets = _mm256_mullo_epi32(lanes, three); // in floats, vec3 arrays are packed
+
+			__m256 sines[3], cosines[3], scale[3], translation[3];
+			for (int axis = 0; axis < 3; axis++) {
+				sinCos8(_mm256_i32gather_ps(&batch.rotations[0][axis], offsets, 4), sines[axis], cosines[axis]);
+				scale[axis] = _mm256_i32gather_ps(&batch.scales[0][axis], offsets, 4);
+				translation[axis] = _mm256_i32gather_ps(&batch.translations[0][axis], offsets, 4);
+			}
+			const __m256 s1 = sines[1], c1 = cosines[1], s2 = sines[0], c2 = cosines[0], s3 = sines[2], c3 = cosines[2];
+			const __m256 s1s2 = _mm256_mul_ps(s1, s2);
+			const __m256 c1s2 = _mm256_mul_ps(c1, s2);
+			__m256 r[9];
+			r[0] = _mm256_fmadd_ps(s1s2, s3, _mm256_mul_ps(c1, c3));
+			r[1] = _mm256_mul_ps(c2, s3);
+			r[2] = _mm256_fmsub_ps(c1s2, s3, _mm256_mul_ps(c3, s1));
+			r[3] = _mm256_fmsub_ps(s1s2, c3, _mm256_mul_ps(c1, s3));
+			r[4] = _mm256_mul_ps(c2, c3);
+			r[5] = _mm256_fmadd_ps(c1s2, c3, _mm256_mul_ps(s1, s3));
+			r[6] = _mm256_mul_ps(c2, s1);
+			r[7] = _mm256_xor_ps(s2, _mm256_set1_ps(-0.f));
+			r[8] = _mm256_mul_ps(c1, c2);
+
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 one = _mm256_set1_ps(1.f);
+			__m256 world[16];
+			for (int column = 0; column < 3; column++) {
+				for (int row = 0; row < 3; row++) {
+					world[column * 4 + row] = _mm256_mul_ps(scale[column], r[column * 3 + row]);
+				}
+				world[column * 4 + 3] = zero;
+			}
+			world[12] = translation[0];
+			world[13] = translation[1];
+			world[14] = translation[2];
+			world[15] = one;
+
+			if (batch.mvpMatrices) { // before the world store, which transposes in place
+				__m256 mvp[16];
+				for (int column = 0; column < 4; column++) {
+					for (int row = 0; row < 4; row++) {
+						__m256 sum = column == 3 ? _mm256_set1_ps(pv[3][row]) : zero;
+						sum = _mm256_fmadd_ps(_mm256_set1_ps(pv[0][row]), world[column * 4 + 0], sum);
+						sum = _mm256_fmadd_ps(_mm256_set1_ps(pv[1][row]), world[column * 4 + 1], sum);
+						sum = _mm256_fmadd_ps(_mm256_set1_ps(pv[2][row]), world[column * 4 + 2], sum);
+						mvp[column * 4 + row] = sum;
+					}
+				}
+				storeMatrices8(batch.mvpMatrices, index, mvp);
+			}
+			if (batch.normalMatrices) {
+				__m256 normal[16];
+				for (int column = 0; column < 3; column++) {
+					__m256 inverseScale = _mm256_div_ps(one, scale[column]);
+					for (int row = 0; row < 3; row++) {
+						normal[column * 4 + row] = _mm256_mul_ps(inverseScale, r[column * 3 + row]);
+					}
+					normal[column * 4 + 3] = zero;
+				}
+				normal[12] = zero;
+				normal[13] = zero;
+				normal[14] = zero;
+				normal[15] = one;
+				storeMatrices8(batch.normalMatrices, index, normal);
+			}
+			if (batch.worldMatrices) {
+				storeMatrices8(batch.worldMatrices, index, world);
+			}
+		}
+		computeTransformsScalar(batch, i);
+	}
+
+	OVR_TARGET_SSE41
+	static void multiplyMatricesSSE41(const glm::mat4& lhs, const glm::mat4* rhs, size_t count, glm::mat4* out) {
+		const __m128 l0 = _mm_loadu_ps(&lhs[0][0]);
+		const __m128 l1 = _mm_loadu_ps(&lhs[1][0]);
+		const __m128 l2 = _mm_loadu_ps(&lhs[2][0]);
+		const __m128 l3 = _mm_loadu_ps(&lhs[3][0]);
+		for (size_t i = 0; i < count; i++) {
+			for (int column = 0; column < 4; column++) {
+				__m128 r = _mm_loadu_ps(&rhs[i][column][0]);
+				__m128 sum = _mm_mul_ps(l0, _mm_shuffle_ps(r, r, 0x00));
+				sum = _mm_add_ps(sum, _mm_mul_ps(l1, _mm_shuffle_ps(r, r, 0x55)));
+				sum = _mm_add_ps(sum, _mm_mul_ps(l2, _mm_shuffle_ps(r, r, 0xaa)));
+				sum = _mm_add_ps(sum, _mm_mul_ps(l3, _mm_shuffle_ps(r, r, 0xff)));
+				_mm_storeu_ps(&out[i][column][0], sum);
+			}
+		}
+	}
+
+	OVR_TARGET_AVX2_FMA
+	static void multiplyMatricesAVX2(const glm::mat4& lhs, const glm::mat4* rhs, size_t count, glm::mat4* out) {
+		// every lhs column in both halves, so one iteration produces two output columns
+		const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[0][0]));
+		const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[1][0]));
+		const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[2][0]));
+		const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[3][0]));
+		for (size_t i = 0; i < count; i++) {
+			for (int column = 0; column < 4; column += 2) {
+				__m256 r = _mm256_loadu_ps(&rhs[i][column][0]);
+				__m256 sum = _mm256_mul_ps(l0, _mm256_permute_ps(r, 0x00));
+				sum = _mm256_fmadd_ps(l1, _mm256_permute_ps(r, 0x55), sum);
+				sum = _mm256_fmadd_ps(l2, _mm256_permute_ps(r, 0xaa), sum);
+				sum = _mm256_fmadd_ps(l3, _mm256_permute_ps(r, 0xff), sum);
+				_mm256_storeu_ps(&out[i][column][0], sum);
+			}
+		}
+	}
+#endif
+
+	void computeTransforms(const OvrTransformBatch& batch, OvrTransformKernel kernel) {
+#ifdef OVR_X86
+		const auto& features = OvrCpuFeatures::get();
+		if (kernel == OvrTransformKernel::AVX2 && features.avx2 && features.fma) {
+			computeTransformsAVX2(batch);
+			return;
+		}
+		if (kernel != OvrTransformKernel::Scalar && features.sse41) {
+			computeTransformsSSE41(batch);
+			return;
+		}
+#endif
+		computeTransformsScalar(batch, 0);
+	}
+
+	void multiplyMatrices(const glm::mat4& lhs, const glm::mat4* rhs, size_t count, glm::mat4* out, OvrTransformKernel kernel) {
+#ifdef OVR_X86
+		const auto& features = OvrCpuFeatures::get();
+		if (kernel == OvrTransformKernel::AVX2 && features.avx2 && features.fma) {
+			multiplyMatricesAVX2(lhs, rhs, count, out);
+			return;
+		}
+		if (kernel != OvrTransformKernel::Scalar && features.sse41) {
+			multiplyMatricesSSE41(lhs, rhs, count, out);
+			return;
+		}
+#endif
+		multiplyMatricesScalar(lhs, rhs, count, out);
+	}
+}
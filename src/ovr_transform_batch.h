@@ -0,0 +1,53 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ovr {
+
+	enum class OvrTransformKernel {
+		Scalar, // TransformComponent::makeMatrices per object
+		SSE41,  // 4 objects per iteration
+		AVX2    // 8 objects per iteration, with FMA
+	};
+
+	// widest kernel this CPU supports
+	OvrTransformKernel bestTransformKernel();
+
+	// Euler/scale/translation components in, any of world, normal and projectionView * world out.
+	// Element i of the outputs belongs to element i of the inputs, with indices they are both
+	// indices[i], so a list of dirty entries can be processed in place.
+	// The SIMD kernels use their own sin/cos, they agree with the scalar one to about 1e-6.
+	struct OvrTransformBatch {
+		const glm::vec3* translations = nullptr;
+		const glm::vec3* rotations = nullptr; // Tait-Bryan YXZ, see TransformComponent::mat4
+		const glm::vec3* scales = nullptr;
+		const uint32_t* indices = nullptr;    // entries to process, nullptr for 0..count-1
+		size_t count = 0;
+
+		glm::mat4* worldMatrices = nullptr;   // each output is optional
+		glm::mat4* normalMatrices = nullptr;  // mat3 padded to a mat4, like InstanceData
+		glm::mat4* mvpMatrices = nullptr;
+		glm::mat4 projectionView{ 1.f };      // only read when mvpMatrices is set
+	};
+
+	void computeTransforms(const OvrTransformBatch& batch, OvrTransformKernel kernel = bestTransformKernel());
+
+	// out[i] = lhs * rhs[i], for already cached model matrices. out must not alias rhs.
+	void multiplyMatrices(
+		const glm::mat4& lhs,
+		const glm::mat4* rhs,
+		size_t count,
+		glm::mat4* out,
+		OvrTransformKernel kernel = bestTransformKernel());
+}
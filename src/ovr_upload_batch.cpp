@@ -0,0 +1,126 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_upload_batch.h"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace ovr {
+
+OvrUploadBatch::OvrUploadBatch(OVRDevice &device)
+    : ovrDevice{device}, ticket_{device.reserveUploadTicket()} {}
+
+OvrUploadBatch::~OvrUploadBatch() {
+  if (!submitted) {
+    // destructors must not throw, this also runs while unwinding from a failed upload
+    try {
+      submit();
+    } catch (const std::exception &e) {
+      std::cerr << "upload batch: " << e.what() << std::endl;
+    }
+  }
+}
+
+VkCommandBuffer OvrUploadBatch::getCommandBuffer() {
+  assert(!submitted && "Cannot record into an upload batch that was already submitted");
+  if (commandBuffer == VK_NULL_HANDLE) {
+    commandBuffer = ovrDevice.allocateUploadCommandBuffer();
+  }
+  return commandBuffer;
+}
+
+void OvrUploadBatch::uploadBuffer(
+    VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset) {
+  VkCommandBuffer cmd = getCommandBuffer();
+
+  OvrStagingRegion staging = ovrDevice.stagingRing().allocate(size);
+  memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = staging.offset;
+  copyRegion.dstOffset = dstOffset;
+  copyRegion.size = size;
+  vkCmdCopyBuffer(cmd, staging.buffer, dstBuffer, 1, &copyRegion);
+
+  regions.push_back(staging);
+}
+
+void OvrUploadBatch::uploadImage(
+    VkImage image,
+    const void *data,
+    VkDeviceSize size,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layerCount) {
+  VkCommandBuffer cmd = getCommandBuffer();
+
+  OvrStagingRegion staging = ovrDevice.stagingRing().allocate(size);
+  memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = staging.offset;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = layerCount;
+
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {width, height, 1};
+
+  vkCmdCopyBufferToImage(
+      cmd,
+      staging.buffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1,
+      &region);
+
+  regions.push_back(staging);
+}
+
+OvrUploadTicket OvrUploadBatch::submit() {
+  assert(!submitted && "Upload batch submitted twice");
+  submitted = true;
+
+  if (commandBuffer == VK_NULL_HANDLE) {  // nothing recorded
+    ovrDevice.cancelUploadTicket(ticket_);
+    return ticket_;
+  }
+
+  // make the copies visible to everything submitted after this batch
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                          VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  VkFence fence = ovrDevice.submitUploadCommandBuffer(commandBuffer, ticket_);
+  for (auto &region : regions) {
+    ovrDevice.stagingRing().release(region, fence);
+  }
+  return ticket_;
+}
+
+}  // namespace ovr
@@ -0,0 +1,55 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_device.h"
+#include "ovr_staging_ring.h"
+
+// std lib headers
+#include <vector>
+
+namespace ovr {
+
+// Records any number of staged copies into one command buffer and submits them
+// with a single fence. Nothing waits on the GPU: poll the returned ticket with
+// OVRDevice::isUploadComplete, or block on it with OVRDevice::waitForUpload.
+// Work submitted after the batch on the graphics queue sees the uploaded data.
+class OvrUploadBatch {
+ public:
+  OvrUploadBatch(OVRDevice &device);
+  ~OvrUploadBatch();  // submits whatever is still recorded, errors are logged instead of thrown
+
+  OvrUploadBatch(const OvrUploadBatch &) = delete;
+  OvrUploadBatch &operator=(const OvrUploadBatch &) = delete;
+
+  void uploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+  // image must already be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+  void uploadImage(
+      VkImage image,
+      const void *data,
+      VkDeviceSize size,
+      uint32_t width,
+      uint32_t height,
+      uint32_t layerCount);
+
+  OvrUploadTicket submit();
+
+  // known before submit, so resources can remember which upload fills them
+  OvrUploadTicket ticket() const { return ticket_; }
+  size_t copyCount() const { return regions.size(); }
+
+ private:
+  VkCommandBuffer getCommandBuffer();
+
+  OVRDevice &ovrDevice;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  std::vector<OvrStagingRegion> regions;
+  OvrUploadTicket ticket_;
+  bool submitted = false;
+};
+
+}  // namespace ovr
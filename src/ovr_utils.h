@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace ovr {
@@ -18,4 +21,42 @@ namespace ovr {
 		(hashCombine(seed, rest), ...);
 	};
 
+	// FNV-1a over raw bytes, stable across runs so it can be stored in files
+	inline uint64_t hashBytes(const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// 32 bytes per step in four independent lanes, many times faster than hashBytes on large files
+	// (model sources of several GB). Also stable across runs, but gives other values than hashBytes
+	inline uint64_t hashLargeBytes(const void* data, size_t size) {
+		constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+		auto rotateLeft = [](uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); };
+
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t lanes[4] = { PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1 };
+		size_t offset = 0;
+		for (; offset + 32 <= size; offset += 32) {
+			for (int lane = 0; lane < 4; lane++) {
+				uint64_t word;
+				std::memcpy(&word, bytes + offset + lane * 8, sizeof(word));
+				lanes[lane] = rotateLeft(lanes[lane] + word * PRIME2, 31) * PRIME1;
+			}
+		}
+		uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) +
+			rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18) + static_cast<uint64_t>(size);
+		for (; offset < size; offset++) {
+			hash = (hash ^ bytes[offset]) * 1099511628211ull;
+		}
+		hash ^= hash >> 33; // final mix so every input bit reaches every output bit
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		return hash;
+	}
+
 }  // namespace lve
@@ -0,0 +1,123 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_vertex_compression.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ovr {
+	static_assert(sizeof(OvrModel::CompressedVertex) == 16, "CompressedVertex must match its attribute descriptions");
+
+	static uint16_t quantizeUnorm16(float value) {
+		return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.f, 1.f) * OvrVertexCompression::POSITION_STEPS));
+	}
+
+	static int16_t quantizeSnorm16(float value) {
+		return static_cast<int16_t>(std::lround(glm::clamp(value, -1.f, 1.f) * OvrVertexCompression::NORMAL_STEPS));
+	}
+
+	static float signNotZero(float value) {
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+	OvrModel::Dequantization OvrVertexCompression::getDequantization(const OvrModel::Bounds& bounds) {
+		OvrModel::Dequantization dequantization{};
+		if (!bounds.isValid()) {
+			return dequantization;
+		}
+		dequantization.positionScale = glm::vec4{ bounds.max - bounds.min, 0.f };
+		dequantization.positionOffset = glm::vec4{ bounds.min, 0.f };
+		return dequantization;
+	}
+
+	bool OvrVertexCompression::hasVertexColors(const Vertex* vertices, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			if (vertices[i].color != glm::vec3{ 1.f }) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void OvrVertexCompression::compress(
+		const Vertex* vertices,
+		size_t count,
+		const OvrModel::Dequantization& dequantization,
+		std::vector<CompressedVertex>& compressed,
+		std::vector<uint32_t>* colors) {
+		const glm::vec3 offset{ dequantization.positionOffset };
+		const glm::vec3 scale{ dequantization.positionScale };
+		const glm::vec3 inverseScale{
+			scale.x > 0.f ? 1.f / scale.x : 0.f,
+			scale.y > 0.f ? 1.f / scale.y : 0.f,
+			scale.z > 0.f ? 1.f / scale.z : 0.f };
+
+		compressed.resize(count);
+		if (colors != nullptr) {
+			colors->resize(count);
+		}
+		for (size_t i = 0; i < count; i++) {
+			const Vertex& vertex = vertices[i];
+			CompressedVertex& result = compressed[i];
+			const glm::vec3 position = (vertex.position - offset) * inverseScale;
+			result.position[0] = quantizeUnorm16(position.x);
+			result.position[1] = quantizeUnorm16(position.y);
+			result.position[2] = quantizeUnorm16(position.z);
+			result.position[3] = 0;
+			const std::array<int16_t, 2> normal = encodeOctahedral(vertex.normal);
+			result.normal[0] = normal[0];
+			result.normal[1] = normal[1];
+			result.uv[0] = glm::packHalf1x16(vertex.uv.x);
+			result.uv[1] = glm::packHalf1x16(vertex.uv.y);
+			if (colors != nullptr) {
+				(*colors)[i] = glm::packUnorm4x8(glm::vec4{ glm::clamp(vertex.color, 0.f, 1.f), 1.f });
+			}
+		}
+	}
+
+	// the unit octahedron unfolded onto a square, the lower half folded over the corners (Cigolle et al. 2014)
+	std::array<int16_t, 2> OvrVertexCompression::encodeOctahedral(const glm::vec3& normal) {
+		const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (!(length > 0.f)) {
+			return { 0, 0 }; // no normal, decodes to +z
+		}
+		glm::vec2 projected = glm::vec2{ normal } / length;
+		if (normal.z < 0.f) {
+			projected = glm::vec2{
+				(1.f - std::abs(projected.y)) * signNotZero(projected.x),
+				(1.f - std::abs(projected.x)) * signNotZero(projected.y) };
+		}
+		return { quantizeSnorm16(projected.x), quantizeSnorm16(projected.y) };
+	}
+
+	glm::vec3 OvrVertexCompression::decodeOctahedral(const int16_t encoded[2]) {
+		// snorm decode as the vertex input does it, -32768 clamps to -1
+		const glm::vec2 projected{
+			std::max(encoded[0] / NORMAL_STEPS, -1.f),
+			std::max(encoded[1] / NORMAL_STEPS, -1.f) };
+		glm::vec3 normal{ projected, 1.f - std::abs(projected.x) - std::abs(projected.y) };
+		const float fold = std::max(-normal.z, 0.f);
+		normal.x += normal.x >= 0.f ? -fold : fold;
+		normal.y += normal.y >= 0.f ? -fold : fold;
+		return glm::normalize(normal);
+	}
+
+	glm::vec3 OvrVertexCompression::decodePosition(
+		const CompressedVertex& vertex, const OvrModel::Dequantization& dequantization) {
+		const glm::vec3 unorm{
+			vertex.position[0] / POSITION_STEPS,
+			vertex.position[1] / POSITION_STEPS,
+			vertex.position[2] / POSITION_STEPS };
+		return glm::vec3{ dequantization.positionOffset } + unorm * glm::vec3{ dequantization.positionScale };
+	}
+
+	glm::vec2 OvrVertexCompression::decodeUv(const CompressedVertex& vertex) {
+		return { glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1]) };
+	}
+}
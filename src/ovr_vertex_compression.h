@@ -0,0 +1,49 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+
+	// Encodes OvrModel::Vertex into OvrModel::CompressedVertex, the decode functions do what
+	// shaders/compressed_shader.vert does and are there to measure the error on the CPU.
+	// Half float uvs keep 11 significant bits, enough within a few repeats of a texture but not
+	// for uvs in the thousands, those models should stay VertexFormat::Float
+	class OvrVertexCompression {
+	public:
+		using Vertex = OvrModel::Vertex;
+		using CompressedVertex = OvrModel::CompressedVertex;
+
+		static constexpr float POSITION_STEPS = 65535.f; // unorm16
+		static constexpr float NORMAL_STEPS = 32767.f;   // snorm16
+
+		// maps bounds.min to 0 and bounds.max to 65535 on every axis, a flat axis decodes to bounds.min
+		static OvrModel::Dequantization getDequantization(const OvrModel::Bounds& bounds);
+
+		// false when every vertex color is white, then VertexFormat::Compressed needs no color stream
+		static bool hasVertexColors(const Vertex* vertices, size_t count);
+
+		// colors is filled with R8G8B8A8_UNORM values when not null
+		static void compress(
+			const Vertex* vertices,
+			size_t count,
+			const OvrModel::Dequantization& dequantization,
+			std::vector<CompressedVertex>& compressed,
+			std::vector<uint32_t>* colors = nullptr);
+
+		static std::array<int16_t, 2> encodeOctahedral(const glm::vec3& normal);
+		static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+		static glm::vec3 decodePosition(const CompressedVertex& vertex, const OvrModel::Dequantization& dequantization);
+		static glm::vec2 decodeUv(const CompressedVertex& vertex);
+	};
+}
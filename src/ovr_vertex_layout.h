@@ -0,0 +1,43 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+#include "ovr_pipeline.h"
+
+#include <cstdint>
+
+namespace ovr {
+
+	// The vertex streams a pass reads (OvrModel::VertexStreamBits), fixed at compile time so the
+	// pipelines a render system creates and the buffers it binds for them can't disagree.
+	// A pass still needs one pipeline per OvrModel vertex layout, strides and formats differ
+	template <uint32_t Streams>
+	struct OvrVertexLayout {
+		static_assert(Streams != 0 && (Streams & ~OvrModel::ALL_STREAMS) == 0, "unknown vertex streams");
+
+		static constexpr uint32_t STREAMS = Streams;
+		static constexpr bool POSITIONS_ONLY = Streams == OvrModel::POSITION_STREAM;
+
+		// replaces the vertex bindings and attributes of configInfo, render systems append their
+		// per-instance ones after
+		static void apply(PipelineConfigInfo& configInfo, uint32_t vertexLayout) {
+			configInfo.bindingDescriptions = OvrModel::getBindingDescriptions(vertexLayout, Streams);
+			configInfo.attributeDescriptions = OvrModel::getAttributeDescriptions(vertexLayout, Streams);
+		}
+
+		// bindState carries what the previous model bound, see OvrGeometryPool
+		static void bind(VkCommandBuffer commandBuffer, OvrModel& model, OvrGeometryPool::BindState* bindState = nullptr) {
+			model.bind(commandBuffer, Streams, bindState);
+		}
+	};
+
+	// color passes
+	using OvrFullVertexLayout = OvrVertexLayout<OvrModel::ALL_STREAMS>;
+	// depth prepass, shadow and picking passes: a split model fetches only its position buffer
+	using OvrPositionVertexLayout = OvrVertexLayout<OvrModel::POSITION_STREAM>;
+}
@@ -0,0 +1,222 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#include "ovr_vertex_table.h"
+#include "ovr_job_system.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace ovr {
+	static_assert(sizeof(OvrModel::Vertex) == 44, "hash reads the vertex as 11 words");
+
+	static constexpr uint32_t DEDUP_GRAIN = 1 << 16;
+
+	static size_t nextPowerOfTwo(size_t value) {
+		size_t power = 1;
+		while (power < value) {
+			power <<= 1;
+		}
+		return power;
+	}
+
+	OvrVertexTable::OvrVertexTable(size_t maxVertices) {
+		resize(nextPowerOfTwo(std::max<size_t>(16, maxVertices + maxVertices / 2)), {}); // load stays under 2/3
+	}
+
+	uint64_t OvrVertexTable::hash(const Vertex& vertex) {
+		constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+		uint32_t words[11];
+		std::memcpy(words, &vertex, sizeof(words));
+		for (uint32_t& word : words) {
+			word &= 0u - static_cast<uint32_t>((word << 1) != 0); // -0.f is +0.f, they compare equal
+		}
+
+		uint64_t result = PRIME2 ^ sizeof(words);
+		for (int i = 0; i < 10; i += 2) {
+			uint64_t pair = words[i] | (static_cast<uint64_t>(words[i + 1]) << 32);
+			result ^= pair * PRIME2;
+			result = ((result << 31) | (result >> 33)) * PRIME1;
+		}
+		result ^= words[10] * PRIME1;
+		result ^= result >> 29;
+		result *= PRIME2;
+		result ^= result >> 32;
+		return result;
+	}
+
+	uint32_t OvrVertexTable::insert(const Vertex& vertex, std::vector<Vertex>& vertices) {
+		if ((count + 1) * 3 > slots.size() * 2) {
+			resize(slots.size() * 2, vertices); // more vertices than the table was made for
+		}
+		const uint64_t vertexHash = hash(vertex);
+		const uint32_t hashBits = static_cast<uint32_t>(vertexHash >> 32);
+		for (size_t i = vertexHash & mask;; i = (i + 1) & mask) {
+			Slot& slot = slots[i];
+			if (slot.index == EMPTY_SLOT) {
+				if (vertices.size() >= EMPTY_SLOT) {
+					throw std::runtime_error("failed to deduplicate vertices: more than 32 bit indices can address!");
+				}
+				slot = { hashBits, static_cast<uint32_t>(vertices.size()) };
+				vertices.push_back(vertex);
+				count++;
+				return slot.index;
+			}
+			if (slot.hashBits == hashBits && vertices[slot.index] == vertex) {
+				return slot.index;
+			}
+		}
+	}
+
+	void OvrVertexTable::resize(size_t capacity, const std::vector<Vertex>& vertices) {
+		std::vector<Slot> oldSlots = std::move(slots);
+		slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+		mask = capacity - 1;
+		for (const Slot& oldSlot : oldSlots) {
+			if (oldSlot.index == EMPTY_SLOT) {
+				continue;
+			}
+			size_t i = hash(vertices[oldSlot.index]) & mask;
+			while (slots[i].index != EMPTY_SLOT) {
+				i = (i + 1) & mask;
+			}
+			slots[i] = oldSlot;
+		}
+	}
+
+	// corners ordered by hash, then by position in the mesh
+	struct OvrCornerKey {
+		uint64_t hash;
+		uint32_t corner;
+
+		bool operator<(const OvrCornerKey& other) const {
+			return hash < other.hash || (hash == other.hash && corner < other.corner);
+		}
+	};
+
+	// sorts runs on the job system, then merges them pairwise, each round's merges in parallel
+	static void parallelSort(std::vector<OvrCornerKey>& keys, OvrJobSystem& jobSystem) {
+		const size_t keyCount = keys.size();
+		const size_t runCount = std::min(nextPowerOfTwo(jobSystem.getThreadCount()),
+			nextPowerOfTwo(std::max<size_t>(1, keyCount / DEDUP_GRAIN)));
+		std::vector<size_t> runStarts(runCount + 1);
+		for (size_t i = 0; i <= runCount; i++) {
+			runStarts[i] = keyCount / runCount * i;
+		}
+		runStarts[runCount] = keyCount;
+
+		jobSystem.parallelFor(static_cast<uint32_t>(runCount), 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t run = begin; run < end; run++) {
+				std::sort(keys.begin() + runStarts[run], keys.begin() + runStarts[run + 1]);
+			}
+		});
+
+		std::vector<OvrCornerKey> merged(keyCount);
+		for (size_t width = 1; width < runCount; width *= 2) {
+			const uint32_t mergeCount = static_cast<uint32_t>(runCount / (width * 2));
+			jobSystem.parallelFor(mergeCount, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t merge = begin; merge < end; merge++) {
+					const size_t first = runStarts[merge * width * 2];
+					const size_t middle = runStarts[merge * width * 2 + width];
+					const size_t last = runStarts[merge * width * 2 + width * 2];
+					std::merge(keys.begin() + first, keys.begin() + middle, keys.begin() + middle, keys.begin() + last,
+						merged.begin() + first);
+				}
+			});
+			keys.swap(merged);
+		}
+	}
+
+	void OvrVertexTable::deduplicate(
+		const Vertex* corners,
+		size_t cornerCount,
+		OvrJobSystem& jobSystem,
+		std::vector<Vertex>& vertices,
+		std::vector<uint32_t>& indices) {
+		if (cornerCount >= EMPTY_SLOT) {
+			throw std::runtime_error("failed to deduplicate vertices: more than 32 bit indices can address!");
+		}
+		const uint32_t count = static_cast<uint32_t>(cornerCount);
+
+		std::vector<OvrCornerKey> keys(count);
+		jobSystem.parallelFor(count, DEDUP_GRAIN, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				keys[i] = { hash(corners[i]), i };
+			}
+		});
+		parallelSort(keys, jobSystem);
+
+		// every corner's representative, the first corner equal to it. Within a run of equal hashes the
+		// keys are in corner order, so the first of each group of equal vertices is met first
+		std::vector<uint32_t> representatives(count);
+		jobSystem.parallelFor(count, DEDUP_GRAIN, [&](uint32_t begin, uint32_t end) {
+			// ranges are moved to start and end on run boundaries, so each run is done by one job
+			while (begin > 0 && begin < count && keys[begin].hash == keys[begin - 1].hash) {
+				begin++;
+			}
+			while (end < count && keys[end].hash == keys[end - 1].hash) {
+				end++;
+			}
+			std::vector<uint32_t> groups; // representatives seen in the current run, nearly always one
+			for (uint32_t i = begin; i < end; i++) {
+				if (i == begin || keys[i].hash != keys[i - 1].hash) {
+					groups.clear();
+				}
+				const uint32_t corner = keys[i].corner;
+				auto group = std::find_if(groups.begin(), groups.end(),
+					[&](uint32_t representative) { return corners[representative] == corners[corner]; });
+				if (group == groups.end()) {
+					groups.push_back(corner);
+					representatives[corner] = corner;
+				}
+				else {
+					representatives[corner] = *group;
+				}
+			}
+		});
+
+		// number the representatives in corner order: counts per block, a prefix sum, then the numbering
+		const uint32_t blockCount = (count + DEDUP_GRAIN - 1) / DEDUP_GRAIN;
+		std::vector<uint32_t> blockOffsets(blockCount + 1, 0);
+		jobSystem.parallelFor(blockCount, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t block = begin; block < end; block++) {
+				const uint32_t last = std::min(count, (block + 1) * DEDUP_GRAIN);
+				uint32_t firsts = 0;
+				for (uint32_t i = block * DEDUP_GRAIN; i < last; i++) {
+					firsts += representatives[i] == i;
+				}
+				blockOffsets[block + 1] = firsts;
+			}
+		});
+		for (uint32_t block = 0; block < blockCount; block++) {
+			blockOffsets[block + 1] += blockOffsets[block];
+		}
+
+		std::vector<uint32_t> vertexIndices(count);
+		vertices.resize(blockOffsets[blockCount]);
+		jobSystem.parallelFor(blockCount, 1, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t block = begin; block < end; block++) {
+				const uint32_t last = std::min(count, (block + 1) * DEDUP_GRAIN);
+				uint32_t next = blockOffsets[block];
+				for (uint32_t i = block * DEDUP_GRAIN; i < last; i++) {
+					if (representatives[i] == i) {
+						vertexIndices[i] = next;
+						vertices[next++] = corners[i];
+					}
+				}
+			}
+		});
+
+		indices.resize(count);
+		jobSystem.parallelFor(count, DEDUP_GRAIN, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				indices[i] = vertexIndices[representatives[i]];
+			}
+		});
+	}
+}
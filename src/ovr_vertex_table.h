@@ -0,0 +1,60 @@
+//========================================================================
+// OVRenderer (Open Vulkan Renderer)
+// Version: 0.1
+//------------------------------------------------------------------------
+// Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
+//========================================================================
+#pragma once
+
+#include "ovr_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ovr {
+	class OvrJobSystem;
+
+	// Vertex deduplication for OvrModel::Builder. A flat open addressing table of {hash bits, index}
+	// slots with linear probing, sized once from the corner count so it neither rehashes nor allocates
+	// per vertex. Vertices compare with Vertex::operator==, the hash agrees with it (-0 and +0 hash the same).
+	// Unique vertices come out in first occurrence order, so the result is the one std::unordered_map gave.
+	class OvrVertexTable {
+	public:
+		using Vertex = OvrModel::Vertex;
+
+		// from this many corners Builder::loadObj uses deduplicate on its job system instead
+		static constexpr size_t PARALLEL_MIN_CORNERS = 1 << 22;
+
+		explicit OvrVertexTable(size_t maxVertices);
+
+		// index of vertex in vertices, appended to them first if it isn't there yet
+		uint32_t insert(const Vertex& vertex, std::vector<Vertex>& vertices);
+
+		// byte wise over the 44 bytes of the vertex, stable across runs
+		static uint64_t hash(const Vertex& vertex);
+
+		// Sort based deduplication on the job system: hashes the corners, sorts them by hash, groups the
+		// equal ones and numbers the groups by first occurrence. Gives exactly what inserting every corner
+		// in order would, with no shared table to contend on.
+		static void deduplicate(
+			const Vertex* corners,
+			size_t cornerCount,
+			OvrJobSystem& jobSystem,
+			std::vector<Vertex>& vertices,
+			std::vector<uint32_t>& indices);
+
+	private:
+		struct Slot {
+			uint32_t hashBits;  // upper half of the hash, most mismatches never touch the vertex
+			uint32_t index;     // EMPTY_SLOT when free
+		};
+		static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+		void resize(size_t capacity, const std::vector<Vertex>& vertices);
+
+		std::vector<Slot> slots;
+		size_t mask = 0;
+		size_t count = 0;
+	};
+}
@@ -5,30 +5,61 @@
 // Copyright (c) 2022-2022 Nagornov Vladimir <vladimirnagornov831@gmail.com>
 //========================================================================
 #include "simple_render_system.h"
+#include "ovr_command_recorder.h"
+#include "ovr_job_system.h"
+#include "ovr_lod_selector.h"
+#include "ovr_swap_chain.h"
+#include "ovr_vertex_layout.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstddef>
 #include <stdexcept>
-#include <array>
 
 
 
 namespace ovr {
 	struct SimplePushConstantData {
-		glm::mat4 transform{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
+		glm::mat4 projectionView{ 1.f }; // model and normal matrices come from the instance buffer
+		OvrModel::Dequantization dequantization{}; // pushed again for every model
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(OVRDevice &device, VkRenderPass renderPass) : ovrDevice(device) {
+	// vertex shader per OvrModel::VertexFormat, split or interleaved streams read the same
+	static const char* const VERTEX_SHADERS[OvrModel::VERTEX_FORMAT_COUNT] = {
+		"resources/shaders/simple_shader.vert.spv",
+		"resources/shaders/compressed_shader.vert.spv",
+		"resources/shaders/compressed_color_shader.vert.spv" };
+	// the position stream reads the same for every format, float positions get an identity dequantization
+	static const char* const DEPTH_SHADERS[OvrModel::VERTEX_FORMAT_COUNT] = {
+		"resources/shaders/depth_shader.vert.spv",
+		"resources/shaders/depth_shader.vert.spv",
+		"resources/shaders/depth_shader.vert.spv" };
+
+	SimpleRenderSystem::SimpleRenderSystem(OVRDevice &device, VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder) : ovrDevice(device) {
 		createPipelineLayout();
-		createPipeline(renderPass);
+		createPipeline(renderPass, pipelineBuilder);
+		instanceBuffers.resize(OVRSwapChain::MAX_FRAMES_IN_FLIGHT);
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem() {
+		for (auto* handles : { &ovrPipelines, &depthPipelines }) {
+			for (auto& ovrPipeline : *handles) {
+				if (ovrPipeline.valid()) {
+					ovrPipeline.get(); // the layout must outlive a compile still in flight
+				}
+			}
+		}
+		for (auto& instanceBuffer : instanceBuffers) {
+			if (instanceBuffer.buffer != VK_NULL_HANDLE) {
+				ovrDevice.destroyBuffer(instanceBuffer.buffer, instanceBuffer.allocation);
+			}
+		}
 		vkDestroyPipelineLayout(ovrDevice.device(), pipelineLayout, nullptr);
 	}
 
@@ -36,7 +67,7 @@ namespace ovr {
 	void SimpleRenderSystem::createPipelineLayout()
 	{
 		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(SimplePushConstantData);
 
@@ -53,51 +84,275 @@ namespace ovr {
 			throw std::runtime_error("failed to create pipeline layout!");
 		}
 	}
-	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
+	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder)
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
+		requestPipelines<OvrFullVertexLayout>(
+			renderPass, pipelineBuilder, ovrPipelines, VERTEX_SHADERS, "resources/shaders/simple_shader.frag.spv");
+		requestPipelines<OvrPositionVertexLayout>(renderPass, pipelineBuilder, depthPipelines, DEPTH_SHADERS, "");
+	}
 
-		PipelineConfigInfo pipelineConfig{};
-		OvrPipeline::defaultPipelineConfigInfo(
-			pipelineConfig);
+	template <typename Layout>
+	void SimpleRenderSystem::requestPipelines(
+		VkRenderPass renderPass,
+		OvrPipelineBuilder &pipelineBuilder,
+		LayoutPipelineHandles &handles,
+		const char* const* vertexShaders,
+		const char* fragmentShader)
+	{
+		auto instanceBindings = OvrModel::InstanceData::getBindingDescriptions();
+		auto instanceAttributes = OvrModel::InstanceData::getAttributeDescriptions();
+		for (uint32_t vertexLayout = 0; vertexLayout < OvrModel::VERTEX_LAYOUT_COUNT; vertexLayout++) {
+			auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+			OvrPipeline::defaultPipelineConfigInfo(
+				*pipelineConfig);
+
+			pipelineConfig->renderPass = renderPass;
+			pipelineConfig->pipelineLayout = pipelineLayout;
+			if (Layout::POSITIONS_ONLY) {
+				pipelineConfig->colorBlendAttachment.colorWriteMask = 0; // the depth prepass
+			}
+			else {
+				// passes where the depth prepass left the same depth
+				pipelineConfig->depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+			}
 
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		ovrPipeline = std::make_unique<OvrPipeline>(
-			ovrDevice,
-			"resources/shaders/simple_shader.vert.spv",
-			"resources/shaders/simple_shader.frag.spv",
-			pipelineConfig
-			);
+			Layout::apply(*pipelineConfig, vertexLayout);
+			pipelineConfig->bindingDescriptions.insert(
+				pipelineConfig->bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+			pipelineConfig->attributeDescriptions.insert(
+				pipelineConfig->attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+			handles[vertexLayout] = pipelineBuilder.requestPipeline(
+				vertexShaders[static_cast<uint32_t>(OvrModel::getVertexFormat(vertexLayout))],
+				fragmentShader,
+				std::move(pipelineConfig)
+				);
+		}
 	}
 
-	void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer,
-		std::vector<OvrGameObject>& gameObjects,
-		const OvrCamera& camera) {
+	void SimpleRenderSystem::reserveInstances(InstanceBuffer& instanceBuffer, uint32_t instanceCount)
+	{
+		if (instanceCount <= instanceBuffer.capacity) {
+			return;
+		}
+		// the frame that last used this buffer has finished, beginFrame waited on its fence
+		if (instanceBuffer.buffer != VK_NULL_HANDLE) {
+			ovrDevice.destroyBuffer(instanceBuffer.buffer, instanceBuffer.allocation);
+		}
+		instanceBuffer.capacity = std::max(instanceCount, instanceBuffer.capacity * 2);
+		ovrDevice.createBuffer(
+			sizeof(OvrModel::InstanceData) * instanceBuffer.capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			instanceBuffer.buffer,
+			instanceBuffer.allocation);
+	}
 
-		
-		ovrPipeline->bind(commandBuffer);
+	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, const OvrScene& scene) {
+		const bool bvhCulling = frustumCulling && sceneBvh != nullptr;
+		candidates.clear();
+		if (bvhCulling) {
+			// candidates are already the visible entities
+			sceneBvh->queryFrustum(frameInfo.camera.getFrustumPlanes(), candidates);
+		}
+		else {
+			const auto& modelHandles = scene.getModelHandles();
+			for (uint32_t i = 0; i < scene.size(); i++) {
+				if (modelHandles[i] != OvrScene::NO_MODEL) {
+					candidates.push_back(i);
+				}
+			}
+		}
+		lastDrawCount = 0;
+		lastTriangleCount = 0;
+		lastFullTriangleCount = 0;
+		cullingStats = {};
+		if (bvhCulling) {
+			cullingStats.culled = static_cast<uint32_t>(sceneBvh->objectCount() - candidates.size());
+		}
+		if (candidates.empty()) {
+			return;
+		}
 
-		auto projectionView = camera.getProjection() * camera.getView();
+		const uint32_t candidateCount = static_cast<uint32_t>(candidates.size());
+		visibleIndices.resize(candidateCount);
+		uint32_t visibleCount = candidateCount;
+		if (frustumCulling && !bvhCulling) {
+			const OvrFrustumPlanes planes = frameInfo.camera.getFrustumPlanes();
+			worldSpheres.resize(candidateCount);
+			if (jobSystem == nullptr || candidateCount <= CULL_JOB_SIZE) {
+				computeWorldSpheres(scene, 0, candidateCount);
+				visibleCount = static_cast<uint32_t>(cullSpheres(worldSpheres, planes, visibleIndices.data()));
+			}
+			else {
+				// every range culls into its own part of visibleIndices, the parts are packed together after
+				const uint32_t rangeCount = (candidateCount + CULL_JOB_SIZE - 1) / CULL_JOB_SIZE;
+				rangeVisibleCounts.assign(rangeCount, 0);
+				jobSystem->parallelFor(rangeCount, 1, [&](uint32_t firstRange, uint32_t lastRange) {
+					for (uint32_t range = firstRange; range < lastRange; range++) {
+						uint32_t begin = range * CULL_JOB_SIZE;
+						uint32_t end = std::min(begin + CULL_JOB_SIZE, candidateCount);
+						computeWorldSpheres(scene, begin, end);
+						rangeVisibleCounts[range] = static_cast<uint32_t>(
+							cullSpheres(worldSpheres, planes, begin, end, visibleIndices.data() + begin));
+					}
+				});
+				visibleCount = 0;
+				for (uint32_t range = 0; range < rangeCount; range++) {
+					const uint32_t* rangeVisible = visibleIndices.data() + range * CULL_JOB_SIZE;
+					if (visibleCount != range * CULL_JOB_SIZE) {
+						std::copy(rangeVisible, rangeVisible + rangeVisibleCounts[range], visibleIndices.data() + visibleCount);
+					}
+					visibleCount += rangeVisibleCounts[range];
+				}
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < candidateCount; i++) {
+				visibleIndices[i] = i;
+			}
+		}
+		cullingStats.visible = visibleCount;
+		cullingStats.culled += candidateCount - visibleCount;
+		if (visibleCount == 0) {
+			return;
+		}
+
+		// group by model and level so every group is contiguous in the instance buffer
+		drawList.clear();
+		for (uint32_t i = 0; i < visibleCount; i++) {
+			uint32_t index = candidates[visibleIndices[i]];
+			OvrScene::ModelHandle handle = scene.getModelHandles()[index];
+			uint32_t lod = lodSelector != nullptr ? lodSelector->select(scene, index) : 0;
+			drawList.push_back(DrawItem{ handle, lod, index });
+
+			const OvrModel* model = scene.getModel(handle);
+			const uint32_t fullCount = model->hasIndices() ? model->getIndexCount() : model->getVertexCount();
+			lastFullTriangleCount += fullCount / 3;
+			lastTriangleCount += (model->hasIndices() ? model->getLods()[lod].indexCount : fullCount) / 3;
+		}
+		std::sort(drawList.begin(), drawList.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.model != b.model ? a.model < b.model : a.lod < b.lod;
+		});
+
+		auto& instanceBuffer = instanceBuffers[frameInfo.frameIndex];
+		reserveInstances(instanceBuffer, static_cast<uint32_t>(drawList.size()));
+		// only blocks until the first compiles finish
+		auto getPipelines = [](const LayoutPipelineHandles& handles) {
+			LayoutPipelines pipelines{};
+			for (uint32_t vertexLayout = 0; vertexLayout < OvrModel::VERTEX_LAYOUT_COUNT; vertexLayout++) {
+				pipelines[vertexLayout] = &handles[vertexLayout].get();
+			}
+			return pipelines;
+		};
+		const LayoutPipelines pipelines = getPipelines(ovrPipelines);
+		const LayoutPipelines prepassPipelines = depthPrepass ? getPipelines(depthPipelines) : LayoutPipelines{};
+
+		SimplePushConstantData push{};
+		push.projectionView = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+
+		if (frameInfo.commandRecorder == nullptr) {
+			if (depthPrepass) {
+				lastDrawCount += recordDraws<OvrPositionVertexLayout>(
+					frameInfo.commandBuffer, prepassPipelines, push, scene, instanceBuffer, 0, drawList.size());
+			}
+			lastDrawCount += recordDraws<OvrFullVertexLayout>(
+				frameInfo.commandBuffer, pipelines, push, scene, instanceBuffer, 0, drawList.size());
+			return;
+		}
+
+		// contiguous slices of the draw list, each fills its own part of the instance buffer.
+		// The whole prepass is executed before the first shaded slice
+		const size_t drawListSize = drawList.size();
+		const uint32_t taskCount = static_cast<uint32_t>(std::min<size_t>(
+			frameInfo.commandRecorder->getThreadCount(),
+			(drawListSize + MIN_INSTANCES_PER_TASK - 1) / MIN_INSTANCES_PER_TASK));
+		taskDrawCounts.assign(taskCount, 0);
+		if (depthPrepass) {
+			frameInfo.commandRecorder->recordAndExecute(frameInfo.commandBuffer, taskCount,
+				[&](VkCommandBuffer commandBuffer, uint32_t task) {
+					taskDrawCounts[task] = recordDraws<OvrPositionVertexLayout>(commandBuffer, prepassPipelines, push,
+						scene, instanceBuffer, drawListSize * task / taskCount, drawListSize * (task + 1) / taskCount);
+				});
+		}
+		frameInfo.commandRecorder->recordAndExecute(frameInfo.commandBuffer, taskCount,
+			[&](VkCommandBuffer commandBuffer, uint32_t task) {
+				taskDrawCounts[task] += recordDraws<OvrFullVertexLayout>(commandBuffer, pipelines, push, scene,
+					instanceBuffer, drawListSize * task / taskCount, drawListSize * (task + 1) / taskCount);
+			});
+		for (uint32_t drawCount : taskDrawCounts) {
+			lastDrawCount += drawCount;
+		}
+	}
+
+	void SimpleRenderSystem::computeWorldSpheres(const OvrScene& scene, uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const glm::mat4& m = scene.getWorldMatrices()[candidates[i]];
+			const glm::vec4& sphere = scene.getModel(scene.getModelHandles()[candidates[i]])->getBoundingSphere();
+			float maxScale = glm::sqrt(glm::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+				glm::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])))));
+			worldSpheres.set(i, glm::vec3(m * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * maxScale);
+		}
+	}
+
+	template <typename Layout>
+	uint32_t SimpleRenderSystem::recordDraws(
+		VkCommandBuffer commandBuffer,
+		const LayoutPipelines& pipelines,
+		const SimplePushConstantData& push,
+		const OvrScene& scene,
+		const InstanceBuffer& instanceBuffer,
+		size_t begin,
+		size_t end) const {
+		if (!Layout::POSITIONS_ONLY) {
+			auto* instances = static_cast<OvrModel::InstanceData*>(instanceBuffer.allocation.mapped);
+			for (size_t i = begin; i < end; i++) {
+				uint32_t index = drawList[i].index;
+				instances[i].modelMatrix = scene.getWorldMatrices()[index];
+				instances[i].normalMatrix = scene.getNormalMatrices()[index];
+			}
+		}
 
-		for (auto& obj : gameObjects) {
+		vkCmdPushConstants(
+			commandBuffer,
+			pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT,
+			0,
+			sizeof(SimplePushConstantData),
+			&push);
 
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, OvrModel::InstanceData::BINDING, 1, &instanceBuffer.buffer, &offset);
 
-			SimplePushConstantData push{};
-			auto normalMatrix = obj.transform.mat4();
-			push.transform = projectionView * normalMatrix;
-			push.normalMatrix = normalMatrix;
+		// a model group cut by the slice boundary becomes one draw in each slice
+		uint32_t drawCount = 0;
+		OvrPipeline* boundPipeline = nullptr;
+		OvrGeometryPool::BindState bindState{}; // models share pool pages, most draws bind nothing
+		for (size_t first = begin; first < end;) {
+			size_t last = first + 1;
+			while (last < end && drawList[last].model == drawList[first].model && drawList[last].lod == drawList[first].lod) {
+				last++;
+			}
+			OvrModel* model = scene.getModel(drawList[first].model);
+			OvrPipeline* pipeline = pipelines[model->getVertexLayout()];
+			if (pipeline != boundPipeline) {
+				pipeline->bind(commandBuffer);
+				boundPipeline = pipeline;
+			}
 			vkCmdPushConstants(
 				commandBuffer,
 				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
-			obj.model->bind(commandBuffer);
-			obj.model->draw(commandBuffer);
+				VK_SHADER_STAGE_VERTEX_BIT,
+				offsetof(SimplePushConstantData, dequantization),
+				sizeof(OvrModel::Dequantization),
+				&model->getDequantization());
+			Layout::bind(commandBuffer, *model, &bindState);
+			model->draw(commandBuffer, static_cast<uint32_t>(last - first), static_cast<uint32_t>(first), drawList[first].lod);
+			drawCount++;
+			first = last;
 		}
+		return drawCount;
 	}
 
 
@@ -8,37 +8,131 @@
 
 #pragma once
 #include "ovr_camera.h"
+#include "ovr_frame_info.h"
+#include "ovr_frustum_culling.h"
 #include "ovr_pipeline.h"
+#include "ovr_pipeline_builder.h"
 #include "ovr_device.h"
-#include "ovr_game_object.h"
+#include "ovr_scene.h"
+#include "ovr_scene_bvh.h"
 
+#include <array>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace ovr {
+	class OvrJobSystem;
+	class OvrLodSelector;
+	struct SimplePushConstantData;
 
 	class SimpleRenderSystem {
 
 	public:
 
-		SimpleRenderSystem(OVRDevice &device, VkRenderPass renderPass);
+		// the pipeline compiles on pipelineBuilder, the first renderGameObjects waits for it
+		SimpleRenderSystem(OVRDevice &device, VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder);
 		~SimpleRenderSystem();
 
 		// c++11 Disallow copying (compiler will not generate those constructors)
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-		void renderGameObjects(VkCommandBuffer commandBuffer, 
-			std::vector<OvrGameObject>& gameObjects,
-			const OvrCamera &camera);
+		// entities sharing a model are drawn with one instanced draw, reads the scene's world matrices.
+		// With frameInfo.commandRecorder the draw list is split into slices recorded on its threads.
+		void renderGameObjects(FrameInfo &frameInfo, const OvrScene& scene);
+
+		uint32_t getLastDrawCount() const { return lastDrawCount; }
+		// visible / culled object counts of the last renderGameObjects call
+		const OvrCullingStats& getCullingStats() const { return cullingStats; }
+		void setFrustumCulling(bool enabled) { frustumCulling = enabled; }
+		// cull by querying sceneBvh instead of testing every entity, it must have been updated with the
+		// same scene this frame. nullptr to stop.
+		void setSceneBvh(const OvrSceneBvh* bvh) { sceneBvh = bvh; }
+		// split the SIMD culling of large scenes into jobs, nullptr culls on the calling thread
+		void setJobSystem(OvrJobSystem* jobs) { jobSystem = jobs; }
+		// draws the visible objects' depth first with only their position streams, then shades them at
+		// equal depth so every pixel runs the fragment shader once. Counts as draws of its own
+		void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+		bool isDepthPrepassEnabled() const { return depthPrepass; }
+		// draws every visible entity at the level of detail selector picks, its beginFrame must have been
+		// called with this frame's camera. nullptr draws level 0
+		void setLodSelector(OvrLodSelector* selector) { lodSelector = selector; }
+		// triangles the last renderGameObjects shaded, and how many level 0 would have been
+		uint64_t getLastTriangleCount() const { return lastTriangleCount; }
+		uint64_t getLastFullTriangleCount() const { return lastFullTriangleCount; }
 
 	private:
+		// below this many instances per slice the thread handoff costs more than recording saves
+		static constexpr size_t MIN_INSTANCES_PER_TASK = 256;
+		// candidates per culling job, a multiple of OvrSphereSoA::PADDING
+		static constexpr uint32_t CULL_JOB_SIZE = 4096;
+
+		using LayoutPipelines = std::array<OvrPipeline*, OvrModel::VERTEX_LAYOUT_COUNT>;
+		using LayoutPipelineHandles = std::array<OvrPipelineHandle, OvrModel::VERTEX_LAYOUT_COUNT>;
+
+		// entities sharing a model and level are drawn together
+		struct DrawItem {
+			OvrScene::ModelHandle model;
+			uint32_t lod;
+			uint32_t index; // in the scene
+		};
+
+		struct InstanceBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			OvrAllocation allocation{};
+			uint32_t capacity = 0; // in instances
+		};
+
 		void createPipelineLayout();
-		void createPipeline(VkRenderPass renderPass);
+		void createPipeline(VkRenderPass renderPass, OvrPipelineBuilder &pipelineBuilder);
+		// one per OvrModel vertex layout, reading the streams of Layout (an OvrVertexLayout)
+		template <typename Layout>
+		void requestPipelines(
+			VkRenderPass renderPass,
+			OvrPipelineBuilder &pipelineBuilder,
+			LayoutPipelineHandles &handles,
+			const char* const* vertexShaders,
+			const char* fragmentShader);
+		void reserveInstances(InstanceBuffer &instanceBuffer, uint32_t instanceCount);
+		// bounding spheres of candidates [begin, end) in world space
+		void computeWorldSpheres(const OvrScene &scene, uint32_t begin, uint32_t end);
+		// records the draws of [begin, end) of the draw list, returns the draw count. The full layout pass
+		// also fills their instances, the GPU reads them after every pass is recorded
+		template <typename Layout>
+		uint32_t recordDraws(
+			VkCommandBuffer commandBuffer,
+			const LayoutPipelines &pipelines,
+			const SimplePushConstantData &push,
+			const OvrScene &scene,
+			const InstanceBuffer &instanceBuffer,
+			size_t begin,
+			size_t end) const;
 	
 		OVRDevice &ovrDevice;
 
-		std::unique_ptr<OvrPipeline> ovrPipeline;
+		LayoutPipelineHandles ovrPipelines;   // per OvrModel vertex layout
+		LayoutPipelineHandles depthPipelines; // position streams only, no color writes
 		VkPipelineLayout pipelineLayout;
+
+		// written by the CPU each frame, one per frame in flight so the GPU never reads a buffer being filled
+		std::vector<InstanceBuffer> instanceBuffers;
+		// reused between frames
+		std::vector<uint32_t> candidates;     // dense scene indices of entities with a model
+		OvrSphereSoA worldSpheres;            // per candidate
+		std::vector<uint32_t> visibleIndices;
+		std::vector<uint32_t> rangeVisibleCounts; // per culling job
+		std::vector<DrawItem> drawList;
+		std::vector<uint32_t> taskDrawCounts; // per recording slice
+
+		bool frustumCulling = true;
+		bool depthPrepass = false;
+		const OvrSceneBvh* sceneBvh = nullptr;
+		OvrLodSelector* lodSelector = nullptr;
+		OvrJobSystem* jobSystem = nullptr;
+		OvrCullingStats cullingStats{};
+		uint32_t lastDrawCount = 0;
+		uint64_t lastTriangleCount = 0;
+		uint64_t lastFullTriangleCount = 0;
 	};
 }
\ No newline at end of file